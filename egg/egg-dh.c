@@ -235,30 +235,77 @@ egg_dh_default_params_raw (const gchar *name, gconstpointer *prime,
 	return FALSE;
 }
 
-gboolean
-egg_dh_default_params (const gchar *name, gcry_mpi_t *prime, gcry_mpi_t *base)
+#define N_DH_GROUPS (G_N_ELEMENTS (dh_groups) - 1)
+
+static gint
+dh_group_index (const gchar *name)
 {
-	const DHGroup *group;
-	gcry_error_t gcry;
+	gint i;
 
-	g_return_val_if_fail (name, FALSE);
+	for (i = 0; dh_groups[i].name; ++i) {
+		if (g_str_equal (dh_groups[i].name, name))
+			return i;
+	}
 
-	for (group = dh_groups; group->name; ++group) {
-		if (g_str_equal (group->name, name)) {
-			if (prime) {
-				gcry = gcry_mpi_scan (prime, GCRYMPI_FMT_USG, group->prime, group->n_prime, NULL);
-				g_return_val_if_fail (gcry == 0, FALSE);
-				g_return_val_if_fail (gcry_mpi_get_nbits (*prime) == group->bits, FALSE);
-			}
-			if (base) {
-				gcry = gcry_mpi_scan (base, GCRYMPI_FMT_USG, group->base, group->n_base, NULL);
-				g_return_val_if_fail (gcry == 0, FALSE);
+	return -1;
+}
+
+/*
+ * The parsed parameters for each group are cached for the life of the
+ * process, and are never modified. Callers get copies.
+ */
+static gboolean
+dh_group_params (gint index, gcry_mpi_t *prime, gcry_mpi_t *base)
+{
+	static gsize initialized[N_DH_GROUPS] = { 0, };
+	static gcry_mpi_t primes[N_DH_GROUPS] = { NULL, };
+	static gcry_mpi_t bases[N_DH_GROUPS] = { NULL, };
+	const DHGroup *group = dh_groups + index;
+	gcry_mpi_t p, b;
+	gcry_error_t gcry;
+
+	if (g_once_init_enter (&initialized[index])) {
+		gcry = gcry_mpi_scan (&p, GCRYMPI_FMT_USG, group->prime, group->n_prime, NULL);
+		if (gcry == 0 && gcry_mpi_get_nbits (p) == group->bits) {
+			gcry = gcry_mpi_scan (&b, GCRYMPI_FMT_USG, group->base, group->n_base, NULL);
+			if (gcry == 0) {
+				primes[index] = p;
+				bases[index] = b;
+			} else {
+				gcry_mpi_release (p);
 			}
-			return TRUE;
+		} else if (gcry == 0) {
+			gcry_mpi_release (p);
 		}
+		g_once_init_leave (&initialized[index], 1);
 	}
 
-	return FALSE;
+	*prime = primes[index];
+	*base = bases[index];
+	g_return_val_if_fail (*prime != NULL && *base != NULL, FALSE);
+	return TRUE;
+}
+
+gboolean
+egg_dh_default_params (const gchar *name, gcry_mpi_t *prime, gcry_mpi_t *base)
+{
+	gcry_mpi_t p, b;
+	gint index;
+
+	g_return_val_if_fail (name, FALSE);
+
+	index = dh_group_index (name);
+	if (index < 0)
+		return FALSE;
+
+	if (!dh_group_params (index, &p, &b))
+		return FALSE;
+
+	if (prime)
+		*prime = gcry_mpi_copy (p);
+	if (base)
+		*base = gcry_mpi_copy (b);
+	return TRUE;
 }
 
 gboolean
@@ -351,3 +398,36 @@ egg_dh_gen_secret (gcry_mpi_t peer, gcry_mpi_t priv,
 
 	return value;
 }
+
+gboolean
+egg_dh_gen_pair_for_group (const gchar *name, gcry_mpi_t *prime,
+                           gcry_mpi_t *pub, gcry_mpi_t *priv)
+{
+	gcry_mpi_t p, b;
+	gint index;
+
+	g_return_val_if_fail (name, FALSE);
+	g_return_val_if_fail (prime, FALSE);
+	g_return_val_if_fail (pub, FALSE);
+	g_return_val_if_fail (priv, FALSE);
+
+	index = dh_group_index (name);
+	if (index < 0)
+		return FALSE;
+
+	if (!dh_group_params (index, &p, &b))
+		return FALSE;
+
+	*prime = gcry_mpi_copy (p);
+	b = gcry_mpi_copy (b);
+
+	if (!egg_dh_gen_pair (*prime, b, 0, pub, priv)) {
+		gcry_mpi_release (b);
+		gcry_mpi_release (*prime);
+		*prime = NULL;
+		return FALSE;
+	}
+
+	gcry_mpi_release (b);
+	return TRUE;
+}
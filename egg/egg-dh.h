@@ -47,4 +47,9 @@ gpointer   egg_dh_gen_secret                                  (gcry_mpi_t peer,
                                                                gcry_mpi_t prime,
                                                                gsize *bytes);
 
+gboolean   egg_dh_gen_pair_for_group                          (const gchar *name,
+                                                               gcry_mpi_t *prime,
+                                                               gcry_mpi_t *pub,
+                                                               gcry_mpi_t *priv);
+
 #endif /* EGG_DH_H_ */
@@ -41,6 +41,10 @@
 #include <unistd.h>
 #include <assert.h>
 
+#ifdef HAVE_PTHREAD_KEYS
+#include <pthread.h>
+#endif
+
 #ifdef WITH_VALGRIND
 #include <valgrind/valgrind.h>
 #include <valgrind/memcheck.h>
@@ -74,6 +78,25 @@
 static int lock_warning = 1;
 int egg_secure_warnings = 1;
 
+/*
+ * Only for comparison in the tests: find unused cells and owning blocks
+ * by walking all of them, and don't cache cells per thread, like before
+ * the size class bins and the block index.
+ */
+int egg_secure_linear_walk = 0;
+
+/* Counters for egg_secure_get_stats() */
+static unsigned long pages_acquired = 0;
+static unsigned long pages_released = 0;
+
+/*
+ * Empty blocks are kept around rather than unlocked and unmapped, as
+ * long as they add up to no more than the reserve length. This avoids
+ * mmap/mlock churn when memory is repeatedly allocated and freed.
+ */
+static size_t reserve_length = DEFAULT_BLOCK_SIZE;
+static size_t retained_length = 0;
+
 /* 
  * We allocate all memory in units of sizeof(void*). This 
  * is our definition of 'word'.
@@ -93,22 +116,33 @@ typedef struct _Cell {
 	size_t n_words;         /* Amount of secure memory in words */
 	size_t requested;       /* Amount actually requested by app, in bytes, 0 if unused */
 	const char *tag;        /* Tag which describes the allocation */
+	int unused;             /* In an unused bin, only changed with the lock held */
+	struct _Block *block;   /* Block the secure memory belongs to */
 	struct _Cell *next;     /* Next in memory ring */
 	struct _Cell *prev;     /* Previous in memory ring */
 } Cell;
 
 /* 
  * A block of secure memory. This structure is the header in that block.
+ * The unused cells of all blocks live in the size class bins below.
  */
 typedef struct _Block {
 	word_t *words;              /* Actual memory hangs off here */
 	size_t n_words;             /* Number of words in block */
 	size_t n_used;              /* Number of used allocations */
 	struct _Cell* used_cells;   /* Ring of used allocations */
-	struct _Cell* unused_cells; /* Ring of unused allocations */
 	struct _Block *next;        /* Next block in list */
 } Block;
 
+/*
+ * Unused cells are segregated into rings by size class. A cell with
+ * n_words lives in bin floor(log2(n_words)), and the last bin holds
+ * everything larger.
+ */
+#define UNUSED_BINS 16
+
+static Cell *unused_bins[UNUSED_BINS] = { NULL, };
+
 /* -----------------------------------------------------------------------------
  * UNUSED STACK
  */
@@ -386,6 +420,80 @@ sec_remove_cell_ring (Cell **ring, Cell *cell)
 	ASSERT (*ring != cell);
 }
 
+static inline unsigned int
+sec_bin_for_words (size_t n_words)
+{
+	unsigned int bin = 0;
+
+	while ((n_words >>= 1) != 0 && bin < UNUSED_BINS - 1)
+		++bin;
+
+	return bin;
+}
+
+static inline void
+sec_insert_unused (Cell *cell)
+{
+	ASSERT (cell->requested == 0);
+	sec_insert_cell_ring (&unused_bins[sec_bin_for_words (cell->n_words)], cell);
+	cell->unused = 1;
+}
+
+static inline void
+sec_remove_unused (Cell *cell)
+{
+	/* Must be called before the size of the cell changes */
+	sec_remove_cell_ring (&unused_bins[sec_bin_for_words (cell->n_words)], cell);
+	cell->unused = 0;
+}
+
+static Cell*
+sec_find_unused (size_t n_words)
+{
+	unsigned int bin, i;
+	Cell *cell;
+
+	/* First fit, from the smallest cells up */
+	if (egg_secure_linear_walk) {
+		for (i = 0; i < UNUSED_BINS; ++i) {
+			cell = unused_bins[i];
+			if (!cell)
+				continue;
+			do {
+				if (cell->n_words >= n_words)
+					return cell;
+				cell = cell->next;
+			} while (cell != unused_bins[i]);
+		}
+		return NULL;
+	}
+
+	bin = sec_bin_for_words (n_words);
+
+	/* Reuse a cell from our own size class if the first one fits */
+	cell = unused_bins[bin];
+	if (cell && cell->n_words >= n_words)
+		return cell;
+
+	/* Any cell in a larger size class is big enough */
+	for (i = bin + 1; i < UNUSED_BINS; ++i) {
+		if (unused_bins[i])
+			return unused_bins[i];
+	}
+
+	/* Last resort, look through our own size class */
+	cell = unused_bins[bin];
+	if (cell) {
+		do {
+			if (cell->n_words >= n_words)
+				return cell;
+			cell = cell->next;
+		} while (cell != unused_bins[bin]);
+	}
+
+	return NULL;
+}
+
 static inline void*
 sec_cell_to_memory (Cell *cell)
 {
@@ -480,21 +588,17 @@ sec_neighbor_after (Block *block, Cell *cell)
 }
 
 static void*
-sec_alloc (Block *block,
-           const char *tag,
+sec_alloc (const char *tag,
            size_t length)
 {
+	Block *block;
 	Cell *cell, *other;
 	size_t n_words;
 	void *memory;
 	
-	ASSERT (block);
 	ASSERT (length);
 	ASSERT (tag);
 
-	if (!block->unused_cells)
-		return NULL;
-
 	/* 
 	 * Each memory allocation is aligned to a pointer size, and 
 	 * then, sandwidched between two pointers to its meta data.
@@ -506,15 +610,7 @@ sec_alloc (Block *block,
 	n_words = sec_size_to_words (length) + 2;
 	
 	/* Look for a cell of at least our required size */
-	cell = block->unused_cells;
-	while (cell->n_words < n_words) {
-		cell = cell->next;
-		if (cell == block->unused_cells) {
-			cell = NULL;
-			break;
-		}
-	}
-	
+	cell = sec_find_unused (n_words);
 	if (!cell)
 		return NULL;
 
@@ -522,13 +618,20 @@ sec_alloc (Block *block,
 	ASSERT (cell->requested == 0);
 	ASSERT (cell->prev);
 	ASSERT (cell->words);
+	ASSERT (cell->block);
 	sec_check_guards (cell);
+
+	block = cell->block;
+	sec_remove_unused (cell);
 	
 	/* Steal from the cell if it's too long */
 	if (cell->n_words > n_words + WASTE) {
 		other = pool_alloc ();
-		if (!other)
+		if (!other) {
+			sec_insert_unused (cell);
 			return NULL;
+		}
+		other->block = block;
 		other->n_words = n_words;
 		other->words = cell->words;
 		cell->n_words -= n_words;
@@ -536,12 +639,16 @@ sec_alloc (Block *block,
 		
 		sec_write_guards (other);
 		sec_write_guards (cell);
+		sec_insert_unused (cell);
 		
 		cell = other;
 	}
-	
-	if (cell->next)
-		sec_remove_cell_ring (&block->unused_cells, cell);
+
+	/* Taking an empty block back out of the reserve */
+	if (block->n_used == 0) {
+		ASSERT (retained_length >= block->n_words * sizeof (word_t));
+		retained_length -= block->n_words * sizeof (word_t);
+	}
 
 	++block->n_used;
 	cell->tag = tag;
@@ -593,9 +700,10 @@ sec_free (Block *block, void *memory)
 
         /* Find previous unallocated neighbor, and merge if possible */
         other = sec_neighbor_before (block, cell);
-        if (other && other->requested == 0) {
+        if (other && other->unused) {
         	ASSERT (other->tag == NULL);
         	ASSERT (other->next && other->prev);
+        	sec_remove_unused (other);
         	other->n_words += cell->n_words;
         	sec_write_guards (other);
         	pool_free (cell);
@@ -604,24 +712,21 @@ sec_free (Block *block, void *memory)
         
         /* Find next unallocated neighbor, and merge if possible */
         other = sec_neighbor_after (block, cell);
-        if (other && other->requested == 0) {
+        if (other && other->unused) {
         	ASSERT (other->tag == NULL);
         	ASSERT (other->next && other->prev);
+        	sec_remove_unused (other);
         	other->n_words += cell->n_words;
         	other->words = cell->words;
-        	if (cell->next)
-        		sec_remove_cell_ring (&block->unused_cells, cell);
         	sec_write_guards (other);
         	pool_free (cell);
         	cell = other;
         }
 
-        /* Add to the unused list if not already there */
-        if (!cell->next)
-        	sec_insert_cell_ring (&block->unused_cells, cell);
-
+        /* Add to the unused bin for its new size */
         cell->tag = NULL;
         cell->requested = 0;
+        sec_insert_unused (cell);
         --block->n_used;
         return NULL;
 }
@@ -717,21 +822,23 @@ sec_realloc (Block *block,
 
 		/* See if we have a neighbor who can give us some memory */
 		other = sec_neighbor_after (block, cell);
-		if (!other || other->requested != 0)
+		if (!other || !other->unused)
 			break;
 		
 		/* Eat the whole neighbor if not too big */
 		if (n_words - cell->n_words + WASTE >= other->n_words) {
+			sec_remove_unused (other);
 			cell->n_words += other->n_words;
 			sec_write_guards (cell);
-			sec_remove_cell_ring (&block->unused_cells, other);
 			pool_free (other);
 
 		/* Steal from the neighbor */
 		} else {
+			sec_remove_unused (other);
 			other->words += n_words - cell->n_words;
 			other->n_words -= n_words - cell->n_words;
 			sec_write_guards (other);
+			sec_insert_unused (other);
 			cell->n_words = n_words;
 			sec_write_guards (cell);
 		}
@@ -746,7 +853,7 @@ sec_realloc (Block *block,
 	}
 
 	/* That didn't work, try alloc/free */
-	alloc = sec_alloc (block, tag, length);
+	alloc = sec_alloc (tag, length);
 	if (alloc) {
 		memcpy_with_vbits (alloc, memory, valid);
 		sec_free (block, memory);
@@ -812,9 +919,10 @@ sec_validate (Block *block)
 		/* Validate that it's actually for real */
 		sec_check_guards (cell);
 	
-		/* Is it an allocated block? */
+		/* Is it an allocated block, or one cached by a thread? */
 		if (cell->requested > 0) {
-			ASSERT (cell->tag != NULL);
+			ASSERT (cell->tag != NULL || cell->requested == sizeof (word_t));
+			ASSERT (!cell->unused);
 			ASSERT (cell->next != NULL);
 			ASSERT (cell->prev != NULL);
 			ASSERT (cell->next->prev == cell);
@@ -824,6 +932,8 @@ sec_validate (Block *block)
 		/* An unused block */
 		} else {
 			ASSERT (cell->tag == NULL);
+			ASSERT (cell->unused);
+			ASSERT (cell->block == block);
 			ASSERT (cell->next != NULL);
 			ASSERT (cell->prev != NULL);
 			ASSERT (cell->next->prev == cell);
@@ -877,6 +987,7 @@ sec_acquire_pages (size_t *sz,
 	
 	DEBUG_ALLOC ("gkr-secure-memory: new block ", *sz);
 	
+	++pages_acquired;
 	lock_warning = 1;
 	return pages;
 	
@@ -903,6 +1014,7 @@ sec_release_pages (void *pages, size_t sz)
 		fprintf (stderr, "couldn't unmap private anonymous memory: %s\n", strerror (errno));
 		
 	DEBUG_ALLOC ("gkr-secure-memory: freed block ", sz);
+	++pages_released;
 	
 #else
 	ASSERT (FALSE);
@@ -915,6 +1027,101 @@ sec_release_pages (void *pages, size_t sz)
 
 static Block *all_blocks = NULL;
 
+/*
+ * All blocks sorted by address, so that the block some memory belongs
+ * to can be found with a binary search. This is plain meta data.
+ */
+static Block **block_index = NULL;
+static size_t n_block_index = 0;
+static size_t max_block_index = 0;
+
+static size_t
+sec_block_index_bound (const word_t *word)
+{
+	size_t lo = 0;
+	size_t hi = n_block_index;
+	size_t mid;
+
+	/* Find the first block which starts after this word */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (block_index[mid]->words <= word)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int
+sec_block_index_insert (Block *block)
+{
+	Block **index;
+	size_t at;
+
+	if (n_block_index == max_block_index) {
+		index = realloc (block_index, sizeof (Block *) * (max_block_index + 32));
+		if (index == NULL)
+			return 0;
+		block_index = index;
+		max_block_index += 32;
+	}
+
+	at = sec_block_index_bound (block->words);
+	memmove (block_index + at + 1, block_index + at,
+	         sizeof (Block *) * (n_block_index - at));
+	block_index[at] = block;
+	++n_block_index;
+	return 1;
+}
+
+static void
+sec_block_index_remove (Block *block)
+{
+	size_t at;
+
+	at = sec_block_index_bound (block->words);
+	ASSERT (at > 0);
+	ASSERT (block_index[at - 1] == block);
+
+	--at;
+	memmove (block_index + at, block_index + at + 1,
+	         sizeof (Block *) * (n_block_index - at - 1));
+	--n_block_index;
+
+	if (n_block_index == 0) {
+		free (block_index);
+		block_index = NULL;
+		max_block_index = 0;
+	}
+}
+
+static Block*
+sec_block_for_memory (const void *memory)
+{
+	Block *block;
+	size_t at;
+
+	if (egg_secure_linear_walk) {
+		for (block = all_blocks; block; block = block->next) {
+			if (sec_is_valid_word (block, (word_t *)memory))
+				return block;
+		}
+		return NULL;
+	}
+
+	at = sec_block_index_bound (memory);
+	if (at == 0)
+		return NULL;
+
+	block = block_index[at - 1];
+	if (!sec_is_valid_word (block, (word_t *)memory))
+		return NULL;
+
+	return block;
+}
+
 static Block* 
 sec_block_create (size_t size,
                   const char *during_tag)
@@ -950,19 +1157,30 @@ sec_block_create (size_t size,
 		return NULL;
 	}
 	
+	if (!sec_block_index_insert (block)) {
+		sec_release_pages (block->words, size);
+		pool_free (block);
+		pool_free (cell);
+		return NULL;
+	}
+
 #ifdef WITH_VALGRIND
 	VALGRIND_MAKE_MEM_DEFINED (block->words, size);
 #endif
 	
 	/* The first cell to allocate from */
+	cell->block = block;
 	cell->words = block->words;
 	cell->n_words = block->n_words;
 	cell->requested = 0;
 	sec_write_guards (cell);
-	sec_insert_cell_ring (&block->unused_cells, cell);
+	sec_insert_unused (cell);
 
 	block->next = all_blocks;
 	all_blocks = block;
+
+	/* Empty until something is allocated from it */
+	retained_length += block->n_words * sizeof (word_t);
 	
 	return block;
 }
@@ -989,12 +1207,24 @@ sec_block_destroy (Block *block)
 	ASSERT (bl == block);
 	ASSERT (block->used_cells == NULL);
 
-	/* Release all the meta data cells */
-	while (block->unused_cells) {
-		cell = block->unused_cells;
-		sec_remove_cell_ring (&block->unused_cells, cell);
-		pool_free (cell);
-	}
+	sec_block_index_remove (block);
+
+	ASSERT (retained_length >= block->n_words * sizeof (word_t));
+	retained_length -= block->n_words * sizeof (word_t);
+
+	/* With nothing used, a single unused cell spans the whole block */
+#ifdef WITH_VALGRIND
+	VALGRIND_MAKE_MEM_DEFINED (block->words, sizeof (word_t));
+#endif
+	cell = *(block->words);
+	sec_check_guards (cell);
+	ASSERT (cell->block == block);
+	ASSERT (cell->requested == 0);
+	ASSERT (cell->n_words == block->n_words);
+
+	/* Release the meta data cell */
+	sec_remove_unused (cell);
+	pool_free (cell);
 	
 	/* Release all pages of secure memory */
 	sec_release_pages (block->words, block->n_words * sizeof (word_t));
@@ -1002,6 +1232,496 @@ sec_block_destroy (Block *block)
 	pool_free (block);
 }
 
+static void
+sec_block_trim (void)
+{
+	Block *block, *next;
+
+	/* Destroy empty blocks until the reserve is no longer exceeded */
+	for (block = all_blocks; block && retained_length > reserve_length; block = next) {
+		next = block->next;
+		if (block->n_used == 0)
+			sec_block_destroy (block);
+	}
+}
+
+static void
+sec_block_release (Block *block)
+{
+	ASSERT (block);
+	ASSERT (block->n_used == 0);
+
+	/* Keep the block in the reserve if there's room */
+	retained_length += block->n_words * sizeof (word_t);
+	if (retained_length > reserve_length)
+		sec_block_destroy (block);
+}
+
+/* -----------------------------------------------------------------------------
+ * PER THREAD MAGAZINES
+ *
+ * Each thread caches a few small cells that it recently freed, so that most
+ * allocations and frees don't need to take the lock. Cached cells are still
+ * used as far as their block is concerned: they're cleared, but not merged,
+ * and keep their block mapped. This is why memory can be freed without the
+ * lock when it is in a block of one of the cached cells. Other memory has to
+ * be looked up with the lock held, as it may not be secure memory at all.
+ *
+ * A cached cell has no tag, and only its first word counts as requested. That
+ * word holds a poison value, so that freeing the memory again is caught. The
+ * tag and requested length are set again when the cell is handed out.
+ *
+ * Each magazine has its own mutex, which guards its cells, and the meta data
+ * of those cells. The owning thread takes only that mutex to cache a cell or
+ * hand one out. Anyone else who looks at cell meta data or at the magazine
+ * takes it after the lock. Merging neighbors with just the lock held only
+ * looks at whether they're unused, which isn't changed without the lock.
+ */
+
+#ifdef HAVE_PTHREAD_KEYS
+
+/* Cells in size class bins below this are cached */
+#define MAGAZINE_BINS     5
+
+/* Number of cells cached per size class, per thread */
+#define MAGAZINE_SIZE     8
+
+/* Number of distinct blocks the cached cells can come from */
+#define MAGAZINE_BLOCKS   4
+
+typedef struct _Magazine {
+	pthread_mutex_t mutex;                 /* Taken after the lock, if both */
+	struct _Magazine *next;                /* Next in all_magazines */
+	Cell *cells[MAGAZINE_BINS][MAGAZINE_SIZE];
+	unsigned int n_cells[MAGAZINE_BINS];
+	Block *blocks[MAGAZINE_BLOCKS];        /* Blocks of the cached cells */
+	unsigned int n_refs[MAGAZINE_BLOCKS];  /* Cached cells in each block */
+} Magazine;
+
+/* Mixed with the address of cached memory, and stored in its first word */
+#define MAGAZINE_POISON   ((size_t)0xA5C3E1F0A5C3E1F0ULL)
+
+/* The magazines of all threads, only changed with the lock held */
+static Magazine *all_magazines = NULL;
+
+static pthread_key_t magazine_key;
+static pthread_once_t magazine_once = PTHREAD_ONCE_INIT;
+static int magazine_key_valid = 0;
+
+static inline void
+magazine_lock (Magazine *mag)
+{
+	if (mag != NULL)
+		pthread_mutex_lock (&mag->mutex);
+}
+
+static inline void
+magazine_unlock (Magazine *mag)
+{
+	if (mag != NULL)
+		pthread_mutex_unlock (&mag->mutex);
+}
+
+/* Called with the lock held */
+static void
+magazine_lock_all (void)
+{
+	Magazine *mag;
+
+	for (mag = all_magazines; mag != NULL; mag = mag->next)
+		magazine_lock (mag);
+}
+
+/* Called with the lock held */
+static void
+magazine_unlock_all (void)
+{
+	Magazine *mag;
+
+	for (mag = all_magazines; mag != NULL; mag = mag->next)
+		magazine_unlock (mag);
+}
+
+static int
+magazine_ref_block (Magazine *mag,
+                    Block *block)
+{
+	unsigned int i, slot = MAGAZINE_BLOCKS;
+
+	for (i = 0; i < MAGAZINE_BLOCKS; ++i) {
+		if (mag->blocks[i] == block) {
+			mag->n_refs[i]++;
+			return 1;
+		}
+		if (mag->blocks[i] == NULL && slot == MAGAZINE_BLOCKS)
+			slot = i;
+	}
+
+	if (slot == MAGAZINE_BLOCKS)
+		return 0;
+
+	mag->blocks[slot] = block;
+	mag->n_refs[slot] = 1;
+	return 1;
+}
+
+static void
+magazine_unref_block (Magazine *mag,
+                      Block *block)
+{
+	unsigned int i;
+
+	for (i = 0; i < MAGAZINE_BLOCKS; ++i) {
+		if (mag->blocks[i] == block) {
+			ASSERT (mag->n_refs[i] > 0);
+			if (--mag->n_refs[i] == 0)
+				mag->blocks[i] = NULL;
+			return;
+		}
+	}
+
+	ASSERT (0 && "cached cell from an unknown block");
+}
+
+/* Called with the magazine mutex held */
+static Block*
+magazine_find_block (Magazine *mag,
+                     const void *memory)
+{
+	unsigned int i;
+
+	/* These blocks can't go away while we have cells cached in them */
+	for (i = 0; i < MAGAZINE_BLOCKS; ++i) {
+		if (mag->blocks[i] && sec_is_valid_word (mag->blocks[i], (word_t *)memory))
+			return mag->blocks[i];
+	}
+
+	return NULL;
+}
+
+static void
+magazine_poison (void *memory)
+{
+#ifdef WITH_VALGRIND
+	VALGRIND_MAKE_MEM_UNDEFINED (memory, sizeof (word_t));
+#endif
+	*(word_t *)memory = (word_t)((size_t)memory ^ MAGAZINE_POISON);
+}
+
+static int
+magazine_is_poisoned (const void *memory)
+{
+#ifdef WITH_VALGRIND
+	VALGRIND_MAKE_MEM_DEFINED (memory, sizeof (word_t));
+#endif
+	return *(const word_t *)memory == (word_t)((size_t)memory ^ MAGAZINE_POISON);
+}
+
+static Cell*
+magazine_memory_to_cell (void *memory)
+{
+	word_t *word;
+	Cell *cell;
+
+	word = memory;
+	--word;
+
+#ifdef WITH_VALGRIND
+	VALGRIND_MAKE_MEM_DEFINED (word, sizeof (word_t));
+#endif
+
+	cell = *word;
+	sec_check_guards (cell);
+	ASSERT (cell->requested > 0);
+	ASSERT (cell->tag != NULL);
+
+	return cell;
+}
+
+/* Called with the magazine mutex held */
+static int
+magazine_cache (Magazine *mag,
+                void *memory)
+{
+	unsigned int bin;
+	Cell *cell;
+
+	ASSERT (!magazine_is_poisoned (memory) && "secure memory freed twice");
+	cell = magazine_memory_to_cell (memory);
+
+	bin = sec_bin_for_words (cell->n_words);
+	if (bin >= MAGAZINE_BINS || mag->n_cells[bin] == MAGAZINE_SIZE)
+		return 0;
+	if (!magazine_ref_block (mag, cell->block))
+		return 0;
+
+	/* Not put in an unused bin, so it's never merged while cached */
+	sec_clear_noaccess (memory, 0, cell->requested);
+	magazine_poison (memory);
+	cell->tag = NULL;
+	cell->requested = sizeof (word_t);
+
+	mag->cells[bin][mag->n_cells[bin]++] = cell;
+	return 1;
+}
+
+/* Called with the magazine mutex held */
+static void*
+magazine_pop (Magazine *mag,
+              const char *tag,
+              size_t length)
+{
+	unsigned int bin;
+	size_t n_words;
+	void *memory;
+	Cell *cell;
+
+	n_words = sec_size_to_words (length) + 2;
+	bin = sec_bin_for_words (n_words);
+	if (bin >= MAGAZINE_BINS || mag->n_cells[bin] == 0)
+		return NULL;
+
+	/* Cells in a size class differ in size */
+	cell = mag->cells[bin][mag->n_cells[bin] - 1];
+	if (cell->n_words < n_words)
+		return NULL;
+
+	mag->n_cells[bin]--;
+	magazine_unref_block (mag, cell->block);
+
+	memory = sec_cell_to_memory (cell);
+	ASSERT (magazine_is_poisoned (memory));
+	ASSERT (cell->tag == NULL);
+	cell->tag = tag;
+	cell->requested = length;
+
+#ifdef WITH_VALGRIND
+	VALGRIND_MAKE_MEM_UNDEFINED (memory, length);
+#endif
+
+	return memset (memory, 0, length);
+}
+
+/* Called with the lock and the magazine mutex held */
+static void
+magazine_flush (Magazine *mag,
+                unsigned int bin,
+                unsigned int count)
+{
+	Block *block;
+	Cell *cell;
+
+	/* Free the oldest cells first */
+	while (count > 0 && mag->n_cells[bin] > 0) {
+		cell = mag->cells[bin][0];
+		memmove (mag->cells[bin], mag->cells[bin] + 1,
+		         sizeof (Cell *) * --mag->n_cells[bin]);
+
+		block = cell->block;
+		magazine_unref_block (mag, block);
+
+		/* Freed like any allocation, which clears the poison */
+		cell->tag = "magazine";
+		sec_free (block, sec_cell_to_memory (cell));
+		if (block->n_used == 0)
+			sec_block_release (block);
+		--count;
+	}
+}
+
+/* Called with the lock and the magazine mutex held */
+static void
+magazine_flush_all (Magazine *mag)
+{
+	unsigned int bin;
+
+	for (bin = 0; bin < MAGAZINE_BINS; ++bin)
+		magazine_flush (mag, bin, MAGAZINE_SIZE);
+}
+
+/* Called with the lock held, so that no threads come or go */
+static void
+magazine_flush_every (void)
+{
+	Magazine *mag;
+
+	for (mag = all_magazines; mag != NULL; mag = mag->next) {
+		magazine_lock (mag);
+		magazine_flush_all (mag);
+		magazine_unlock (mag);
+	}
+}
+
+/* Called with the lock and the magazine mutex held, after allocating this length */
+static void
+magazine_refill (Magazine *mag,
+                 size_t length)
+{
+	unsigned int bin, i;
+	size_t n_words;
+	void *memory;
+	Block *block;
+
+	n_words = sec_size_to_words (length) + 2;
+	bin = sec_bin_for_words (n_words);
+	if (bin >= MAGAZINE_BINS || mag->n_cells[bin] > 0)
+		return;
+
+	/* Largest cell in this size class, so it fits any request for the class */
+	length = ((2 << bin) - 1 - 2) * sizeof (word_t);
+
+	/* Only from unused cells of the current blocks, never a new block */
+	for (i = 0; i < MAGAZINE_SIZE / 2; ++i) {
+		memory = sec_alloc ("magazine", length);
+		if (memory == NULL)
+			break;
+		if (!magazine_cache (mag, memory)) {
+			block = magazine_memory_to_cell (memory)->block;
+			sec_free (block, memory);
+			if (block->n_used == 0)
+				sec_block_release (block);
+			break;
+		}
+	}
+}
+
+/* Called with the lock held, frees or caches secure memory */
+static void
+magazine_free_locked (Magazine *mag,
+                      Block *block,
+                      void *memory)
+{
+	unsigned int bin;
+	int cached = 0;
+
+	ASSERT (!magazine_is_poisoned (memory) && "secure memory freed twice");
+
+	if (mag != NULL) {
+		magazine_lock (mag);
+
+		cached = magazine_cache (mag, memory);
+
+		/* Make room by freeing half of a full size class */
+		if (!cached) {
+			bin = sec_bin_for_words (magazine_memory_to_cell (memory)->n_words);
+			if (bin < MAGAZINE_BINS && mag->n_cells[bin] == MAGAZINE_SIZE) {
+				magazine_flush (mag, bin, MAGAZINE_SIZE / 2);
+				cached = magazine_cache (mag, memory);
+			}
+		}
+
+		magazine_unlock (mag);
+	}
+
+	if (!cached) {
+		sec_free (block, memory);
+		if (block->n_used == 0)
+			sec_block_release (block);
+	}
+}
+
+static void
+magazine_destroy (void *data)
+{
+	Magazine *mag = data;
+	Magazine **at;
+
+	DO_LOCK ();
+
+		for (at = &all_magazines; *at != NULL; at = &(*at)->next) {
+			if (*at == mag) {
+				*at = mag->next;
+				break;
+			}
+		}
+
+		magazine_lock (mag);
+		magazine_flush_all (mag);
+		magazine_unlock (mag);
+
+	DO_UNLOCK ();
+
+	pthread_mutex_destroy (&mag->mutex);
+	free (mag);
+}
+
+static void
+magazine_key_init (void)
+{
+	if (pthread_key_create (&magazine_key, magazine_destroy) == 0)
+		magazine_key_valid = 1;
+}
+
+/* Called without the lock held */
+static Magazine*
+magazine_get (void)
+{
+	Magazine *mag;
+
+	if (egg_secure_linear_walk)
+		return NULL;
+
+	pthread_once (&magazine_once, magazine_key_init);
+	if (!magazine_key_valid)
+		return NULL;
+
+	mag = pthread_getspecific (magazine_key);
+	if (mag != NULL)
+		return mag;
+
+	mag = calloc (1, sizeof (Magazine));
+	if (mag == NULL)
+		return NULL;
+
+	if (pthread_mutex_init (&mag->mutex, NULL) != 0) {
+		free (mag);
+		return NULL;
+	}
+
+	if (pthread_setspecific (magazine_key, mag) != 0) {
+		pthread_mutex_destroy (&mag->mutex);
+		free (mag);
+		return NULL;
+	}
+
+	DO_LOCK ();
+
+		mag->next = all_magazines;
+		all_magazines = mag;
+
+	DO_UNLOCK ();
+
+	return mag;
+}
+
+#else /* !HAVE_PTHREAD_KEYS */
+
+typedef struct _Magazine Magazine;
+
+#define magazine_get()                      (NULL)
+#define magazine_lock(mag)
+#define magazine_unlock(mag)
+#define magazine_lock_all()
+#define magazine_unlock_all()
+#define magazine_find_block(mag, memory)    (NULL)
+#define magazine_pop(mag, tag, length)      (NULL)
+#define magazine_cache(mag, memory)         (0)
+#define magazine_refill(mag, length)
+#define magazine_flush_every()
+#define magazine_is_poisoned(memory)        (0)
+
+static void
+magazine_free_locked (Magazine *mag,
+                      Block *block,
+                      void *memory)
+{
+	sec_free (block, memory);
+	if (block->n_used == 0)
+		sec_block_release (block);
+}
+
+#endif /* HAVE_PTHREAD_KEYS */
+
 /* ------------------------------------------------------------------------
  * PUBLIC FUNCTIONALITY
  */
@@ -1011,6 +1731,7 @@ egg_secure_alloc_full (const char *tag,
                        size_t length,
                        int flags)
 {
+	Magazine *mag;
 	Block *block;
 	void *memory = NULL;
 
@@ -1027,20 +1748,40 @@ egg_secure_alloc_full (const char *tag,
 	/* Can't allocate zero bytes */
 	if (length == 0)
 		return NULL;
+
+	/* Try this thread's cached cells first, without the lock */
+	mag = magazine_get ();
+	if (mag != NULL) {
+		magazine_lock (mag);
+		memory = magazine_pop (mag, tag, length);
+		magazine_unlock (mag);
+		if (memory != NULL) {
+#ifdef WITH_VALGRIND
+			VALGRIND_MALLOCLIKE_BLOCK (memory, length, sizeof (void*), 1);
+#endif
+			return memory;
+		}
+	}
 	
 	DO_LOCK ();
 	
-		for (block = all_blocks; block; block = block->next) {
-			memory = sec_alloc (block, tag, length);
-			if (memory)
-				break;	
-		}
+		memory = sec_alloc (tag, length);
 	
 		/* None of the current blocks have space, allocate new */
 		if (!memory) {
 			block = sec_block_create (length, tag);
-			if (block)
-				memory = sec_alloc (block, tag, length);
+			if (block) {
+				memory = sec_alloc (tag, length);
+				if (!memory)
+					sec_block_trim ();
+			}
+		}
+
+		/* Cache a few more cells of this size while we have the lock */
+		if (memory != NULL && mag != NULL) {
+			magazine_lock (mag);
+			magazine_refill (mag, length);
+			magazine_unlock (mag);
 		}
 		
 #ifdef WITH_VALGRIND
@@ -1093,25 +1834,24 @@ egg_secure_realloc_full (const char *tag,
 	DO_LOCK ();
 	
 		/* Find out where it belongs to */
-		for (block = all_blocks; block; block = block->next) {
-			if (sec_is_valid_word (block, memory)) {
-				previous = sec_allocated (block, memory);
+		block = sec_block_for_memory (memory);
+		if (block) {
+			ASSERT (!magazine_is_poisoned (memory) && "secure memory used after free");
+			previous = sec_allocated (block, memory);
 
 #ifdef WITH_VALGRIND
-				/* Let valgrind think we are unallocating so that it'll validate */
-				VALGRIND_FREELIKE_BLOCK (memory, sizeof (word_t));
+			/* Let valgrind think we are unallocating so that it'll validate */
+			VALGRIND_FREELIKE_BLOCK (memory, sizeof (word_t));
 #endif
 
-				alloc = sec_realloc (block, tag, memory, length);
+			alloc = sec_realloc (block, tag, memory, length);
 
 #ifdef WITH_VALGRIND
-				/* Now tell valgrind about either the new block or old one */
-				VALGRIND_MALLOCLIKE_BLOCK (alloc ? alloc : memory, 
-				                           alloc ? length : previous, 
-				                           sizeof (word_t), 1);
+			/* Now tell valgrind about either the new block or old one */
+			VALGRIND_MALLOCLIKE_BLOCK (alloc ? alloc : memory, 
+			                           alloc ? length : previous, 
+			                           sizeof (word_t), 1);
 #endif					
-				break;
-			}
 		}
 
 		/* If it didn't work we may need to allocate a new block */
@@ -1119,7 +1859,7 @@ egg_secure_realloc_full (const char *tag,
 			donew = 1;
 
 		if (block && block->n_used == 0)
-			sec_block_destroy (block);
+			sec_block_release (block);
 		
 	DO_UNLOCK ();		
 	
@@ -1162,18 +1902,41 @@ egg_secure_free (void *memory)
 void
 egg_secure_free_full (void *memory, int flags)
 {
+	Magazine *mag;
 	Block *block = NULL;
 	
 	if (memory == NULL)
 		return;
+
+	/* Memory in a block that we have cached cells in is secure memory */
+	mag = magazine_get ();
+	if (mag != NULL) {
+		magazine_lock (mag);
+		block = magazine_find_block (mag, memory);
+		if (block != NULL) {
+#ifdef WITH_VALGRIND
+			VALGRIND_FREELIKE_BLOCK (memory, sizeof (word_t));
+#endif
+			if (magazine_cache (mag, memory)) {
+				magazine_unlock (mag);
+				return;
+			}
+		}
+		magazine_unlock (mag);
+
+		/* The block can't go away, the memory is still in use */
+		if (block != NULL) {
+			DO_LOCK ();
+				magazine_free_locked (mag, block, memory);
+			DO_UNLOCK ();
+			return;
+		}
+	}
 	
 	DO_LOCK ();
 	
 		/* Find out where it belongs to */
-		for (block = all_blocks; block; block = block->next) {
-			if (sec_is_valid_word (block, memory))
-				break;
-		}
+		block = sec_block_for_memory (memory);
 
 #ifdef WITH_VALGRIND
 		/* We like valgrind's warnings, so give it a first whack at checking for errors */
@@ -1182,9 +1945,7 @@ egg_secure_free_full (void *memory, int flags)
 #endif
 
 		if (block != NULL) {
-			sec_free (block, memory);
-			if (block->n_used == 0)
-				sec_block_destroy (block);
+			magazine_free_locked (mag, block, memory);
 		}
 			
 	DO_UNLOCK ();
@@ -1209,10 +1970,13 @@ egg_secure_check (const void *memory)
 	DO_LOCK ();
 	
 		/* Find out where it belongs to */
-		for (block = all_blocks; block; block = block->next) {
-			if (sec_is_valid_word (block, (word_t*)memory))
-				break;
-		}
+		block = sec_block_for_memory (memory);
+
+		/* Memory cached by a thread is not allocated */
+		if (block != NULL && (size_t)memory % sizeof (word_t) == 0 &&
+		    sec_is_valid_word (block, (word_t *)memory) &&
+		    magazine_is_poisoned (memory))
+			block = NULL;
 		
 	DO_UNLOCK ();
 	
@@ -1225,47 +1989,87 @@ egg_secure_validate (void)
 	Block *block = NULL;
 	
 	DO_LOCK ();
+		magazine_lock_all ();
 	
 		for (block = all_blocks; block; block = block->next)
 			sec_validate (block);
 		
+		magazine_unlock_all ();
+	DO_UNLOCK ();
+}
+
+void
+egg_secure_set_reserve (size_t length)
+{
+	DO_LOCK ();
+
+		reserve_length = length;
+
+		/* Cells cached by any thread keep their blocks in use */
+		magazine_flush_every ();
+		sec_block_trim ();
+
+	DO_UNLOCK ();
+}
+
+void
+egg_secure_get_stats (egg_secure_stats *stats)
+{
+	Block *block;
+
+	ASSERT (stats);
+	memset (stats, 0, sizeof (egg_secure_stats));
+
+	DO_LOCK ();
+
+		for (block = all_blocks; block != NULL; block = block->next)
+			stats->n_blocks++;
+		stats->retained_length = retained_length;
+		stats->pages_acquired = pages_acquired;
+		stats->pages_released = pages_released;
+
 	DO_UNLOCK ();
 }
 
 
 static egg_secure_rec *
-records_for_ring (Cell *cell_ring,
-                  egg_secure_rec *records,
-                  unsigned int *count,
-                  unsigned int *total)
+records_for_block (Block *block,
+                   egg_secure_rec *records,
+                   unsigned int *count,
+                   unsigned int *allocated,
+                   unsigned int *total)
 {
 	egg_secure_rec *new_rec;
-	unsigned int allocated = *count;
 	Cell *cell;
 
-	cell = cell_ring;
-	do {
-		if (*count >= allocated) {
-			new_rec = realloc (records, sizeof (egg_secure_rec) * (allocated + 32));
+	/* Walk each cell in the block, both used and unused */
+#ifdef WITH_VALGRIND
+	VALGRIND_MAKE_MEM_DEFINED (block->words, sizeof (word_t));
+#endif
+	cell = *(block->words);
+	sec_check_guards (cell);
+
+	while (cell != NULL) {
+		if (*count >= *allocated) {
+			new_rec = realloc (records, sizeof (egg_secure_rec) * (*allocated + 32));
 			if (new_rec == NULL) {
 				*count = 0;
 				free (records);
 				return NULL;
 			} else {
 				records = new_rec;
-				allocated += 32;
+				*allocated += 32;
 			}
 		}
 
-		if (cell != NULL) {
-			records[*count].request_length = cell->requested;
-			records[*count].block_length = cell->n_words * sizeof (word_t);
-			records[*count].tag = cell->tag;
-			(*count)++;
-			(*total) += cell->n_words;
-			cell = cell->next;
-		}
-	} while (cell != NULL && cell != cell_ring);
+		/* Cells cached by a thread have no tag, and count as unused */
+		records[*count].request_length = cell->tag ? cell->requested : 0;
+		records[*count].block_length = cell->n_words * sizeof (word_t);
+		records[*count].tag = cell->tag;
+		(*count)++;
+		(*total) += cell->n_words;
+		cell = sec_neighbor_after (block, cell);
+	}
 
 	return records;
 }
@@ -1275,19 +2079,18 @@ egg_secure_records (unsigned int *count)
 {
 	egg_secure_rec *records = NULL;
 	Block *block = NULL;
+	unsigned int allocated = 0;
 	unsigned int total;
 
 	*count = 0;
 
 	DO_LOCK ();
+		magazine_lock_all ();
 
 		for (block = all_blocks; block != NULL; block = block->next) {
 			total = 0;
 
-			records = records_for_ring (block->unused_cells, records, count, &total);
-			if (records == NULL)
-				break;
-			records = records_for_ring (block->used_cells, records, count, &total);
+			records = records_for_block (block, records, count, &allocated, &total);
 			if (records == NULL)
 				break;
 
@@ -1295,6 +2098,7 @@ egg_secure_records (unsigned int *count)
 			ASSERT (total == block->n_words);
 		}
 
+		magazine_unlock_all ();
 	DO_UNLOCK ();
 
 	return records;
@@ -111,4 +111,20 @@ typedef struct {
 
 egg_secure_rec *   egg_secure_records    (unsigned int *count);
 
+/*
+ * Empty blocks of secure memory are retained, rather than unlocked and
+ * unmapped, as long as their total length stays within the reserve.
+ * Setting the reserve also frees the cells cached by every thread.
+ */
+void   egg_secure_set_reserve  (size_t length);
+
+typedef struct {
+	size_t n_blocks;              /* Blocks currently mapped */
+	size_t retained_length;       /* Length of empty blocks kept in reserve */
+	unsigned long pages_acquired; /* Times pages were mapped and locked */
+	unsigned long pages_released; /* Times pages were unlocked and unmapped */
+} egg_secure_stats;
+
+void   egg_secure_get_stats    (egg_secure_stats *stats);
+
 #endif /* EGG_SECURE_MEMORY_H */
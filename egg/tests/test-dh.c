@@ -186,6 +186,92 @@ test_default_bad (void)
 	g_assert (!ret);
 }
 
+static void
+test_pair_for_group (void)
+{
+	gcry_mpi_t p1, x1, X1;
+	gcry_mpi_t p2, x2, X2;
+	gpointer k1, k2;
+	gboolean ret;
+	gsize n1, n2;
+
+	/* Both use the same cached prime, but different pairs */
+	ret = egg_dh_gen_pair_for_group ("ietf-ike-grp-modp-768", &p1, &X1, &x1);
+	g_assert (ret);
+	ret = egg_dh_gen_pair_for_group ("ietf-ike-grp-modp-768", &p2, &X2, &x2);
+	g_assert (ret);
+	g_assert (gcry_mpi_cmp (p1, p2) == 0);
+	g_assert (gcry_mpi_cmp (X1, X2) != 0);
+
+	k1 = egg_dh_gen_secret (X2, x1, p1, &n1);
+	g_assert (k1);
+	k2 = egg_dh_gen_secret (X1, x2, p2, &n2);
+	g_assert (k2);
+
+	egg_assert_cmpsize (n1, ==, n2);
+	g_assert (memcmp (k1, k2, n1) == 0);
+
+	ret = egg_dh_gen_pair_for_group ("bad-name", &p1, &X1, &x1);
+	g_assert (!ret);
+
+	gcry_mpi_release (p1);
+	gcry_mpi_release (x1);
+	gcry_mpi_release (X1);
+	egg_secure_free (k1);
+	gcry_mpi_release (p2);
+	gcry_mpi_release (x2);
+	gcry_mpi_release (X2);
+	egg_secure_free (k2);
+}
+
+static void
+test_gen_pair_perf (void)
+{
+	const gchar *group = "ietf-ike-grp-modp-1024";
+	gconstpointer prime, base;
+	gsize n_prime, n_base;
+	gcry_mpi_t p, g, x, X;
+	gdouble scan, cached, generate;
+	gint i, count;
+
+	/* Parsing the parameters from bytes, as was done for every session */
+	count = 10000;
+	egg_dh_default_params_raw (group, &prime, &n_prime, &base, &n_base);
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		gcry_mpi_scan (&p, GCRYMPI_FMT_USG, prime, n_prime, NULL);
+		gcry_mpi_scan (&g, GCRYMPI_FMT_USG, base, n_base, NULL);
+		g_assert_cmpuint (gcry_mpi_get_nbits (p), ==, 1024);
+		gcry_mpi_release (p);
+		gcry_mpi_release (g);
+	}
+	scan = g_test_timer_elapsed () * 1000000 / count;
+
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		egg_dh_default_params (group, &p, &g);
+		gcry_mpi_release (p);
+		gcry_mpi_release (g);
+	}
+	cached = g_test_timer_elapsed () * 1000000 / count;
+
+	g_test_message ("params: %.3f us scanned, %.3f us cached", scan, cached);
+
+	/* Key generation with the cached parameters */
+	count = 100;
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		egg_dh_gen_pair_for_group (group, &p, &X, &x);
+		gcry_mpi_release (p);
+		gcry_mpi_release (X);
+		gcry_mpi_release (x);
+	}
+	generate = g_test_timer_elapsed () * 1000 / count;
+	g_test_message ("key generation: %.1f pairs/s", 1000 / generate);
+
+	g_test_minimized_result (generate, "key pair: %.3f ms", generate);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -194,8 +280,12 @@ main (int argc, char **argv)
 	if (!g_test_quick ()) {
 		g_test_add_func ("/dh/perform", test_perform);
 		g_test_add_func ("/dh/short_pair", test_short_pair);
+		g_test_add_func ("/dh/pair_for_group", test_pair_for_group);
 	}
 
+	if (g_test_perf ())
+		g_test_add_func ("/dh/gen_pair_perf", test_gen_pair_perf);
+
 	g_test_add_func ("/dh/default_768", test_default_768);
 	g_test_add_func ("/dh/default_1024", test_default_1024);
 	g_test_add_func ("/dh/default_1536", test_default_1536);
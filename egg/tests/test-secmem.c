@@ -27,6 +27,8 @@
 
 #include <glib.h>
 
+#include <sys/resource.h>
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -36,6 +38,7 @@ EGG_SECURE_GLIB_DEFINITIONS ();
 
 /* Declared in egg-secure-memory.c */
 extern int egg_secure_warnings;
+extern int egg_secure_linear_walk;
 
 EGG_SECURE_DECLARE (tests);
 
@@ -253,6 +256,287 @@ test_strclear (void)
 	egg_secure_free_full (str, 0);
 }
 
+static void
+test_reserve (void)
+{
+	egg_secure_stats before, after;
+	gpointer p;
+	int i;
+
+	egg_secure_get_stats (&before);
+
+	/* Empty blocks are retained, so pages are not acquired each time */
+	for (i = 0; i < 1000; i++) {
+		p = egg_secure_alloc_full ("tests", 64, 0);
+		g_assert (p != NULL);
+		egg_secure_free_full (p, 0);
+	}
+
+	egg_secure_get_stats (&after);
+	g_assert_cmpuint (after.pages_acquired - before.pages_acquired, <=, 1);
+	g_assert_cmpuint (after.n_blocks, >=, 1);
+
+	/* No reserve trims all the empty blocks, and the cached cells */
+	egg_secure_set_reserve (0);
+	egg_secure_get_stats (&after);
+	g_assert_cmpuint (after.n_blocks, ==, 0);
+	g_assert_cmpuint (after.retained_length, ==, 0);
+	g_assert_cmpuint (after.pages_released, ==, after.pages_acquired);
+}
+
+#ifdef HAVE_PTHREAD_KEYS
+
+static void
+test_cached_check (void)
+{
+	gpointer memory, again;
+
+	/* Small cells are cached by this thread when freed */
+	memory = egg_secure_alloc (16);
+	g_assert (egg_secure_check (memory));
+	egg_secure_free (memory);
+	g_assert (!egg_secure_check (memory));
+
+	/* And handed out again, cleared */
+	again = egg_secure_alloc (8);
+	g_assert (again != NULL);
+	g_assert (egg_secure_check (again));
+	g_assert_cmpuint (find_non_zero (again, 8), ==, G_MAXSIZE);
+	egg_secure_free (again);
+}
+
+static void
+test_cached_records (void)
+{
+	egg_secure_rec *records;
+	gpointer memory;
+	guint count, i;
+
+	/* A cached cell doesn't keep the tag and length it was freed with */
+	memory = egg_secure_alloc_full ("cached-one", 16, 0);
+	egg_secure_free_full (memory, 0);
+	memory = egg_secure_alloc_full ("cached-two", 24, 0);
+
+	records = egg_secure_records (&count);
+	g_assert (records != NULL);
+	for (i = 0; i < count; i++) {
+		g_assert_cmpstr (records[i].tag, !=, "cached-one");
+		if (g_strcmp0 (records[i].tag, "cached-two") == 0)
+			g_assert_cmpuint (records[i].request_length, ==, 24);
+		if (records[i].tag == NULL)
+			g_assert_cmpuint (records[i].request_length, ==, 0);
+	}
+	free (records);
+
+	egg_secure_free_full (memory, 0);
+}
+
+static gpointer
+reserve_thread_worker (gpointer data)
+{
+	GAsyncQueue *queue = data;
+	gpointer memory;
+
+	/* Leave a cell cached by this thread */
+	memory = egg_secure_alloc_full ("tests", 32, 0);
+	g_assert (memory != NULL);
+	egg_secure_free_full (memory, 0);
+
+	g_async_queue_push (queue, GINT_TO_POINTER (1));
+	g_async_queue_pop (queue);
+	return NULL;
+}
+
+static void
+test_reserve_threads (void)
+{
+	egg_secure_stats stats;
+	GAsyncQueue *queue;
+	GThread *thread;
+
+	queue = g_async_queue_new ();
+	thread = g_thread_new ("secmem", reserve_thread_worker, queue);
+	g_async_queue_pop (queue);
+
+	/* Still running, but its cached cell must not pin the block */
+	egg_secure_set_reserve (0);
+	egg_secure_get_stats (&stats);
+	g_assert_cmpuint (stats.n_blocks, ==, 0);
+
+	g_async_queue_push (queue, GINT_TO_POINTER (1));
+	g_thread_join (thread);
+	g_async_queue_unref (queue);
+
+	egg_secure_set_reserve (16384);
+}
+
+#endif /* HAVE_PTHREAD_KEYS */
+
+static gpointer
+stress_secure_alloc (gsize length)
+{
+	return egg_secure_alloc (length);
+}
+
+static gdouble
+stress_run (gpointer (*alloc) (gsize),
+            void (*release) (gpointer),
+            guint n_live)
+{
+	gpointer *memory;
+	gdouble elapsed;
+	guint i, index;
+
+	g_random_set_seed (15);
+	memory = g_new0 (gpointer, n_live);
+
+	g_test_timer_start ();
+
+	/* Lots of small live allocations, randomly freed and replaced */
+	for (i = 0; i < n_live; i++)
+		memory[i] = (alloc) (g_random_int_range (1, 128));
+	for (i = 0; i < 200000; i++) {
+		index = g_random_int_range (0, n_live);
+		(release) (memory[index]);
+		memory[index] = (alloc) (g_random_int_range (1, 128));
+		g_assert (memory[index] != NULL);
+	}
+	for (i = 0; i < n_live; i++)
+		(release) (memory[i]);
+
+	elapsed = g_test_timer_elapsed ();
+	g_free (memory);
+
+	return elapsed;
+}
+
+static void
+test_stress_perf (void)
+{
+	gdouble elapsed, linear;
+	guint n_live = 10000;
+
+	/* The same pattern, walking all unused cells like before the bins */
+	egg_secure_linear_walk = 1;
+	linear = stress_run (stress_secure_alloc, egg_secure_free, n_live);
+	egg_secure_linear_walk = 0;
+
+	elapsed = stress_run (stress_secure_alloc, egg_secure_free, n_live);
+
+	g_test_message ("linear walk: 200000 allocations with %u live in %6.3f seconds",
+	                n_live, linear);
+	g_test_minimized_result (elapsed, "200000 allocations with %u live in %6.3f seconds, "
+	                         "%.1f times faster than the linear walk", n_live, elapsed,
+	                         elapsed > 0 ? linear / elapsed : 0.0);
+}
+
+static guint
+blocks_within_memlock (guint wanted)
+{
+	struct rlimit rlim;
+	rlim_t blocks;
+
+	if (getrlimit (RLIMIT_MEMLOCK, &rlim) < 0 || rlim.rlim_cur == RLIM_INFINITY)
+		return wanted;
+
+	/* Each block is 16 KiB, leave room for blocks already in use */
+	blocks = rlim.rlim_cur / 16384;
+	blocks = blocks > 8 ? blocks - 8 : 0;
+	return MIN (wanted, blocks);
+}
+
+static gdouble
+blocks_check_run (gpointer *memory,
+                  guint n_blocks)
+{
+	guint i, round;
+
+	g_test_timer_start ();
+
+	for (round = 0; round < 10; round++) {
+		for (i = 0; i < n_blocks; i++)
+			g_assert (egg_secure_check (memory[i]));
+	}
+
+	return g_test_timer_elapsed ();
+}
+
+static void
+test_blocks_perf (void)
+{
+	gpointer *memory;
+	gdouble elapsed, linear;
+	guint n_blocks;
+	guint i;
+
+	/* Each of these allocations needs its own locked block */
+	n_blocks = blocks_within_memlock (10000);
+	memory = g_new0 (gpointer, n_blocks);
+
+	for (i = 0; i < n_blocks; i++) {
+		memory[i] = egg_secure_alloc_full ("tests", 16200, 0);
+		g_assert (memory[i] != NULL);
+	}
+
+	/* The same lookups, walking all blocks like before the index */
+	egg_secure_linear_walk = 1;
+	linear = blocks_check_run (memory, n_blocks);
+	egg_secure_linear_walk = 0;
+
+	elapsed = blocks_check_run (memory, n_blocks);
+
+	for (i = 0; i < n_blocks; i++)
+		egg_secure_free_full (memory[i], 0);
+
+	g_test_message ("linear walk: checked %u blocks 10 times in %6.3f seconds",
+	                n_blocks, linear);
+	g_test_minimized_result (elapsed, "checked %u blocks 10 times in %6.3f seconds, "
+	                         "%.1f times faster than the linear walk", n_blocks,
+	                         elapsed, elapsed > 0 ? linear / elapsed : 0.0);
+
+	g_free (memory);
+}
+
+static gpointer
+threads_perf_worker (gpointer unused)
+{
+	gpointer memory[4] = { NULL, };
+	gsize size;
+	int i;
+
+	for (i = 0; i < 100000; i++) {
+		egg_secure_free (memory[i % 4]);
+		size = g_random_int_range (1, 64);
+		memory[i % 4] = egg_secure_alloc (size);
+		g_assert (memory[i % 4] != NULL);
+		memset (memory[i % 4], 0xAA, size);
+	}
+
+	for (i = 0; i < 4; i++)
+		egg_secure_free (memory[i]);
+
+	return NULL;
+}
+
+static void
+test_threads_perf (void)
+{
+	GThread *threads[32];
+	gdouble elapsed;
+	int i;
+
+	g_test_timer_start ();
+
+	for (i = 0; i < G_N_ELEMENTS (threads); i++)
+		threads[i] = g_thread_new ("secmem", threads_perf_worker, NULL);
+	for (i = 0; i < G_N_ELEMENTS (threads); i++)
+		g_thread_join (threads[i]);
+
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "%d threads each did 100000 allocations in %6.3f seconds",
+	                         (int)G_N_ELEMENTS (threads), elapsed);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -265,6 +549,18 @@ main (int argc, char **argv)
 	g_test_add_func ("/secmem/multialloc", test_multialloc);
 	g_test_add_func ("/secmem/clear", test_clear);
 	g_test_add_func ("/secmem/strclear", test_strclear);
+	g_test_add_func ("/secmem/reserve", test_reserve);
+#ifdef HAVE_PTHREAD_KEYS
+	g_test_add_func ("/secmem/cached-check", test_cached_check);
+	g_test_add_func ("/secmem/cached-records", test_cached_records);
+	g_test_add_func ("/secmem/reserve-threads", test_reserve_threads);
+#endif
+
+	if (g_test_perf ()) {
+		g_test_add_func ("/secmem/stress-perf", test_stress_perf);
+		g_test_add_func ("/secmem/blocks-perf", test_blocks_perf);
+		g_test_add_func ("/secmem/threads-perf", test_threads_perf);
+	}
 
 	return g_test_run ();
 }
@@ -69,6 +69,9 @@ struct _SecretCollectionPrivate {
 	/* Protected by mutex */
 	GMutex mutex;
 	GHashTable *items;
+	GHashTable *items_creating;
+	GHashTable *item_deltas;
+	guint items_loading;
 };
 
 static GInitableIface *secret_collection_initable_parent_iface = NULL;
@@ -91,6 +94,13 @@ items_table_new (void)
 	                              g_free, g_object_unref);
 }
 
+static void
+item_delta_free (gpointer data)
+{
+	if (data != NULL)
+		g_object_unref (data);
+}
+
 static void
 secret_collection_init (SecretCollection *self)
 {
@@ -100,6 +110,9 @@ secret_collection_init (SecretCollection *self)
 	g_mutex_init (&self->pv->mutex);
 	self->pv->cancellable = g_cancellable_new ();
 	self->pv->items = items_table_new ();
+	self->pv->items_creating = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->pv->item_deltas = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                               g_free, item_delta_free);
 	self->pv->constructing = TRUE;
 }
 
@@ -201,6 +214,8 @@ secret_collection_finalize (GObject *obj)
 
 	g_mutex_clear (&self->pv->mutex);
 	g_hash_table_destroy (self->pv->items);
+	g_hash_table_destroy (self->pv->items_creating);
+	g_hash_table_destroy (self->pv->item_deltas);
 	g_object_unref (self->pv->cancellable);
 
 	G_OBJECT_CLASS (secret_collection_parent_class)->finalize (obj);
@@ -223,26 +238,83 @@ collection_lookup_item (SecretCollection *self,
 	return item;
 }
 
+static void
+collection_begin_items (SecretCollection *self)
+{
+	g_mutex_lock (&self->pv->mutex);
+	self->pv->items_loading++;
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+/* Pass NULL @items when loading failed */
 static void
 collection_update_items (SecretCollection *self,
                          GHashTable *items)
 {
-	GHashTable *previous;
+	GHashTable *previous = NULL;
+	GHashTableIter iter;
+	const gchar *path;
+	SecretItem *item;
 
-	g_hash_table_ref (items);
+	g_mutex_lock (&self->pv->mutex);
+
+	g_assert (self->pv->items_loading > 0);
+	self->pv->items_loading--;
+
+	/* Items created or deleted while loading are newer than what we loaded */
+	if (items != NULL) {
+		g_hash_table_iter_init (&iter, self->pv->item_deltas);
+		while (g_hash_table_iter_next (&iter, (gpointer *)&path, (gpointer *)&item)) {
+			if (item != NULL)
+				g_hash_table_insert (items, g_strdup (path), g_object_ref (item));
+			else
+				g_hash_table_remove (items, path);
+		}
+
+		previous = self->pv->items;
+		self->pv->items = g_hash_table_ref (items);
+	}
+
+	if (self->pv->items_loading == 0)
+		g_hash_table_remove_all (self->pv->item_deltas);
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (previous != NULL)
+		g_hash_table_unref (previous);
+}
+
+/* Whether the Items property agrees with what we track from signals */
+static gboolean
+collection_items_match (SecretCollection *self,
+                        GVariant *paths)
+{
+	GVariantIter iter;
+	const gchar *path;
+	gboolean match = TRUE;
+	guint count = 0;
 
 	g_mutex_lock (&self->pv->mutex);
-	previous = self->pv->items;
-	self->pv->items = items;
+
+	g_variant_iter_init (&iter, paths);
+	while (match && g_variant_iter_next (&iter, "&o", &path)) {
+		if (g_hash_table_lookup (self->pv->items, path))
+			count++;
+		else if (!g_hash_table_lookup (self->pv->items_creating, path))
+			match = FALSE;
+	}
+
+	if (count != g_hash_table_size (self->pv->items))
+		match = FALSE;
+
 	g_mutex_unlock (&self->pv->mutex);
 
-	g_hash_table_unref (previous);
+	return match;
 }
 
 typedef struct {
 	GCancellable *cancellable;
 	GHashTable *items;
-	gint items_loading;
 } ItemsClosure;
 
 static void
@@ -255,33 +327,33 @@ items_closure_free (gpointer data)
 }
 
 static void
-on_load_item (GObject *source,
-              GAsyncResult *result,
-              gpointer user_data)
+on_load_items (GObject *source,
+               GAsyncResult *result,
+               gpointer user_data)
 {
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	ItemsClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	SecretCollection *self = SECRET_COLLECTION (g_async_result_get_source_object (user_data));
-	const gchar *path;
 	GError *error = NULL;
+	GHashTableIter iter;
+	GHashTable *items;
+	const gchar *path;
 	SecretItem *item;
 
-	closure->items_loading--;
-
-	item = secret_item_new_finish (result, &error);
+	items = _secret_item_load_paths_finish (result, &error);
 
 	if (error != NULL)
 		g_simple_async_result_take_error (res, error);
 
-	if (item != NULL) {
-		path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (item));
-		g_hash_table_insert (closure->items, g_strdup (path), item);
+	if (items != NULL) {
+		g_hash_table_iter_init (&iter, items);
+		while (g_hash_table_iter_next (&iter, (gpointer *)&path, (gpointer *)&item))
+			g_hash_table_insert (closure->items, g_strdup (path), g_object_ref (item));
+		g_hash_table_unref (items);
 	}
 
-	if (closure->items_loading == 0) {
-		collection_update_items (self, closure->items);
-		g_simple_async_result_complete_in_idle (res);
-	}
+	collection_update_items (self, closure->items);
+	g_simple_async_result_complete (res);
 
 	g_object_unref (self);
 	g_object_unref (res);
@@ -297,6 +369,7 @@ collection_load_items_async (SecretCollection *self,
 	SecretItem *item;
 	GSimpleAsyncResult *res;
 	const gchar *path;
+	GPtrArray *missing;
 	GVariant *paths;
 	GVariantIter iter;
 
@@ -310,26 +383,30 @@ collection_load_items_async (SecretCollection *self,
 	closure->items = items_table_new ();
 	g_simple_async_result_set_op_res_gpointer (res, closure, items_closure_free);
 
+	collection_begin_items (self);
+	missing = g_ptr_array_new ();
+
 	g_variant_iter_init (&iter, paths);
-	while (g_variant_iter_loop (&iter, "&o", &path)) {
+	while (g_variant_iter_next (&iter, "&o", &path)) {
 		item = collection_lookup_item (self, path);
 
-		/* No such collection yet create a new one */
-		if (item == NULL) {
-			secret_item_new (self->pv->service, path, cancellable,
-			                 on_load_item, g_object_ref (res));
-			closure->items_loading++;
-
-		} else {
+		/* No such item yet, load it below with the others */
+		if (item == NULL)
+			g_ptr_array_add (missing, (gpointer)path);
+		else
 			g_hash_table_insert (closure->items, g_strdup (path), item);
-		}
 	}
 
-	if (closure->items_loading == 0) {
+	if (missing->len > 0) {
+		g_ptr_array_add (missing, NULL);
+		_secret_item_load_paths (self->pv->service, (const gchar **)missing->pdata,
+		                         cancellable, on_load_items, g_object_ref (res));
+	} else {
 		collection_update_items (self, closure->items);
 		g_simple_async_result_complete_in_idle (res);
 	}
 
+	g_ptr_array_free (missing, TRUE);
 	g_variant_unref (paths);
 	g_object_unref (res);
 }
@@ -345,14 +422,20 @@ collection_load_items_finish (SecretCollection *self,
 	return TRUE;
 }
 
-
-static gboolean
-collection_load_items_sync (SecretCollection *self,
-                            GCancellable *cancellable,
-                            GError **error)
+/*
+ * Load the whole table of items again from the Items property, which is
+ * what we did on every change before following the item signals.
+ */
+gboolean
+_secret_collection_load_items_sync (SecretCollection *self,
+                                    GCancellable *cancellable,
+                                    GError **error)
 {
 	SecretItem *item;
 	GHashTable *items;
+	GHashTable *loaded;
+	GHashTableIter hiter;
+	GPtrArray *missing;
 	GVariant *paths;
 	GVariantIter iter;
 	const gchar *path;
@@ -362,27 +445,38 @@ collection_load_items_sync (SecretCollection *self,
 	g_return_val_if_fail (paths != NULL, FALSE);
 
 	items = items_table_new ();
+	collection_begin_items (self);
+	missing = g_ptr_array_new ();
 
 	g_variant_iter_init (&iter, paths);
 	while (g_variant_iter_next (&iter, "&o", &path)) {
 		item = collection_lookup_item (self, path);
 
-		/* No such collection yet create a new one */
-		if (item == NULL) {
-			item = secret_item_new_sync (self->pv->service, path,
-			                             cancellable, error);
-			if (item == NULL) {
-				ret = FALSE;
-				break;
-			}
-		}
+		/* No such item yet, load it below with the others */
+		if (item == NULL)
+			g_ptr_array_add (missing, (gpointer)path);
+		else
+			g_hash_table_insert (items, g_strdup (path), item);
+	}
 
-		g_hash_table_insert (items, g_strdup (path), item);
+	if (missing->len > 0) {
+		g_ptr_array_add (missing, NULL);
+		loaded = _secret_item_load_paths_sync (self->pv->service,
+		                                       (const gchar **)missing->pdata,
+		                                       cancellable, error);
+		if (loaded == NULL) {
+			ret = FALSE;
+		} else {
+			g_hash_table_iter_init (&hiter, loaded);
+			while (g_hash_table_iter_next (&hiter, (gpointer *)&path, (gpointer *)&item))
+				g_hash_table_insert (items, g_strdup (path), g_object_ref (item));
+			g_hash_table_unref (loaded);
+		}
 	}
 
-	if (ret)
-		collection_update_items (self, items);
+	collection_update_items (self, ret ? items : NULL);
 
+	g_ptr_array_free (missing, TRUE);
 	g_hash_table_unref (items);
 	g_variant_unref (paths);
 	return ret;
@@ -405,10 +499,121 @@ handle_property_changed (SecretCollection *self,
 	else if (g_str_equal (property_name, "Modified"))
 		g_object_notify (G_OBJECT (self), "modified");
 
-	else if (g_str_equal (property_name, "Items") && !self->pv->constructing)
+	/* Only reload when the item signals haven't already told us the same */
+	else if (g_str_equal (property_name, "Items") && !self->pv->constructing &&
+	         !collection_items_match (self, value))
 		collection_load_items_async (self, self->pv->cancellable, NULL, NULL);
 }
 
+static void
+on_item_created (GObject *source,
+                 GAsyncResult *result,
+                 gpointer user_data)
+{
+	SecretCollection *self = SECRET_COLLECTION (user_data);
+	gchar *path = NULL;
+	GError *error = NULL;
+	SecretItem *item;
+	gboolean added = FALSE;
+
+	item = secret_item_new_finish (result, &error);
+
+	if (item != NULL) {
+		path = g_strdup (g_dbus_proxy_get_object_path (G_DBUS_PROXY (item)));
+
+		/* Not added if it was deleted again while we were loading it */
+		g_mutex_lock (&self->pv->mutex);
+		if (g_hash_table_remove (self->pv->items_creating, path)) {
+			if (!g_hash_table_lookup (self->pv->items, path)) {
+				g_hash_table_insert (self->pv->items, g_strdup (path), g_object_ref (item));
+				added = TRUE;
+			}
+			if (self->pv->items_loading > 0)
+				g_hash_table_insert (self->pv->item_deltas, g_strdup (path), g_object_ref (item));
+		}
+		g_mutex_unlock (&self->pv->mutex);
+
+		if (added)
+			g_object_notify (G_OBJECT (self), "items");
+		g_object_unref (item);
+
+	/* Couldn't load the item, so go back to loading them all */
+	} else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		collection_load_items_async (self, self->pv->cancellable, NULL, NULL);
+	}
+
+	g_free (path);
+	g_clear_error (&error);
+	g_object_unref (self);
+}
+
+static void
+collection_item_created (SecretCollection *self,
+                         const gchar *item_path)
+{
+	gboolean create;
+	gchar *path;
+
+	if (self->pv->service == NULL)
+		return;
+
+	g_mutex_lock (&self->pv->mutex);
+	create = !g_hash_table_lookup (self->pv->items, item_path) &&
+	         !g_hash_table_lookup (self->pv->items_creating, item_path);
+	if (create) {
+		path = g_strdup (item_path);
+		g_hash_table_insert (self->pv->items_creating, path, path);
+	}
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (create)
+		secret_item_new (self->pv->service, item_path, self->pv->cancellable,
+		                 on_item_created, g_object_ref (self));
+}
+
+static void
+collection_item_deleted (SecretCollection *self,
+                         const gchar *item_path)
+{
+	gboolean removed;
+
+	g_mutex_lock (&self->pv->mutex);
+	removed = g_hash_table_remove (self->pv->items, item_path);
+	g_hash_table_remove (self->pv->items_creating, item_path);
+	if (self->pv->items_loading > 0)
+		g_hash_table_insert (self->pv->item_deltas, g_strdup (item_path), NULL);
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (removed)
+		g_object_notify (G_OBJECT (self), "items");
+}
+
+static void
+secret_collection_signal (GDBusProxy *proxy,
+                          const gchar *sender_name,
+                          const gchar *signal_name,
+                          GVariant *parameters)
+{
+	SecretCollection *self = SECRET_COLLECTION (proxy);
+	const gchar *item_path;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(o)")))
+		return;
+
+	/*
+	 * Apply the change to our table of items, rather than loading the
+	 * whole Items property again.
+	 */
+	g_variant_get (parameters, "(&o)", &item_path);
+
+	if (g_str_equal (signal_name, "ItemCreated") ||
+	    g_str_equal (signal_name, "ItemChanged"))
+		collection_item_created (self, item_path);
+
+	else if (g_str_equal (signal_name, "ItemDeleted"))
+		collection_item_deleted (self, item_path);
+}
+
 static void
 secret_collection_properties_changed (GDBusProxy *proxy,
                                       GVariant *changed_properties,
@@ -440,6 +645,7 @@ secret_collection_class_init (SecretCollectionClass *klass)
 	gobject_class->finalize = secret_collection_finalize;
 
 	proxy_class->g_properties_changed = secret_collection_properties_changed;
+	proxy_class->g_signal = secret_collection_signal;
 
 	/**
 	 * SecretCollection:service:
@@ -517,6 +723,9 @@ secret_collection_initable_init (GInitable *initable,
 	SecretCollection *self;
 	GDBusProxy *proxy;
 
+	/* Signals for the proxy are delivered in the current context */
+	_secret_sync_retain_context ();
+
 	if (!secret_collection_initable_parent_iface->init (initable, cancellable, error))
 		return FALSE;
 
@@ -531,7 +740,7 @@ secret_collection_initable_init (GInitable *initable,
 
 	self = SECRET_COLLECTION (initable);
 
-	if (!collection_load_items_sync (self, cancellable, error))
+	if (!_secret_collection_load_items_sync (self, cancellable, error))
 		return FALSE;
 
 	return TRUE;
@@ -619,6 +828,8 @@ secret_collection_async_initable_init_async (GAsyncInitable *initable,
 	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
 	g_simple_async_result_set_op_res_gpointer (res, closure, init_closure_free);
 
+	_secret_sync_retain_context ();
+
 	secret_collection_async_initable_parent_iface->init_async (initable, io_priority,
 	                                                           cancellable,
 	                                                           on_init_base,
@@ -22,6 +22,9 @@
 
 #include <glib/gi18n-lib.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 /**
  * SECTION:secret-item
  * @title: SecretItem
@@ -72,9 +75,22 @@ enum {
 };
 
 /* Thread safe: no changes between construct and finalize */
+typedef struct {
+	const gchar *name;
+	const gchar *value;
+} AttributeEntry;
+
 typedef struct _SecretItemPrivate {
 	SecretService *service;
 	GCancellable *cancellable;
+	guint properties_changed_sig;
+
+	/* A sorted view into the cached Attributes, protected by mutex */
+	GMutex mutex;
+	GVariant *attributes;
+	AttributeEntry *attribute_view;
+	gsize n_attribute_view;
+	GSList *attributes_retired;
 } SecretItemPrivate;
 
 static GInitableIface *secret_item_initable_parent_iface = NULL;
@@ -95,6 +111,7 @@ secret_item_init (SecretItem *self)
 {
 	self->pv = G_TYPE_INSTANCE_GET_PRIVATE (self, SECRET_TYPE_ITEM, SecretItemPrivate);
 	self->pv->cancellable = g_cancellable_new ();
+	g_mutex_init (&self->pv->mutex);
 }
 
 static void
@@ -218,11 +235,28 @@ secret_item_finalize (GObject *obj)
 		g_object_remove_weak_pointer (G_OBJECT (self->pv->service),
 		                              (gpointer *)&self->pv->service);
 
+	if (self->pv->properties_changed_sig)
+		g_dbus_connection_signal_unsubscribe (g_dbus_proxy_get_connection (G_DBUS_PROXY (self)),
+		                                      self->pv->properties_changed_sig);
+
 	g_object_unref (self->pv->cancellable);
 
+	if (self->pv->attributes)
+		g_variant_unref (self->pv->attributes);
+	g_free (self->pv->attribute_view);
+	g_slist_free_full (self->pv->attributes_retired, (GDestroyNotify)g_variant_unref);
+	g_mutex_clear (&self->pv->mutex);
+
 	G_OBJECT_CLASS (secret_item_parent_class)->finalize (obj);
 }
 
+static void
+item_invalidate_lookups (SecretItem *self)
+{
+	if (self->pv->service)
+		_secret_service_cache_invalidate (self->pv->service);
+}
+
 static void
 handle_property_changed (GObject *object,
                          const gchar *property_name)
@@ -367,6 +401,9 @@ secret_item_initable_init (GInitable *initable,
 {
 	GDBusProxy *proxy;
 
+	/* Signals for the proxy are delivered in the current context */
+	_secret_sync_retain_context ();
+
 	if (!secret_item_initable_parent_iface->init (initable, cancellable, error))
 		return FALSE;
 
@@ -426,6 +463,8 @@ secret_item_async_initable_init_async (GAsyncInitable *initable,
 	res = g_simple_async_result_new (G_OBJECT (initable), callback, user_data,
 	                                 secret_item_async_initable_init_async);
 
+	_secret_sync_retain_context ();
+
 	secret_item_async_initable_parent_iface->init_async (initable, io_priority,
 	                                                     cancellable,
 	                                                     on_init_base,
@@ -567,6 +606,479 @@ secret_item_new_sync (SecretService *service,
 	                       NULL);
 }
 
+static void
+on_item_properties_changed (GDBusConnection *connection,
+                            const gchar *sender_name,
+                            const gchar *object_path,
+                            const gchar *interface_name,
+                            const gchar *signal_name,
+                            GVariant *parameters,
+                            gpointer user_data)
+{
+	SecretItem **weak = user_data;
+	GDBusProxy *proxy;
+	const gchar *property_interface;
+	const gchar **invalidated;
+	GVariant *changed;
+	GVariantIter iter;
+	GVariant *value;
+	gchar *key;
+	guint i;
+
+	/* Already queued when the item went away */
+	if (*weak == NULL)
+		return;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sa{sv}as)")))
+		return;
+
+	proxy = G_DBUS_PROXY (*weak);
+	g_variant_get (parameters, "(&s@a{sv}^a&s)", &property_interface,
+	               &changed, &invalidated);
+
+	if (g_str_equal (property_interface, SECRET_ITEM_INTERFACE)) {
+		g_variant_iter_init (&iter, changed);
+		while (g_variant_iter_loop (&iter, "{sv}", &key, &value))
+			g_dbus_proxy_set_cached_property (proxy, key, value);
+		for (i = 0; invalidated[i] != NULL; i++)
+			g_dbus_proxy_set_cached_property (proxy, invalidated[i], NULL);
+		g_signal_emit_by_name (proxy, "g-properties-changed", changed, invalidated);
+	}
+
+	g_variant_unref (changed);
+	g_free (invalidated);
+}
+
+static void
+item_weak_free (gpointer data)
+{
+	SecretItem **weak = data;
+
+	if (*weak != NULL)
+		g_object_remove_weak_pointer (G_OBJECT (*weak), (gpointer *)weak);
+	g_free (weak);
+}
+
+/* Called once the item is built, in the context it belongs to */
+static void
+item_watch_properties (SecretItem *item)
+{
+	GDBusProxy *proxy = G_DBUS_PROXY (item);
+	SecretItem **weak;
+
+	/* A signal that's already queued may be delivered after the item is gone */
+	weak = g_new (SecretItem *, 1);
+	*weak = item;
+	g_object_add_weak_pointer (G_OBJECT (item), (gpointer *)weak);
+
+	/* GDBusProxy only tracks property changes when it loads properties */
+	item->pv->properties_changed_sig =
+		g_dbus_connection_signal_subscribe (g_dbus_proxy_get_connection (proxy),
+		                                    g_dbus_proxy_get_name (proxy),
+		                                    SECRET_PROPERTIES_INTERFACE,
+		                                    "PropertiesChanged",
+		                                    g_dbus_proxy_get_object_path (proxy),
+		                                    SECRET_ITEM_INTERFACE,
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    on_item_properties_changed,
+		                                    weak, item_weak_free);
+	_secret_sync_retain_context ();
+}
+
+/* A new item with properties we already have */
+static SecretItem *
+item_new_for_properties (SecretService *service,
+                         const gchar *item_path,
+                         GVariant *properties)
+{
+	GDBusProxy *proxy;
+	SecretItem *item;
+	GVariantIter *iter;
+	GVariant *value;
+	gchar *key;
+
+	proxy = G_DBUS_PROXY (service);
+
+	/*
+	 * Use the well known name like the service does, so the item keeps
+	 * working when the service restarts. The proxy isn't initialized: that
+	 * would look up the owner of the name once for each item, and we don't
+	 * need it to load properties or subscribe to signals. Method calls go
+	 * to the well known name.
+	 */
+	item = g_object_new (SECRET_SERVICE_GET_CLASS (service)->item_gtype,
+	                     "g-flags", G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+	                                G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+	                     "g-interface-info", _secret_gen_item_interface_info (),
+	                     "g-name", g_dbus_proxy_get_name (proxy),
+	                     "g-connection", g_dbus_proxy_get_connection (proxy),
+	                     "g-object-path", item_path,
+	                     "g-interface-name", SECRET_ITEM_INTERFACE,
+	                     "service", service,
+	                     NULL);
+
+	g_variant_get (properties, "(a{sv})", &iter);
+	while (g_variant_iter_loop (iter, "{sv}", &key, &value))
+		g_dbus_proxy_set_cached_property (G_DBUS_PROXY (item), key, value);
+	g_variant_iter_free (iter);
+
+	item_watch_properties (item);
+	return item;
+}
+
+typedef struct {
+	GCancellable *cancellable;
+	gchar *name_owner;
+	gboolean construct;
+	GHashTable *items;
+	GHashTable *properties;
+	gint loading;
+} LoadClosure;
+
+static void
+load_closure_free (gpointer data)
+{
+	LoadClosure *closure = data;
+	g_clear_object (&closure->cancellable);
+	g_free (closure->name_owner);
+	g_hash_table_unref (closure->items);
+	g_hash_table_unref (closure->properties);
+	g_slice_free (LoadClosure, closure);
+}
+
+typedef struct {
+	GSimpleAsyncResult *res;
+	gchar *path;
+} LoadCall;
+
+static void
+load_call_free (LoadCall *call)
+{
+	g_object_unref (call->res);
+	g_free (call->path);
+	g_slice_free (LoadCall, call);
+}
+
+static void
+load_take_item (LoadClosure *closure,
+                SecretItem *item)
+{
+	const gchar *path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (item));
+	g_hash_table_insert (closure->items, g_strdup (path), item);
+}
+
+static void
+on_load_item_new (GObject *source,
+                  GAsyncResult *result,
+                  gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LoadClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GError *error = NULL;
+	SecretItem *item;
+
+	item = secret_item_new_finish (result, &error);
+	if (item != NULL)
+		load_take_item (closure, item);
+	else
+		g_simple_async_result_take_error (res, error);
+
+	if (--closure->loading == 0)
+		g_simple_async_result_complete (res);
+
+	g_object_unref (res);
+}
+
+static void
+on_load_get_all (GObject *source,
+                 GAsyncResult *result,
+                 gpointer user_data)
+{
+	LoadCall *call = user_data;
+	LoadClosure *closure = g_simple_async_result_get_op_res_gpointer (call->res);
+	SecretService *service;
+	GError *error = NULL;
+	SecretItem *item;
+	GVariant *retval;
+
+	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+
+	/* Build the item now, we're in the caller's main context */
+	if (retval != NULL && closure->construct) {
+		service = SECRET_SERVICE (g_async_result_get_source_object (G_ASYNC_RESULT (call->res)));
+		item = item_new_for_properties (service, call->path, retval);
+		load_take_item (closure, item);
+		g_object_unref (service);
+
+	/* Sync callers build the items themselves, once back in their context */
+	} else if (retval != NULL) {
+		g_hash_table_insert (closure->properties, call->path, g_variant_ref (retval));
+		call->path = NULL;
+
+	/* Fall back to loading this item the normal way, for a proper error */
+	} else if (closure->construct) {
+		service = SECRET_SERVICE (g_async_result_get_source_object (G_ASYNC_RESULT (call->res)));
+		secret_item_new (service, call->path, closure->cancellable,
+		                 on_load_item_new, g_object_ref (call->res));
+		closure->loading++;
+		g_object_unref (service);
+		g_error_free (error);
+
+	} else {
+		g_error_free (error);
+	}
+
+	if (retval != NULL)
+		g_variant_unref (retval);
+
+	if (--closure->loading == 0)
+		g_simple_async_result_complete (call->res);
+
+	load_call_free (call);
+}
+
+static void
+items_load_async (SecretService *service,
+                  const gchar **paths,
+                  gboolean construct,
+                  GCancellable *cancellable,
+                  GAsyncReadyCallback callback,
+                  gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	LoadClosure *closure;
+	const gchar *bus_name;
+	LoadCall *call;
+	guint i;
+
+	res = g_simple_async_result_new (G_OBJECT (service), callback, user_data,
+	                                 items_load_async);
+	closure = g_slice_new0 (LoadClosure);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	closure->name_owner = g_dbus_proxy_get_name_owner (G_DBUS_PROXY (service));
+	closure->construct = construct;
+	closure->items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	closure->properties = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+	                                             (GDestroyNotify)g_variant_unref);
+	g_simple_async_result_set_op_res_gpointer (res, closure, load_closure_free);
+
+	/* One extra, so we don't complete while still sending requests */
+	closure->loading = 1;
+
+	/* Properties alone can be requested from the well known name */
+	bus_name = closure->name_owner;
+	if (bus_name == NULL && !construct)
+		bus_name = g_dbus_proxy_get_name (G_DBUS_PROXY (service));
+
+	for (i = 0; paths[i] != NULL; i++) {
+
+		/* Without a name owner, fall back to loading each item on its own */
+		if (bus_name == NULL) {
+			secret_item_new (service, paths[i], cancellable,
+			                 on_load_item_new, g_object_ref (res));
+			closure->loading++;
+			continue;
+		}
+
+		/* Send all the requests at once, without waiting for replies */
+		call = g_slice_new0 (LoadCall);
+		call->res = g_object_ref (res);
+		call->path = g_strdup (paths[i]);
+
+		g_dbus_connection_call (g_dbus_proxy_get_connection (G_DBUS_PROXY (service)),
+		                        bus_name, paths[i],
+		                        SECRET_PROPERTIES_INTERFACE, "GetAll",
+		                        g_variant_new ("(s)", SECRET_ITEM_INTERFACE),
+		                        G_VARIANT_TYPE ("(a{sv})"),
+		                        G_DBUS_CALL_FLAGS_NONE, -1,
+		                        cancellable, on_load_get_all, call);
+		closure->loading++;
+	}
+
+	if (--closure->loading == 0)
+		g_simple_async_result_complete_in_idle (res);
+
+	g_object_unref (res);
+}
+
+/**
+ * _secret_item_load_paths:
+ * @service: the secret service
+ * @paths: a %NULL terminated array of item paths
+ * @cancellable: optional cancellation object
+ * @callback: called when the operation completes
+ * @user_data: data to be passed to the callback
+ *
+ * Create item proxies for many item paths at once. The properties of all the
+ * items are requested in one burst, and used to populate the new proxies,
+ * instead of each proxy separately looking up the owner of the service bus
+ * name and loading its own properties. If the owner isn't known, each item
+ * is loaded separately.
+ */
+void
+_secret_item_load_paths (SecretService *service,
+                         const gchar **paths,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (service));
+	g_return_if_fail (paths != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	items_load_async (service, paths, TRUE, cancellable, callback, user_data);
+}
+
+/**
+ * _secret_item_load_paths_finish:
+ * @result: the asynchronous result passed to the callback
+ * @error: location to place an error on failure
+ *
+ * Complete an operation to load many items.
+ *
+ * Returns: (transfer full): a table of item paths to the new #SecretItem
+ *          proxies, or %NULL if any item couldn't be loaded
+ */
+GHashTable *
+_secret_item_load_paths_finish (GAsyncResult *result,
+                                GError **error)
+{
+	GSimpleAsyncResult *res;
+	LoadClosure *closure;
+
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	res = G_SIMPLE_ASYNC_RESULT (result);
+	if (g_simple_async_result_propagate_error (res, error))
+		return NULL;
+
+	closure = g_simple_async_result_get_op_res_gpointer (res);
+	return g_hash_table_ref (closure->items);
+}
+
+/**
+ * _secret_item_load_properties:
+ * @service: the secret service
+ * @paths: a %NULL terminated array of item paths
+ * @cancellable: optional cancellation object
+ * @callback: called when the operation completes
+ * @user_data: data to be passed to the callback
+ *
+ * Retrieve the properties of many items at once, without creating any
+ * item proxies. Items whose properties couldn't be retrieved, for example
+ * because they were deleted in the meantime, are left out of the result.
+ */
+void
+_secret_item_load_properties (SecretService *service,
+                              const gchar **paths,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (service));
+	g_return_if_fail (paths != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	items_load_async (service, paths, FALSE, cancellable, callback, user_data);
+}
+
+/**
+ * _secret_item_load_properties_finish:
+ * @result: the asynchronous result passed to the callback
+ * @error: location to place an error on failure
+ *
+ * Complete an operation to retrieve the properties of many items.
+ *
+ * Returns: (transfer full): a table of item paths to their properties, each
+ *          a GVariant of type (a{sv})
+ */
+GHashTable *
+_secret_item_load_properties_finish (GAsyncResult *result,
+                                     GError **error)
+{
+	GSimpleAsyncResult *res;
+	LoadClosure *closure;
+
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	res = G_SIMPLE_ASYNC_RESULT (result);
+	if (g_simple_async_result_propagate_error (res, error))
+		return NULL;
+
+	closure = g_simple_async_result_get_op_res_gpointer (res);
+	return g_hash_table_ref (closure->properties);
+}
+
+/**
+ * _secret_item_load_paths_sync:
+ * @service: the secret service
+ * @paths: a %NULL terminated array of item paths
+ * @cancellable: optional cancellation object
+ * @error: location to place an error on failure
+ *
+ * Create item proxies for many item paths at once. See
+ * _secret_item_load_paths() for details.
+ *
+ * Returns: (transfer full): a table of item paths to the new #SecretItem
+ *          proxies, or %NULL if any item couldn't be loaded
+ */
+GHashTable *
+_secret_item_load_paths_sync (SecretService *service,
+                              const gchar **paths,
+                              GCancellable *cancellable,
+                              GError **error)
+{
+	LoadClosure *closure;
+	GHashTable *items;
+	SecretSync *sync;
+	GVariant *properties;
+	SecretItem *item;
+	guint i;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (service), NULL);
+	g_return_val_if_fail (paths != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	items_load_async (service, paths, FALSE, cancellable,
+	                  _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	g_main_context_pop_thread_default (sync->context);
+
+	/*
+	 * Build the proxies back in the caller's main context, so that they
+	 * receive their signals there. Anything that failed is loaded the
+	 * normal way, which gives us a proper error.
+	 */
+	closure = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (sync->result));
+	items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+	for (i = 0; paths[i] != NULL; i++) {
+		properties = NULL;
+		if (closure->name_owner != NULL)
+			properties = g_hash_table_lookup (closure->properties, paths[i]);
+		if (properties != NULL)
+			item = item_new_for_properties (service, paths[i], properties);
+		else
+			item = secret_item_new_sync (service, paths[i], cancellable, error);
+		if (item == NULL) {
+			g_hash_table_unref (items);
+			items = NULL;
+			break;
+		}
+		g_hash_table_insert (items, g_strdup (paths[i]), item);
+	}
+
+	_secret_sync_free (sync);
+
+	return items;
+}
+
 /**
  * secret_item_refresh:
  * @self: the collection
@@ -966,17 +1478,24 @@ secret_item_delete_sync (SecretItem *self,
 typedef struct {
 	GCancellable *cancellable;
 	SecretValue *value;
+	SecretSession *session;
+	gboolean retried;
 } GetClosure;
 
 static void
 get_closure_free (gpointer data)
 {
 	GetClosure *closure = data;
+	_secret_session_unref (closure->session);
 	g_clear_object (&closure->cancellable);
 	secret_value_unref (closure->value);
 	g_slice_free (GetClosure, closure);
 }
 
+static void          on_get_ensure_session       (GObject *source,
+                                                  GAsyncResult *result,
+                                                  gpointer user_data);
+
 static void
 on_item_get_secret (GObject *source,
                     GAsyncResult *result,
@@ -985,18 +1504,30 @@ on_item_get_secret (GObject *source,
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	SecretItem *self = SECRET_ITEM (g_async_result_get_source_object (user_data));
 	GetClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
-	SecretSession *session;
 	GError *error = NULL;
 	GVariant *retval;
 	GVariant *child;
 
 	retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), result, &error);
+
+	/* The service lost our session, open a new one and try again once */
+	if (_secret_util_is_session_error (error) && !closure->retried) {
+		closure->retried = TRUE;
+		g_clear_error (&error);
+		_secret_service_reset_session (self->pv->service, closure->session);
+		_secret_session_unref (closure->session);
+		closure->session = NULL;
+		secret_service_ensure_session (self->pv->service, closure->cancellable,
+		                               on_get_ensure_session, res);
+		g_object_unref (self);
+		return;
+	}
+
 	if (error == NULL) {
 		child = g_variant_get_child_value (retval, 0);
 		g_variant_unref (retval);
 
-		session = _secret_service_get_session (self->pv->service);
-		closure->value = _secret_session_decode_secret (session, child);
+		closure->value = _secret_session_decode_secret (closure->session, child);
 		g_variant_unref (child);
 
 		if (closure->value == NULL)
@@ -1019,18 +1550,16 @@ on_get_ensure_session (GObject *source,
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	SecretItem *self = SECRET_ITEM (g_async_result_get_source_object (user_data));
 	GetClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
-	const gchar *session_path;
 	GError *error = NULL;
 
-	session_path = secret_service_ensure_session_finish (self->pv->service, result, &error);
+	closure->session = _secret_service_ensure_session_take (self->pv->service, result, &error);
 	if (error != NULL) {
 		g_simple_async_result_take_error (res, error);
 		g_simple_async_result_complete (res);
 
 	} else {
-		g_assert (session_path != NULL && session_path[0] != '\0');
 		g_dbus_proxy_call (G_DBUS_PROXY (self), "GetSecret",
-		                   g_variant_new ("(o)", session_path),
+		                   g_variant_new ("(o)", _secret_session_get_path (closure->session)),
 		                   G_DBUS_CALL_FLAGS_NONE, -1, closure->cancellable,
 		                   on_item_get_secret, g_object_ref (res));
 	}
@@ -1157,33 +1686,56 @@ secret_item_get_secret_sync (SecretItem *self,
 typedef struct {
 	GCancellable *cancellable;
 	SecretValue *value;
+	SecretSession *session;
+	gboolean retried;
 } SetClosure;
 
 static void
 set_closure_free (gpointer data)
 {
-	GetClosure *closure = data;
+	SetClosure *closure = data;
+	_secret_session_unref (closure->session);
 	g_clear_object (&closure->cancellable);
 	secret_value_unref (closure->value);
-	g_slice_free (GetClosure, closure);
+	g_slice_free (SetClosure, closure);
 }
 
+static void          on_set_ensure_session       (GObject *source,
+                                                  GAsyncResult *result,
+                                                  gpointer user_data);
+
 static void
 on_item_set_secret (GObject *source,
                     GAsyncResult *result,
                     gpointer user_data)
 {
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	SecretItem *self = SECRET_ITEM (source);
+	SetClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	GError *error = NULL;
 	GVariant *retval;
 
 	retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), result, &error);
 
+	/* The service lost our session, open a new one and try again once */
+	if (_secret_util_is_session_error (error) && !closure->retried) {
+		closure->retried = TRUE;
+		g_clear_error (&error);
+		_secret_service_reset_session (self->pv->service, closure->session);
+		_secret_session_unref (closure->session);
+		closure->session = NULL;
+		secret_service_ensure_session (self->pv->service, closure->cancellable,
+		                               on_set_ensure_session, res);
+		return;
+	}
+
 	if (error != NULL)
 		g_simple_async_result_take_error (res, error);
 	if (retval != NULL)
 		g_variant_unref (retval);
 
+	item_invalidate_lookups (SECRET_ITEM (source));
+
 	g_simple_async_result_complete (res);
 	g_object_unref (res);
 }
@@ -1196,18 +1748,16 @@ on_set_ensure_session (GObject *source,
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	SecretItem *self = SECRET_ITEM (g_async_result_get_source_object (user_data));
 	SetClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
-	SecretSession *session;
 	GVariant *encoded;
 	GError *error = NULL;
 
-	secret_service_ensure_session_finish (self->pv->service, result, &error);
+	closure->session = _secret_service_ensure_session_take (self->pv->service, result, &error);
 	if (error != NULL) {
 		g_simple_async_result_take_error (res, error);
 		g_simple_async_result_complete (res);
 
 	} else {
-		session = _secret_service_get_session (self->pv->service);
-		encoded = _secret_session_encode_secret (session, closure->value);
+		encoded = _secret_session_encode_secret (closure->session, closure->value);
 		g_dbus_proxy_call (G_DBUS_PROXY (self), "SetSecret",
 		                   g_variant_new ("(@(oayays))", encoded),
 		                   G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, closure->cancellable,
@@ -1366,6 +1916,101 @@ secret_item_get_attributes (SecretItem *self)
 	return attributes;
 }
 
+static gint
+attribute_entry_compare (gconstpointer a,
+                         gconstpointer b)
+{
+	return strcmp (((const AttributeEntry *)a)->name,
+	               ((const AttributeEntry *)b)->name);
+}
+
+static void
+item_update_attribute_view (SecretItem *self)
+{
+	GVariantIter iter;
+	GVariant *variant;
+	gsize i;
+
+	/* Still viewing the same cached property, nothing to do */
+	variant = g_dbus_proxy_get_cached_property (G_DBUS_PROXY (self), "Attributes");
+	if (variant == self->pv->attributes) {
+		if (variant)
+			g_variant_unref (variant);
+		return;
+	}
+
+	/* Callers may still hold strings borrowed from the old attributes */
+	if (self->pv->attributes)
+		self->pv->attributes_retired = g_slist_prepend (self->pv->attributes_retired,
+		                                                self->pv->attributes);
+	g_free (self->pv->attribute_view);
+
+	/* Keep a reference, the view borrows strings from the variant */
+	self->pv->attributes = variant;
+	self->pv->attribute_view = NULL;
+	self->pv->n_attribute_view = 0;
+
+	if (variant == NULL)
+		return;
+
+	self->pv->n_attribute_view = g_variant_n_children (variant);
+	self->pv->attribute_view = g_new (AttributeEntry, self->pv->n_attribute_view);
+
+	i = 0;
+	g_variant_iter_init (&iter, variant);
+	while (g_variant_iter_next (&iter, "{&s&s}", &self->pv->attribute_view[i].name,
+	                            &self->pv->attribute_view[i].value))
+		i++;
+
+	qsort (self->pv->attribute_view, self->pv->n_attribute_view,
+	       sizeof (AttributeEntry), attribute_entry_compare);
+}
+
+/**
+ * secret_item_get_attribute:
+ * @self: an item
+ * @name: the name of the attribute
+ *
+ * Get the value of one attribute of this item.
+ *
+ * Unlike secret_item_get_attributes() this does not copy the attributes
+ * and does not allocate memory, which makes it suitable for filtering
+ * through many items.
+ *
+ * The returned string is owned by the item, and remains valid for as long
+ * as the item does, even if the attributes of the item change.
+ *
+ * Returns: (allow-none): the value of the attribute, or %NULL if the item
+ *          does not have such an attribute
+ */
+const gchar *
+secret_item_get_attribute (SecretItem *self,
+                           const gchar *name)
+{
+	AttributeEntry *entry;
+	AttributeEntry key;
+	const gchar *value;
+
+	g_return_val_if_fail (SECRET_IS_ITEM (self), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	key.name = name;
+	key.value = NULL;
+
+	g_mutex_lock (&self->pv->mutex);
+
+	item_update_attribute_view (self);
+	entry = bsearch (&key, self->pv->attribute_view, self->pv->n_attribute_view,
+	                 sizeof (AttributeEntry), attribute_entry_compare);
+
+	/* Another thread may rebuild the view, but not free the string */
+	value = entry ? entry->value : NULL;
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	return value;
+}
+
 /**
  * secret_item_set_attributes:
  * @self: an item
@@ -1415,6 +2060,8 @@ secret_item_set_attributes_finish (SecretItem *self,
 {
 	g_return_val_if_fail (SECRET_IS_ITEM (self), FALSE);
 
+	item_invalidate_lookups (self);
+
 	return _secret_util_set_property_finish (G_DBUS_PROXY (self),
 	                                         secret_item_set_attributes,
 	                                         result, error);
@@ -1444,12 +2091,17 @@ secret_item_set_attributes_sync (SecretItem *self,
                                  GCancellable *cancellable,
                                  GError **error)
 {
+	gboolean ret;
+
 	g_return_val_if_fail (SECRET_IS_ITEM (self), FALSE);
 	g_return_val_if_fail (attributes != NULL, FALSE);
 
-	return _secret_util_set_property_sync (G_DBUS_PROXY (self), "Attributes",
-	                                       _secret_util_variant_for_attributes (attributes),
-	                                       cancellable, error);
+	ret = _secret_util_set_property_sync (G_DBUS_PROXY (self), "Attributes",
+	                                      _secret_util_variant_for_attributes (attributes),
+	                                      cancellable, error);
+
+	item_invalidate_lookups (self);
+	return ret;
 }
 
 /**
@@ -1663,3 +2315,370 @@ secret_item_get_modified (SecretItem *self)
 
 	return modified;
 }
+
+/**
+ * SecretItemHandle:
+ *
+ * A compact, read only snapshot of an item in the secret service. Unlike a
+ * #SecretItem it is not a DBus proxy: it does not track changes to the item,
+ * and holds its path, label, schema, attributes and dates in a single block
+ * of memory.
+ *
+ * Use secret_item_new_for_handle() to get a #SecretItem for the item when
+ * needed.
+ */
+
+struct _SecretItemHandle {
+	gint refs;
+	gboolean locked;
+	guint64 created;
+	guint64 modified;
+	gchar *path;
+	gchar *label;
+	gchar *schema;
+	gchar **attributes;
+};
+
+GType
+secret_item_handle_get_type (void)
+{
+	static gsize initialized = 0;
+	static GType type = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		type = g_boxed_type_register_static ("SecretItemHandle",
+		                                     (GBoxedCopyFunc)secret_item_handle_ref,
+		                                     (GBoxedFreeFunc)secret_item_handle_unref);
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return type;
+}
+
+static gchar *
+handle_copy_string (gchar **dest,
+                    gchar *data,
+                    const gchar *string)
+{
+	gsize length = strlen (string) + 1;
+	memcpy (data, string, length);
+	*dest = data;
+	return data + length;
+}
+
+SecretItemHandle *
+_secret_item_handle_new (const gchar *item_path,
+                         GVariant *properties)
+{
+	SecretItemHandle *handle;
+	GVariant *attributes;
+	const gchar *label;
+	const gchar *schema;
+	const gchar *name;
+	const gchar *value;
+	GVariantIter iter;
+	GVariant *dict;
+	gsize n_attributes;
+	gsize length;
+	gchar *data;
+	guint i;
+
+	g_return_val_if_fail (item_path != NULL, NULL);
+	g_return_val_if_fail (properties != NULL, NULL);
+
+	dict = g_variant_get_child_value (properties, 0);
+	if (!g_variant_lookup (dict, "Label", "&s", &label))
+		label = "";
+	if (!g_variant_lookup (dict, "Type", "&s", &schema))
+		schema = NULL;
+	attributes = g_variant_lookup_value (dict, "Attributes", G_VARIANT_TYPE ("a{ss}"));
+	n_attributes = attributes ? g_variant_n_children (attributes) : 0;
+
+	/* Everything goes in one block, the strings after the attribute array */
+	length = sizeof (SecretItemHandle) + sizeof (gchar *) * (n_attributes * 2 + 1);
+	length += strlen (item_path) + 1 + strlen (label) + 1;
+	if (schema)
+		length += strlen (schema) + 1;
+	if (attributes) {
+		g_variant_iter_init (&iter, attributes);
+		while (g_variant_iter_next (&iter, "{&s&s}", &name, &value))
+			length += strlen (name) + 1 + strlen (value) + 1;
+	}
+
+	handle = g_malloc (length);
+	handle->refs = 1;
+	handle->locked = FALSE;
+	handle->created = 0;
+	handle->modified = 0;
+	g_variant_lookup (dict, "Locked", "b", &handle->locked);
+	g_variant_lookup (dict, "Created", "t", &handle->created);
+	g_variant_lookup (dict, "Modified", "t", &handle->modified);
+
+	handle->attributes = (gchar **)(handle + 1);
+	data = (gchar *)(handle->attributes + n_attributes * 2 + 1);
+	data = handle_copy_string (&handle->path, data, item_path);
+	data = handle_copy_string (&handle->label, data, label);
+	handle->schema = NULL;
+	if (schema)
+		data = handle_copy_string (&handle->schema, data, schema);
+
+	i = 0;
+	if (attributes) {
+		g_variant_iter_init (&iter, attributes);
+		while (g_variant_iter_next (&iter, "{&s&s}", &name, &value)) {
+			data = handle_copy_string (handle->attributes + i++, data, name);
+			data = handle_copy_string (handle->attributes + i++, data, value);
+		}
+		g_variant_unref (attributes);
+	}
+	handle->attributes[i] = NULL;
+
+	g_assert (data == (gchar *)handle + length);
+	g_variant_unref (dict);
+
+	return handle;
+}
+
+/**
+ * secret_item_handle_ref:
+ * @handle: an item handle
+ *
+ * Add another reference to the #SecretItemHandle.
+ *
+ * Returns: the @handle
+ */
+SecretItemHandle *
+secret_item_handle_ref (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, NULL);
+	g_atomic_int_inc (&handle->refs);
+	return handle;
+}
+
+/**
+ * secret_item_handle_unref:
+ * @handle: (type Secret.ItemHandle) (allow-none): an item handle
+ *
+ * Release a reference to the #SecretItemHandle. When the last reference is
+ * released it is freed.
+ */
+void
+secret_item_handle_unref (gpointer handle)
+{
+	SecretItemHandle *self = handle;
+
+	if (self == NULL)
+		return;
+
+	if (g_atomic_int_dec_and_test (&self->refs))
+		g_free (self);
+}
+
+/**
+ * secret_item_handle_get_path:
+ * @handle: an item handle
+ *
+ * Get the DBus object path of the item.
+ *
+ * Returns: the object path
+ */
+const gchar *
+secret_item_handle_get_path (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, NULL);
+	return handle->path;
+}
+
+/**
+ * secret_item_handle_get_label:
+ * @handle: an item handle
+ *
+ * Get the label of the item, at the time the handle was retrieved.
+ *
+ * Returns: the label
+ */
+const gchar *
+secret_item_handle_get_label (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, NULL);
+	return handle->label;
+}
+
+/**
+ * secret_item_handle_get_schema:
+ * @handle: an item handle
+ *
+ * Get the schema name of the item, if the secret service provided one.
+ *
+ * Returns: (allow-none): the schema name, or %NULL
+ */
+const gchar *
+secret_item_handle_get_schema (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, NULL);
+	return handle->schema;
+}
+
+/**
+ * secret_item_handle_get_attribute:
+ * @handle: an item handle
+ * @name: the attribute name
+ *
+ * Get the value of one attribute of the item.
+ *
+ * Returns: (allow-none): the attribute value, or %NULL if not present
+ */
+const gchar *
+secret_item_handle_get_attribute (SecretItemHandle *handle,
+                                  const gchar *name)
+{
+	guint i;
+
+	g_return_val_if_fail (handle != NULL, NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	for (i = 0; handle->attributes[i] != NULL; i += 2) {
+		if (g_str_equal (handle->attributes[i], name))
+			return handle->attributes[i + 1];
+	}
+
+	return NULL;
+}
+
+/**
+ * secret_item_handle_get_attributes:
+ * @handle: an item handle
+ *
+ * Get the attributes of the item, at the time the handle was retrieved.
+ *
+ * Returns: (transfer full) (element-type utf8 utf8): a new table of the
+ *          attributes, which should be released with g_hash_table_unref()
+ */
+GHashTable *
+secret_item_handle_get_attributes (SecretItemHandle *handle)
+{
+	GHashTable *attributes;
+	guint i;
+
+	g_return_val_if_fail (handle != NULL, NULL);
+
+	attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	for (i = 0; handle->attributes[i] != NULL; i += 2)
+		g_hash_table_insert (attributes, g_strdup (handle->attributes[i]),
+		                     g_strdup (handle->attributes[i + 1]));
+
+	return attributes;
+}
+
+/**
+ * secret_item_handle_get_locked:
+ * @handle: an item handle
+ *
+ * Get whether the item was locked when the handle was retrieved.
+ *
+ * Returns: whether the item was locked
+ */
+gboolean
+secret_item_handle_get_locked (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, TRUE);
+	return handle->locked;
+}
+
+/**
+ * secret_item_handle_get_created:
+ * @handle: an item handle
+ *
+ * Get the created date and time of the item, as the number of seconds
+ * since the unix epoch, January 1st 1970.
+ *
+ * Returns: the created date and time
+ */
+guint64
+secret_item_handle_get_created (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, 0);
+	return handle->created;
+}
+
+/**
+ * secret_item_handle_get_modified:
+ * @handle: an item handle
+ *
+ * Get the modified date and time of the item, as the number of seconds
+ * since the unix epoch, January 1st 1970.
+ *
+ * Returns: the modified date and time
+ */
+guint64
+secret_item_handle_get_modified (SecretItemHandle *handle)
+{
+	g_return_val_if_fail (handle != NULL, 0);
+	return handle->modified;
+}
+
+static GVariant *
+handle_to_properties (SecretItemHandle *handle)
+{
+	GVariantBuilder builder;
+	GVariantBuilder attributes;
+	guint i;
+
+	g_variant_builder_init (&attributes, G_VARIANT_TYPE ("a{ss}"));
+	for (i = 0; handle->attributes[i] != NULL; i += 2)
+		g_variant_builder_add (&attributes, "{ss}", handle->attributes[i],
+		                       handle->attributes[i + 1]);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&builder, "{sv}", "Label", g_variant_new_string (handle->label));
+	g_variant_builder_add (&builder, "{sv}", "Attributes", g_variant_builder_end (&attributes));
+	g_variant_builder_add (&builder, "{sv}", "Locked", g_variant_new_boolean (handle->locked));
+	g_variant_builder_add (&builder, "{sv}", "Created", g_variant_new_uint64 (handle->created));
+	g_variant_builder_add (&builder, "{sv}", "Modified", g_variant_new_uint64 (handle->modified));
+	if (handle->schema)
+		g_variant_builder_add (&builder, "{sv}", "Type", g_variant_new_string (handle->schema));
+
+	return g_variant_ref_sink (g_variant_new ("(@a{sv})", g_variant_builder_end (&builder)));
+}
+
+/**
+ * secret_item_new_for_handle:
+ * @service: a secret service object
+ * @handle: an item handle
+ * @cancellable: optional cancellation object
+ * @error: location to place an error on failure
+ *
+ * Get an item proxy for the item that @handle refers to. If a proxy for the
+ * item already exists, then that is returned.
+ *
+ * The properties of a new proxy are taken from @handle, so this only blocks
+ * briefly while the proxy looks up the owner of the secret service bus name.
+ *
+ * Returns: (transfer full): the item, which should be unreferenced
+ *          with g_object_unref()
+ */
+SecretItem *
+secret_item_new_for_handle (SecretService *service,
+                            SecretItemHandle *handle,
+                            GCancellable *cancellable,
+                            GError **error)
+{
+	GVariant *properties;
+	SecretItem *item;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (service), NULL);
+	g_return_val_if_fail (handle != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	item = _secret_service_find_item_instance (service, handle->path);
+	if (item != NULL)
+		return item;
+
+	properties = handle_to_properties (handle);
+	item = item_new_for_properties (service, handle->path, properties,
+	                                cancellable, error);
+	g_variant_unref (properties);
+
+	return item;
+}
@@ -132,6 +132,9 @@ gboolean            secret_item_set_secret_sync            (SecretItem *self,
 
 GHashTable*         secret_item_get_attributes             (SecretItem *self);
 
+const gchar *       secret_item_get_attribute              (SecretItem *self,
+                                                            const gchar *name);
+
 void                secret_item_set_attributes             (SecretItem *self,
                                                             GHashTable *attributes,
                                                             GCancellable *cancellable,
@@ -172,6 +175,36 @@ guint64             secret_item_get_created                (SecretItem *self);
 
 guint64             secret_item_get_modified               (SecretItem *self);
 
+#define SECRET_TYPE_ITEM_HANDLE (secret_item_handle_get_type ())
+
+GType               secret_item_handle_get_type            (void) G_GNUC_CONST;
+
+SecretItemHandle *  secret_item_handle_ref                 (SecretItemHandle *handle);
+
+void                secret_item_handle_unref               (gpointer handle);
+
+const gchar *       secret_item_handle_get_path            (SecretItemHandle *handle);
+
+const gchar *       secret_item_handle_get_label           (SecretItemHandle *handle);
+
+const gchar *       secret_item_handle_get_schema          (SecretItemHandle *handle);
+
+const gchar *       secret_item_handle_get_attribute       (SecretItemHandle *handle,
+                                                            const gchar *name);
+
+GHashTable *        secret_item_handle_get_attributes      (SecretItemHandle *handle);
+
+gboolean            secret_item_handle_get_locked          (SecretItemHandle *handle);
+
+guint64             secret_item_handle_get_created         (SecretItemHandle *handle);
+
+guint64             secret_item_handle_get_modified        (SecretItemHandle *handle);
+
+SecretItem *        secret_item_new_for_handle             (SecretService *service,
+                                                            SecretItemHandle *handle,
+                                                            GCancellable *cancellable,
+                                                            GError **error);
+
 G_END_DECLS
 
 #endif /* __SECRET_ITEM_H___ */
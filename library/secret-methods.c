@@ -41,6 +41,27 @@ on_search_items_complete (GObject *source,
 	g_object_unref (res);
 }
 
+static void
+search_for_paths_variant (SecretService *self,
+                          GVariant *attributes,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+
+	/* Completes with secret_service_search_for_paths_finish() */
+	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
+	                                 secret_service_search_for_paths);
+
+	g_dbus_proxy_call (G_DBUS_PROXY (self), "SearchItems",
+	                   g_variant_new ("(@a{ss})", attributes),
+	                   G_DBUS_CALL_FLAGS_NONE, -1, cancellable,
+	                   on_search_items_complete, g_object_ref (res));
+
+	g_object_unref (res);
+}
+
 /**
  * secret_service_search_for_paths:
  * @self: the secret service
@@ -61,22 +82,12 @@ secret_service_search_for_paths (SecretService *self,
                                  GAsyncReadyCallback callback,
                                  gpointer user_data)
 {
-	GSimpleAsyncResult *res;
-
 	g_return_if_fail (SECRET_IS_SERVICE (self));
 	g_return_if_fail (attributes != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
-	                                 secret_service_search_for_paths);
-
-	g_dbus_proxy_call (G_DBUS_PROXY (self), "SearchItems",
-	                   g_variant_new ("(@a{ss})",
-	                                  _secret_util_variant_for_attributes (attributes)),
-	                   G_DBUS_CALL_FLAGS_NONE, -1, cancellable,
-	                   on_search_items_complete, g_object_ref (res));
-
-	g_object_unref (res);
+	search_for_paths_variant (self, _secret_util_variant_for_attributes (attributes),
+	                          cancellable, callback, user_data);
 }
 
 /**
@@ -197,7 +208,6 @@ typedef struct {
 	GHashTable *items;
 	gchar **unlocked;
 	gchar **locked;
-	guint loading;
 } SearchClosure;
 
 static void
@@ -227,38 +237,38 @@ on_search_loaded (GObject *source,
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	SearchClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	GError *error = NULL;
+	GHashTableIter iter;
+	GHashTable *items;
 	SecretItem *item;
 
-	closure->loading--;
-
-	item = secret_item_new_finish (result, &error);
+	items = _secret_item_load_paths_finish (result, &error);
 	if (error != NULL)
 		g_simple_async_result_take_error (res, error);
 
-	if (item != NULL)
-		search_closure_take_item (closure, item);
-	if (closure->loading == 0)
-		g_simple_async_result_complete (res);
+	if (items != NULL) {
+		g_hash_table_iter_init (&iter, items);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&item))
+			search_closure_take_item (closure, g_object_ref (item));
+		g_hash_table_unref (items);
+	}
 
+	g_simple_async_result_complete (res);
 	g_object_unref (res);
 }
 
 static void
 search_load_item_async (SecretService *self,
-                        GSimpleAsyncResult *res,
                         SearchClosure *closure,
+                        GPtrArray *missing,
                         const gchar *path)
 {
 	SecretItem *item;
 
 	item = _secret_service_find_item_instance (self, path);
-	if (item == NULL) {
-		secret_item_new (self, path, closure->cancellable,
-		                  on_search_loaded, g_object_ref (res));
-		closure->loading++;
-	} else {
+	if (item == NULL)
+		g_ptr_array_add (missing, (gpointer)path);
+	else
 		search_closure_take_item (closure, item);
-	}
 }
 
 static void
@@ -270,22 +280,34 @@ on_search_paths (GObject *source,
 	SearchClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	SecretService *self = SECRET_SERVICE (source);
 	GError *error = NULL;
+	GPtrArray *missing;
 	guint i;
 
 	if (!secret_service_search_for_paths_finish (self, result, &closure->unlocked,
 	                                              &closure->locked, &error)) {
 		g_simple_async_result_take_error (res, error);
 		g_simple_async_result_complete (res);
+		g_object_unref (res);
+		return;
 	}
 
+	missing = g_ptr_array_new ();
 	for (i = 0; closure->unlocked[i] != NULL; i++)
-		search_load_item_async (self, res, closure, closure->unlocked[i]);
+		search_load_item_async (self, closure, missing, closure->unlocked[i]);
 	for (i = 0; closure->locked[i] != NULL; i++)
-		search_load_item_async (self, res, closure, closure->locked[i]);
-
-	if (closure->loading == 0)
+		search_load_item_async (self, closure, missing, closure->locked[i]);
+
+	/* Load all the items we don't already have in one go */
+	if (missing->len > 0) {
+		g_ptr_array_add (missing, NULL);
+		_secret_item_load_paths (self, (const gchar **)missing->pdata,
+		                         closure->cancellable, on_search_loaded,
+		                         g_object_ref (res));
+	} else {
 		g_simple_async_result_complete (res);
+	}
 
+	g_ptr_array_free (missing, TRUE);
 	g_object_unref (res);
 }
 
@@ -401,21 +423,46 @@ service_load_items_sync (SecretService *self,
 {
 	SecretItem *item;
 	GList *result = NULL;
+	GHashTable *loaded;
+	GPtrArray *missing;
+	GList *l;
 	guint i;
 
+	missing = g_ptr_array_new ();
 	for (i = 0; paths[i] != NULL; i++) {
 		item = _secret_service_find_item_instance (self, paths[i]);
 		if (item == NULL)
-			item = secret_item_new_sync (self, paths[i], cancellable, error);
-		if (item == NULL) {
-			g_list_free_full (result, g_object_unref);
+			g_ptr_array_add (missing, paths[i]);
+		result = g_list_prepend (result, item);
+	}
+
+	result = g_list_reverse (result);
+
+	/* Load all the items we don't already have in one go */
+	if (missing->len > 0) {
+		g_ptr_array_add (missing, NULL);
+		loaded = _secret_item_load_paths_sync (self, (const gchar **)missing->pdata,
+		                                       cancellable, error);
+		if (loaded == NULL) {
+			for (l = result; l != NULL; l = g_list_next (l)) {
+				if (l->data)
+					g_object_unref (l->data);
+			}
+			g_list_free (result);
+			g_ptr_array_free (missing, TRUE);
 			return FALSE;
-		} else {
-			result = g_list_prepend (result, item);
 		}
+
+		for (l = result, i = 0; l != NULL; l = g_list_next (l), i++) {
+			if (l->data == NULL)
+				l->data = g_object_ref (g_hash_table_lookup (loaded, paths[i]));
+		}
+
+		g_hash_table_unref (loaded);
 	}
 
-	*items = g_list_reverse (result);
+	g_ptr_array_free (missing, TRUE);
+	*items = result;
 	return TRUE;
 }
 
@@ -475,17 +522,259 @@ secret_service_search_sync (SecretService *self,
 	return ret;
 }
 
+typedef struct {
+	GCancellable *cancellable;
+	GHashTable *properties;
+	gchar **unlocked;
+	gchar **locked;
+} HandlesClosure;
+
+static void
+handles_closure_free (gpointer data)
+{
+	HandlesClosure *closure = data;
+	g_clear_object (&closure->cancellable);
+	if (closure->properties)
+		g_hash_table_unref (closure->properties);
+	g_strfreev (closure->unlocked);
+	g_strfreev (closure->locked);
+	g_slice_free (HandlesClosure, closure);
+}
+
+static void
+on_handles_loaded (GObject *source,
+                   GAsyncResult *result,
+                   gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	HandlesClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GError *error = NULL;
+
+	closure->properties = _secret_item_load_properties_finish (result, &error);
+	if (error != NULL)
+		g_simple_async_result_take_error (res, error);
+
+	g_simple_async_result_complete (res);
+	g_object_unref (res);
+}
+
+static void
+on_handles_paths (GObject *source,
+                  GAsyncResult *result,
+                  gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	HandlesClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (source);
+	GError *error = NULL;
+	GPtrArray *paths;
+	guint i;
+
+	if (!secret_service_search_for_paths_finish (self, result, &closure->unlocked,
+	                                              &closure->locked, &error)) {
+		g_simple_async_result_take_error (res, error);
+		g_simple_async_result_complete (res);
+		g_object_unref (res);
+		return;
+	}
+
+	paths = g_ptr_array_new ();
+	for (i = 0; closure->unlocked[i] != NULL; i++)
+		g_ptr_array_add (paths, closure->unlocked[i]);
+	for (i = 0; closure->locked[i] != NULL; i++)
+		g_ptr_array_add (paths, closure->locked[i]);
+	g_ptr_array_add (paths, NULL);
+
+	/* The properties of all the items, in one burst */
+	_secret_item_load_properties (self, (const gchar **)paths->pdata,
+	                              closure->cancellable, on_handles_loaded,
+	                              g_object_ref (res));
+
+	g_ptr_array_free (paths, TRUE);
+	g_object_unref (res);
+}
+
+/**
+ * secret_service_search_handles:
+ * @self: the secret service
+ * @attributes: (element-type utf8 utf8): search for items matching these attributes
+ * @cancellable: optional cancellation object
+ * @callback: called when the operation completes
+ * @user_data: data to pass to the callback
+ *
+ * Search for items matching the @attributes, and retrieve a lightweight
+ * #SecretItemHandle for each of them. All collections are searched.
+ * The @attributes should be a table of string keys and string values.
+ *
+ * Unlike secret_service_search() no #SecretItem proxy is created for the
+ * matching items, which makes this the better choice when searching for
+ * many items. Use secret_item_new_for_handle() to get a proxy for a given
+ * item when it is needed.
+ *
+ * This function returns immediately and completes asynchronously.
+ */
+void
+secret_service_search_handles (SecretService *self,
+                               GHashTable *attributes,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	HandlesClosure *closure;
+
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+	g_return_if_fail (attributes != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
+	                                 secret_service_search_handles);
+	closure = g_slice_new0 (HandlesClosure);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	g_simple_async_result_set_op_res_gpointer (res, closure, handles_closure_free);
+
+	secret_service_search_for_paths (self, attributes, cancellable,
+	                                 on_handles_paths, g_object_ref (res));
+
+	g_object_unref (res);
+}
+
+static GList *
+handles_finish_build (gchar **paths,
+                      HandlesClosure *closure)
+{
+	GList *results = NULL;
+	GVariant *properties;
+	guint i;
+
+	/* Items that went away since the search are left out */
+	for (i = 0; paths[i]; i++) {
+		properties = g_hash_table_lookup (closure->properties, paths[i]);
+		if (properties != NULL)
+			results = g_list_prepend (results, _secret_item_handle_new (paths[i], properties));
+	}
+
+	return g_list_reverse (results);
+}
+
+/**
+ * secret_service_search_handles_finish:
+ * @self: the secret service
+ * @result: asynchronous result passed to callback
+ * @unlocked: (out) (transfer full) (element-type Secret.ItemHandle) (allow-none):
+ *            location to place a list of handles for matching items which
+ *            were not locked.
+ * @locked: (out) (transfer full) (element-type Secret.ItemHandle) (allow-none):
+ *          location to place a list of handles for matching items which
+ *          were locked.
+ * @error: location to place error on failure
+ *
+ * Complete asynchronous operation to search for item handles.
+ *
+ * Handles for matching items that are locked or unlocked are placed in the
+ * @locked or @unlocked lists respectively. Release them with
+ * secret_item_handle_unref().
+ *
+ * Returns: whether the search was successful or not
+ */
+gboolean
+secret_service_search_handles_finish (SecretService *self,
+                                      GAsyncResult *result,
+                                      GList **unlocked,
+                                      GList **locked,
+                                      GError **error)
+{
+	GSimpleAsyncResult *res;
+	HandlesClosure *closure;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (self),
+	                      secret_service_search_handles), FALSE);
+
+	res = G_SIMPLE_ASYNC_RESULT (result);
+
+	if (g_simple_async_result_propagate_error (res, error))
+		return FALSE;
+
+	closure = g_simple_async_result_get_op_res_gpointer (res);
+	if (unlocked)
+		*unlocked = handles_finish_build (closure->unlocked, closure);
+	if (locked)
+		*locked = handles_finish_build (closure->locked, closure);
+
+	return TRUE;
+}
+
+/**
+ * secret_service_search_handles_sync:
+ * @self: the secret service
+ * @attributes: (element-type utf8 utf8): search for items matching these attributes
+ * @cancellable: optional cancellation object
+ * @unlocked: (out) (transfer full) (element-type Secret.ItemHandle) (allow-none):
+ *            location to place a list of handles for matching items which
+ *            were not locked.
+ * @locked: (out) (transfer full) (element-type Secret.ItemHandle) (allow-none):
+ *          location to place a list of handles for matching items which
+ *          were locked.
+ * @error: location to place error on failure
+ *
+ * Search for items matching the @attributes, and retrieve a lightweight
+ * #SecretItemHandle for each of them. See secret_service_search_handles()
+ * for details.
+ *
+ * This function may block indefinetely. Use the asynchronous version
+ * in user interface threads.
+ *
+ * Returns: whether the search was successful or not
+ */
+gboolean
+secret_service_search_handles_sync (SecretService *self,
+                                    GHashTable *attributes,
+                                    GCancellable *cancellable,
+                                    GList **unlocked,
+                                    GList **locked,
+                                    GError **error)
+{
+	SecretSync *sync;
+	gboolean ret;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), FALSE);
+	g_return_val_if_fail (attributes != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	secret_service_search_handles (self, attributes, cancellable,
+	                               _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	ret = secret_service_search_handles_finish (self, sync->result,
+	                                            unlocked, locked, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
+
+	return ret;
+}
+
 typedef struct {
 	GCancellable *cancellable;
 	GVariant *in;
 	GVariant *out;
 	GHashTable *items;
+	SecretSession *session;
+	gboolean retried;
 } GetClosure;
 
 static void
 get_closure_free (gpointer data)
 {
 	GetClosure *closure = data;
+	_secret_session_unref (closure->session);
 	if (closure->in)
 		g_variant_unref (closure->in);
 	if (closure->out)
@@ -494,6 +783,10 @@ get_closure_free (gpointer data)
 	g_slice_free (GetClosure, closure);
 }
 
+static void          on_get_secrets_session      (GObject *source,
+                                                  GAsyncResult *result,
+                                                  gpointer user_data);
+
 static void
 on_get_secrets_complete (GObject *source,
                          GAsyncResult *result,
@@ -504,6 +797,19 @@ on_get_secrets_complete (GObject *source,
 	GError *error = NULL;
 
 	closure->out = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), result, &error);
+
+	/* The service lost our session, open a new one and try again once */
+	if (_secret_util_is_session_error (error) && !closure->retried) {
+		closure->retried = TRUE;
+		g_clear_error (&error);
+		_secret_service_reset_session (SECRET_SERVICE (source), closure->session);
+		_secret_session_unref (closure->session);
+		closure->session = NULL;
+		secret_service_ensure_session (SECRET_SERVICE (source), closure->cancellable,
+		                               on_get_secrets_session, res);
+		return;
+	}
+
 	if (error != NULL)
 		g_simple_async_result_take_error (res, error);
 	g_simple_async_result_complete (res);
@@ -519,16 +825,16 @@ on_get_secrets_session (GObject *source,
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	GetClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	GError *error = NULL;
-	const gchar *session;
 
-	session = secret_service_ensure_session_finish (SECRET_SERVICE (source),
-	                                                result, &error);
+	closure->session = _secret_service_ensure_session_take (SECRET_SERVICE (source),
+	                                                        result, &error);
 	if (error != NULL) {
 		g_simple_async_result_take_error (res, error);
 		g_simple_async_result_complete (res);
 	} else {
 		g_dbus_proxy_call (G_DBUS_PROXY (source), "GetSecrets",
-		                   g_variant_new ("(@aoo)", closure->in, session),
+		                   g_variant_new ("(@aoo)", closure->in,
+		                                  _secret_session_get_path (closure->session)),
 		                   G_DBUS_CALL_FLAGS_NO_AUTO_START, -1,
 		                   closure->cancellable, on_get_secrets_complete,
 		                   g_object_ref (res));
@@ -579,10 +885,9 @@ secret_service_get_secret_for_path (SecretService *self,
 }
 
 static SecretValue *
-service_decode_get_secrets_first (SecretService *self,
+service_decode_get_secrets_first (SecretSession *session,
                                   GVariant *out)
 {
-	SecretSession *session;
 	SecretValue *value = NULL;
 	GVariantIter *iter;
 	GVariant *variant;
@@ -590,7 +895,6 @@ service_decode_get_secrets_first (SecretService *self,
 
 	g_variant_get (out, "(a{o(oayays)})", &iter);
 	while (g_variant_iter_next (iter, "{&o@(oayays)}", &path, &variant)) {
-		session = _secret_service_get_session (self);
 		value = _secret_session_decode_secret (session, variant);
 		g_variant_unref (variant);
 		break;
@@ -600,26 +904,21 @@ service_decode_get_secrets_first (SecretService *self,
 }
 
 static GHashTable *
-service_decode_get_secrets_all (SecretService *self,
+service_decode_get_secrets_all (SecretSession *session,
                                 GVariant *out)
 {
-	SecretSession *session;
-	GVariantIter *iter;
-	GVariant *variant;
+	SecretValueArray *array;
 	GHashTable *values;
-	SecretValue *value;
-	gchar *path;
+	guint i;
 
-	session = _secret_service_get_session (self);
+	array = _secret_session_decode_secrets (session, out);
 	values = g_hash_table_new_full (g_str_hash, g_str_equal,
 	                                g_free, secret_value_unref);
-	g_variant_get (out, "(a{o(oayays)})", &iter);
-	while (g_variant_iter_loop (iter, "{o@(oayays)}", &path, &variant)) {
-		value = _secret_session_decode_secret (session, variant);
-		if (value && path)
-			g_hash_table_insert (values, g_strdup (path), value);
+	for (i = 0; i < secret_value_array_get_length (array); i++) {
+		g_hash_table_insert (values, g_strdup (secret_value_array_get_path (array, i)),
+		                     secret_value_ref (secret_value_array_get_value (array, i)));
 	}
-	g_variant_iter_free (iter);
+	secret_value_array_unref (array);
 	return values;
 }
 
@@ -655,7 +954,7 @@ secret_service_get_secret_for_path_finish (SecretService *self,
 		return NULL;
 
 	closure = g_simple_async_result_get_op_res_gpointer (res);
-	return service_decode_get_secrets_first (self, closure->out);
+	return service_decode_get_secrets_first (closure->session, closure->out);
 }
 
 /**
@@ -778,7 +1077,7 @@ secret_service_get_secrets_for_paths_finish (SecretService *self,
 		return NULL;
 
 	closure = g_simple_async_result_get_op_res_gpointer (res);
-	return service_decode_get_secrets_all (self, closure->out);
+	return service_decode_get_secrets_all (closure->session, closure->out);
 }
 
 /**
@@ -829,48 +1128,175 @@ secret_service_get_secrets_for_paths_sync (SecretService *self,
 }
 
 /**
- * secret_service_get_secrets:
+ * secret_service_get_secret_array_for_paths:
  * @self: the secret service
- * @items: (element-type Secret.Item): the items to retrieve secrets for
+ * @item_paths: the dbus paths to items to retrieve secrets for
  * @cancellable: optional cancellation object
  * @callback: called when the operation completes
  * @user_data: data to pass to the callback
  *
- * Get the secret values for an secret items stored in the service.
+ * Get the secret values for many secret items stored in the service.
+ *
+ * This is like secret_service_get_secrets_for_paths() but the result is
+ * a #SecretValueArray, which is cheaper to build when retrieving large
+ * numbers of secrets.
  *
  * This function returns immediately and completes asynchronously.
  */
 void
-secret_service_get_secrets (SecretService *self,
-                            GList *items,
-                            GCancellable *cancellable,
-                            GAsyncReadyCallback callback,
-                            gpointer user_data)
+secret_service_get_secret_array_for_paths (SecretService *self,
+                                           const gchar **item_paths,
+                                           GCancellable *cancellable,
+                                           GAsyncReadyCallback callback,
+                                           gpointer user_data)
 {
 	GSimpleAsyncResult *res;
 	GetClosure *closure;
-	GPtrArray *paths;
-	const gchar *path;
-	GList *l;
 
 	g_return_if_fail (SECRET_IS_SERVICE (self));
+	g_return_if_fail (item_paths != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
-	                                 secret_service_get_secrets);
+	                                 secret_service_get_secret_array_for_paths);
+
 	closure = g_slice_new0 (GetClosure);
 	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
-	closure->items = g_hash_table_new_full (g_str_hash, g_str_equal,
-	                                        g_free, g_object_unref);
+	closure->in = g_variant_ref_sink (g_variant_new_objv (item_paths, -1));
+	g_simple_async_result_set_op_res_gpointer (res, closure, get_closure_free);
 
-	paths = g_ptr_array_new ();
-	for (l = items; l != NULL; l = g_list_next (l)) {
-		path = g_dbus_proxy_get_object_path (l->data);
-		g_hash_table_insert (closure->items, g_strdup (path), g_object_ref (l->data));
-		g_ptr_array_add (paths, (gpointer)path);
-	}
+	secret_service_ensure_session (self, cancellable,
+	                               on_get_secrets_session,
+	                               g_object_ref (res));
 
-	closure->in = g_variant_new_objv ((const gchar * const *)paths->pdata, paths->len);
+	g_object_unref (res);
+}
+
+/**
+ * secret_service_get_secret_array_for_paths_finish:
+ * @self: the secret service
+ * @result: asynchronous result passed to callback
+ * @error: location to place an error on failure
+ *
+ * Complete asynchronous operation to get the secret values for many
+ * secret items stored in the service.
+ *
+ * Items that are locked will not be included the results.
+ *
+ * Returns: (transfer full): an array of item paths and their secret values,
+ *          release with secret_value_array_unref()
+ */
+SecretValueArray *
+secret_service_get_secret_array_for_paths_finish (SecretService *self,
+                                                  GAsyncResult *result,
+                                                  GError **error)
+{
+	GSimpleAsyncResult *res;
+	GetClosure *closure;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (self),
+	                      secret_service_get_secret_array_for_paths), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	res = G_SIMPLE_ASYNC_RESULT (result);
+	if (g_simple_async_result_propagate_error (res, error))
+		return NULL;
+
+	closure = g_simple_async_result_get_op_res_gpointer (res);
+	return _secret_session_decode_secrets (closure->session, closure->out);
+}
+
+/**
+ * secret_service_get_secret_array_for_paths_sync:
+ * @self: the secret service
+ * @item_paths: the dbus paths to items to retrieve secrets for
+ * @cancellable: optional cancellation object
+ * @error: location to place an error on failure
+ *
+ * Get the secret values for many secret items stored in the service.
+ *
+ * This method may block indefinitely and should not be used in user interface
+ * threads.
+ *
+ * Items that are locked will not be included the results.
+ *
+ * Returns: (transfer full): an array of item paths and their secret values,
+ *          release with secret_value_array_unref()
+ */
+SecretValueArray *
+secret_service_get_secret_array_for_paths_sync (SecretService *self,
+                                                const gchar **item_paths,
+                                                GCancellable *cancellable,
+                                                GError **error)
+{
+	SecretValueArray *secrets;
+	SecretSync *sync;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (item_paths != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	secret_service_get_secret_array_for_paths (self, item_paths, cancellable,
+	                                           _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	secrets = secret_service_get_secret_array_for_paths_finish (self, sync->result, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
+
+	return secrets;
+}
+
+/**
+ * secret_service_get_secrets:
+ * @self: the secret service
+ * @items: (element-type Secret.Item): the items to retrieve secrets for
+ * @cancellable: optional cancellation object
+ * @callback: called when the operation completes
+ * @user_data: data to pass to the callback
+ *
+ * Get the secret values for an secret items stored in the service.
+ *
+ * This function returns immediately and completes asynchronously.
+ */
+void
+secret_service_get_secrets (SecretService *self,
+                            GList *items,
+                            GCancellable *cancellable,
+                            GAsyncReadyCallback callback,
+                            gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	GetClosure *closure;
+	GPtrArray *paths;
+	const gchar *path;
+	GList *l;
+
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
+	                                 secret_service_get_secrets);
+	closure = g_slice_new0 (GetClosure);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	closure->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                        g_free, g_object_unref);
+
+	paths = g_ptr_array_new ();
+	for (l = items; l != NULL; l = g_list_next (l)) {
+		path = g_dbus_proxy_get_object_path (l->data);
+		g_hash_table_insert (closure->items, g_strdup (path), g_object_ref (l->data));
+		g_ptr_array_add (paths, (gpointer)path);
+	}
+
+	closure->in = g_variant_new_objv ((const gchar * const *)paths->pdata, paths->len);
 	g_variant_ref_sink (closure->in);
 
 	g_ptr_array_free (paths, TRUE);
@@ -921,7 +1347,7 @@ secret_service_get_secrets_finish (SecretService *self,
 		return NULL;
 
 	closure = g_simple_async_result_get_op_res_gpointer (res);
-	with_paths = service_decode_get_secrets_all (self, closure->out);
+	with_paths = service_decode_get_secrets_all (closure->session, closure->out);
 	g_return_val_if_fail (with_paths != NULL, NULL);
 
 	with_items = g_hash_table_new_full (g_direct_hash, g_direct_equal,
@@ -1023,6 +1449,8 @@ on_xlock_prompted (GObject *source,
 	if (error != NULL)
 		g_simple_async_result_take_error (res, error);
 
+	_secret_service_cache_invalidate (self);
+
 	if (ret) {
 		retval = secret_prompt_get_result_value (closure->prompt, G_VARIANT_TYPE ("ao"));
 		g_variant_iter_init (&iter, retval);
@@ -1055,6 +1483,7 @@ on_xlock_called (GObject *source,
 		g_simple_async_result_complete (res);
 
 	} else {
+		_secret_service_cache_invalidate (self);
 		g_variant_get (retval, "(^ao&o)", &xlocked, &prompt);
 
 		if (_secret_util_empty_path (prompt)) {
@@ -1694,22 +2123,25 @@ secret_service_store (SecretService *self,
                       gpointer user_data,
                       ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
 	va_list va;
 
 	g_return_if_fail (SECRET_IS_SERVICE (self));
 	g_return_if_fail (schema != NULL);
 	g_return_if_fail (label != NULL);
 	g_return_if_fail (value != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	va_start (va, user_data);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	secret_service_storev (self, schema, attributes, collection_path,
-	                       label, value, cancellable, callback, user_data);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return;
 
-	g_hash_table_unref (attributes);
+	_secret_service_store_attributes (self, schema, attributes, collection_path,
+	                                  label, value, cancellable, callback, user_data);
 }
 
 /**
@@ -1748,9 +2180,6 @@ secret_service_storev (SecretService *self,
                        GAsyncReadyCallback callback,
                        gpointer user_data)
 {
-	GHashTable *properties;
-	GVariant *propval;
-
 	g_return_if_fail (SECRET_IS_SERVICE (self));
 	g_return_if_fail (schema != NULL);
 	g_return_if_fail (attributes != NULL);
@@ -1762,6 +2191,31 @@ secret_service_storev (SecretService *self,
 	if (!_secret_util_attributes_validate (schema, attributes))
 		return;
 
+	_secret_service_store_attributes (self, schema,
+	                                  _secret_util_variant_for_attributes (attributes),
+	                                  collection_path, label, value,
+	                                  cancellable, callback, user_data);
+}
+
+/*
+ * Store a secret with its attributes already validated against the schema,
+ * and in an a{ss} variant. If floating, the variant is consumed. Completes
+ * with secret_service_store_finish().
+ */
+void
+_secret_service_store_attributes (SecretService *self,
+                                  const SecretSchema *schema,
+                                  GVariant *attributes,
+                                  const gchar *collection_path,
+                                  const gchar *label,
+                                  SecretValue *value,
+                                  GCancellable *cancellable,
+                                  GAsyncReadyCallback callback,
+                                  gpointer user_data)
+{
+	GHashTable *properties;
+	GVariant *propval;
+
 	properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
 	                                    (GDestroyNotify)g_variant_unref);
 
@@ -1775,10 +2229,9 @@ secret_service_storev (SecretService *self,
 	                     SECRET_ITEM_INTERFACE ".Schema",
 	                     g_variant_ref_sink (propval));
 
-	propval = _secret_util_variant_for_attributes (attributes);
 	g_hash_table_insert (properties,
 	                     SECRET_ITEM_INTERFACE ".Attributes",
-	                     g_variant_ref_sink (propval));
+	                     g_variant_ref_sink (attributes));
 
 	secret_service_create_item_path (self, collection_path, properties, value,
 	                                 TRUE, cancellable, callback, user_data);
@@ -1852,7 +2305,8 @@ secret_service_store_sync (SecretService *self,
                            GError **error,
                            ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
+	SecretSync *sync;
 	gboolean ret;
 	va_list va;
 
@@ -1864,13 +2318,26 @@ secret_service_store_sync (SecretService *self,
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	va_start (va, error);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	ret = secret_service_storev_sync (self, schema, attributes, collection_path,
-	                                  label, value, cancellable, error);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return FALSE;
 
-	g_hash_table_unref (attributes);
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	_secret_service_store_attributes (self, schema, attributes, collection_path,
+	                                  label, value, cancellable,
+	                                  _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	ret = secret_service_store_finish (self, sync->result, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
 
 	return ret;
 }
@@ -1946,6 +2413,15 @@ secret_service_storev_sync (SecretService *self,
 typedef struct {
 	SecretValue *value;
 	GCancellable *cancellable;
+	GHashTable *attributes;
+	gchar *cache_key;
+	guint cache_generation;
+	gchar *item_path;
+	gboolean cached_path;
+	gchar *flight_key;
+	gboolean leading;
+	SecretSession *session;
+	gboolean retried;
 } LookupClosure;
 
 static void
@@ -1955,6 +2431,11 @@ lookup_closure_free (gpointer data)
 	if (closure->value)
 		secret_value_unref (closure->value);
 	g_clear_object (&closure->cancellable);
+	g_hash_table_unref (closure->attributes);
+	g_free (closure->cache_key);
+	g_free (closure->item_path);
+	g_free (closure->flight_key);
+	_secret_session_unref (closure->session);
 	g_slice_free (LookupClosure, closure);
 }
 
@@ -1991,288 +2472,1017 @@ secret_service_lookup (SecretService *self,
 	g_return_if_fail (schema != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-	va_start (va, user_data);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
-	va_end (va);
+	va_start (va, user_data);
+	attributes = _secret_util_attributes_for_varargs (schema, va);
+	va_end (va);
+
+	secret_service_lookupv (self, schema, attributes, cancellable,
+	                        callback, user_data);
+
+	g_hash_table_unref (attributes);
+}
+
+static void        on_lookup_searched        (GObject *source,
+                                              GAsyncResult *result,
+                                              gpointer user_data);
+
+/* Completes a join with this to make it take over the lookup */
+static gint lookup_promoted;
+
+static void
+lookup_complete (SecretService *self,
+                 GSimpleAsyncResult *res,
+                 GError *error)
+{
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GSimpleAsyncResult *join = NULL;
+	GPtrArray *joined = NULL;
+	guint i;
+
+	/* This lookup was cancelled, one of those that joined it takes over */
+	if (closure->leading && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		join = _secret_service_inflight_promote (self, closure->flight_key);
+		if (join != NULL) {
+			g_simple_async_result_set_op_res_gpointer (join, &lookup_promoted, NULL);
+			g_simple_async_result_complete_in_idle (join);
+			g_object_unref (join);
+			closure->leading = FALSE;
+		}
+	}
+
+	/* Hand the result to any identical lookups that joined this one */
+	if (closure->leading)
+		joined = _secret_service_inflight_release (self, closure->flight_key);
+	closure->leading = FALSE;
+
+	for (i = 0; joined != NULL && i < joined->len; i++) {
+		join = _secret_waiter_claim (joined->pdata[i]);
+		if (join == NULL)
+			continue;
+		if (error != NULL)
+			g_simple_async_result_set_from_error (join, error);
+		else if (closure->value != NULL)
+			g_simple_async_result_set_op_res_gpointer (join, secret_value_ref (closure->value),
+			                                           secret_value_unref);
+		g_simple_async_result_complete_in_idle (join);
+	}
+
+	if (joined != NULL)
+		g_ptr_array_unref (joined);
+
+	if (error != NULL)
+		g_simple_async_result_take_error (res, error);
+	g_simple_async_result_complete (res);
+}
+
+static void
+on_lookup_get_secret (GObject *source,
+                      GAsyncResult *result,
+                      gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (source);
+	GError *error = NULL;
+
+	closure->value = secret_service_get_secret_for_path_finish (self, result, &error);
+
+	/* The cached item path has gone stale, so do a real search */
+	if (closure->cached_path && (error != NULL || closure->value == NULL)) {
+		g_clear_error (&error);
+		closure->cache_generation = _secret_service_cache_invalidate (self);
+		closure->cached_path = FALSE;
+		g_free (closure->item_path);
+		closure->item_path = NULL;
+		secret_service_search_for_paths (self, closure->attributes, closure->cancellable,
+		                                 on_lookup_searched, g_object_ref (res));
+		g_object_unref (res);
+		return;
+	}
+
+	if (error == NULL && closure->cache_key && closure->value && !closure->cached_path)
+		_secret_service_cache_store (self, closure->cache_key, closure->cache_generation,
+		                             closure->item_path, closure->value);
+
+	lookup_complete (self, res, error);
+	g_object_unref (res);
+}
+
+static void
+on_lookup_unlocked (GObject *source,
+                    GAsyncResult *result,
+                    gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (source);
+	GError *error = NULL;
+	gchar **unlocked = NULL;
+
+	secret_service_unlock_paths_finish (SECRET_SERVICE (source),
+	                                     result, &unlocked, &error);
+	if (error != NULL) {
+		lookup_complete (self, res, error);
+
+	} else if (unlocked && unlocked[0]) {
+		closure->item_path = g_strdup (unlocked[0]);
+		secret_service_get_secret_for_path (self, unlocked[0],
+		                                    closure->cancellable,
+		                                    on_lookup_get_secret,
+		                                    g_object_ref (res));
+
+	} else {
+		lookup_complete (self, res, NULL);
+	}
+
+	g_strfreev (unlocked);
+	g_object_unref (res);
+}
+
+static void
+on_lookup_searched (GObject *source,
+                    GAsyncResult *result,
+                    gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (source);
+	GError *error = NULL;
+	gchar **unlocked = NULL;
+	gchar **locked = NULL;
+
+	secret_service_search_for_paths_finish (self, result, &unlocked, &locked, &error);
+	if (error != NULL) {
+		lookup_complete (self, res, error);
+
+	} else if (unlocked && unlocked[0]) {
+		closure->item_path = g_strdup (unlocked[0]);
+		secret_service_get_secret_for_path (self, unlocked[0],
+		                                    closure->cancellable,
+		                                    on_lookup_get_secret,
+		                                    g_object_ref (res));
+
+	} else if (locked && locked[0]) {
+		const gchar *paths[] = { locked[0], NULL };
+		secret_service_unlock_paths (self, paths,
+		                             closure->cancellable,
+		                             on_lookup_unlocked,
+		                             g_object_ref (res));
+
+	} else {
+		lookup_complete (self, res, NULL);
+	}
+
+	g_strfreev (unlocked);
+	g_strfreev (locked);
+	g_object_unref (res);
+}
+
+static void        on_lookup_session         (GObject *source,
+                                              GAsyncResult *result,
+                                              gpointer user_data);
+
+static void
+on_lookup_searched_secrets (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (g_async_result_get_source_object (user_data));
+	GError *error = NULL;
+	GVariantIter *iter;
+	GVariant *variant;
+	GVariant *retval;
+	const gchar *path;
+	gchar **locked;
+
+	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+
+	/* The service lost our session, open a new one and try again once */
+	if (_secret_util_is_session_error (error) && !closure->retried) {
+		closure->retried = TRUE;
+		g_clear_error (&error);
+		_secret_service_reset_session (self, closure->session);
+		_secret_session_unref (closure->session);
+		closure->session = NULL;
+		secret_service_ensure_session (self, closure->cancellable,
+		                               on_lookup_session, g_object_ref (res));
+
+	/* Advertised but not actually supported, so never try again */
+	} else if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD) ||
+	    g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_INTERFACE)) {
+		g_clear_error (&error);
+		_secret_service_set_search_secrets (self, FALSE);
+		secret_service_search_for_paths (self, closure->attributes, closure->cancellable,
+		                                 on_lookup_searched, g_object_ref (res));
+
+	} else if (error != NULL) {
+		lookup_complete (self, res, error);
+
+	} else {
+		g_variant_get (retval, "(a{o(oayays)}^ao)", &iter, &locked);
+		if (g_variant_iter_next (iter, "{&o@(oayays)}", &path, &variant)) {
+			closure->item_path = g_strdup (path);
+			closure->value = _secret_session_decode_secret (closure->session, variant);
+			if (closure->value == NULL)
+				g_set_error (&error, SECRET_ERROR, SECRET_ERROR_PROTOCOL,
+				             _("Received invalid secret from the secret storage"));
+			g_variant_unref (variant);
+		}
+		g_variant_iter_free (iter);
+
+		if (error != NULL) {
+			lookup_complete (self, res, error);
+
+		/* Nothing unlocked matched, so try to unlock */
+		} else if (closure->value == NULL && locked[0] != NULL) {
+			const gchar *paths[] = { locked[0], NULL };
+			secret_service_unlock_paths (self, paths,
+			                             closure->cancellable,
+			                             on_lookup_unlocked,
+			                             g_object_ref (res));
+
+		} else {
+			if (closure->cache_key && closure->value)
+				_secret_service_cache_store (self, closure->cache_key, closure->cache_generation,
+				                             closure->item_path, closure->value);
+			lookup_complete (self, res, NULL);
+		}
+
+		g_strfreev (locked);
+		g_variant_unref (retval);
+	}
+
+	g_object_unref (self);
+	g_object_unref (res);
+}
+
+static void
+on_lookup_session (GObject *source,
+                   GAsyncResult *result,
+                   gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (source);
+	GError *error = NULL;
+
+	closure->session = _secret_service_ensure_session_take (self, result, &error);
+	if (error != NULL) {
+		lookup_complete (self, res, error);
+
+	} else {
+		g_dbus_connection_call (g_dbus_proxy_get_connection (G_DBUS_PROXY (self)),
+		                        g_dbus_proxy_get_name (G_DBUS_PROXY (self)),
+		                        g_dbus_proxy_get_object_path (G_DBUS_PROXY (self)),
+		                        SECRET_EXTENSIONS_INTERFACE, "SearchItemsWithSecrets",
+		                        g_variant_new ("(@a{ss}o)",
+		                                       _secret_util_variant_for_attributes (closure->attributes),
+		                                       _secret_session_get_path (closure->session)),
+		                        G_VARIANT_TYPE ("(a{o(oayays)}ao)"),
+		                        G_DBUS_CALL_FLAGS_NO_AUTO_START, -1,
+		                        closure->cancellable, on_lookup_searched_secrets,
+		                        g_object_ref (res));
+	}
+
+	g_object_unref (res);
+}
+
+static void        lookup_search             (SecretService *self,
+                                              GSimpleAsyncResult *res);
+
+static void
+on_lookup_introspected (GObject *source,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	SecretService *self = SECRET_SERVICE (g_async_result_get_source_object (user_data));
+	GDBusNodeInfo *node = NULL;
+	gboolean supported = FALSE;
+	GError *error = NULL;
+	GVariant *retval;
+	const gchar *xml;
+
+	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		lookup_complete (self, res, error);
+
+	} else {
+		/* Any other failure means we can't rely on the extension */
+		if (retval != NULL) {
+			g_variant_get (retval, "(&s)", &xml);
+			node = g_dbus_node_info_new_for_xml (xml, NULL);
+		}
+
+		if (node != NULL) {
+			supported = g_dbus_node_info_lookup_interface (node, SECRET_EXTENSIONS_INTERFACE) != NULL;
+			g_dbus_node_info_unref (node);
+		}
+
+		g_clear_error (&error);
+		_secret_service_set_search_secrets (self, supported);
+		lookup_search (self, res);
+	}
+
+	if (retval != NULL)
+		g_variant_unref (retval);
+	g_object_unref (self);
+	g_object_unref (res);
+}
+
+static void
+lookup_search (SecretService *self,
+               GSimpleAsyncResult *res)
+{
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+
+	switch (_secret_service_get_search_secrets (self)) {
+
+	/* Find out once whether the service has the extension */
+	case SECRET_EXTENSION_UNKNOWN:
+		g_dbus_connection_call (g_dbus_proxy_get_connection (G_DBUS_PROXY (self)),
+		                        g_dbus_proxy_get_name (G_DBUS_PROXY (self)),
+		                        g_dbus_proxy_get_object_path (G_DBUS_PROXY (self)),
+		                        "org.freedesktop.DBus.Introspectable", "Introspect",
+		                        NULL, G_VARIANT_TYPE ("(s)"),
+		                        G_DBUS_CALL_FLAGS_NO_AUTO_START, -1,
+		                        closure->cancellable, on_lookup_introspected,
+		                        g_object_ref (res));
+		break;
+
+	/* Search and get the secret in one round trip */
+	case SECRET_EXTENSION_SUPPORTED:
+		secret_service_ensure_session (self, closure->cancellable,
+		                               on_lookup_session, g_object_ref (res));
+		break;
+
+	/* Search, and only open a session once something matched */
+	default:
+		secret_service_search_for_paths (self, closure->attributes, closure->cancellable,
+		                                 on_lookup_searched, g_object_ref (res));
+		break;
+	}
+}
+
+static void
+on_lookup_joined (GObject *source,
+                  GAsyncResult *result,
+                  gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	SecretService *self = SECRET_SERVICE (source);
+	GSimpleAsyncResult *join = G_SIMPLE_ASYNC_RESULT (result);
+	GError *error = NULL;
+	SecretValue *value;
+
+	if (g_simple_async_result_propagate_error (join, &error)) {
+		g_simple_async_result_take_error (res, error);
+
+	/* The lookup we joined was cancelled, this one takes over */
+	} else if (g_simple_async_result_get_op_res_gpointer (join) == &lookup_promoted) {
+		closure->leading = TRUE;
+		lookup_search (self, res);
+		g_object_unref (res);
+		return;
+
+	} else {
+		value = g_simple_async_result_get_op_res_gpointer (join);
+		closure->value = value ? secret_value_ref (value) : NULL;
+	}
+
+	g_simple_async_result_complete (res);
+	g_object_unref (res);
+}
+
+static void
+lookup_start (SecretService *self,
+              GSimpleAsyncResult *res)
+{
+	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GSimpleAsyncResult *join;
+
+	if (closure->cache_key &&
+	    _secret_service_cache_lookup (self, closure->cache_key, &closure->item_path,
+	                                  &closure->value, &closure->cache_generation)) {
+
+		/* The secret itself was cached */
+		if (closure->value) {
+			g_simple_async_result_complete_in_idle (res);
+
+		/* Only the item path was cached */
+		} else {
+			closure->cached_path = TRUE;
+			secret_service_get_secret_for_path (self, closure->item_path, closure->cancellable,
+			                                    on_lookup_get_secret, g_object_ref (res));
+		}
+
+		return;
+	}
+
+	/* Wait for an identical lookup that is already in progress */
+	join = g_simple_async_result_new (G_OBJECT (self), on_lookup_joined,
+	                                  g_object_ref (res), on_lookup_joined);
+	closure->leading = !_secret_service_inflight_join (self, closure->flight_key, join,
+	                                                   closure->cancellable);
+	if (closure->leading)
+		g_object_unref (res);
+	g_object_unref (join);
+
+	if (closure->leading)
+		lookup_search (self, res);
+}
+
+/**
+ * secret_service_lookupv:
+ * @self: the secret service
+ * @schema: the schema to for attributes
+ * @attributes: (element-type utf8 utf8): the attribute keys and values
+ * @cancellable: optional cancellation object
+ * @callback: called when the operation completes
+ * @user_data: data to be passed to the callback
+ *
+ * Lookup a secret value in the secret service.
+ *
+ * The @attributes should be a set of key and value string pairs.
+ *
+ * If an identical lookup is already in progress on this #SecretService, for
+ * example in another thread, then this waits for that lookup and completes
+ * with the same secret value.
+ *
+ * Services that implement the optional
+ * <literal>org.gnome.libsecret.Extensions</literal> interface return the
+ * secret along with the search results, saving a round trip.
+ *
+ * This method will return immediately and complete asynchronously.
+ */
+void
+secret_service_lookupv (SecretService *self,
+                        const SecretSchema *schema,
+                        GHashTable *attributes,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	LookupClosure *closure;
+
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+	g_return_if_fail (schema != NULL);
+	g_return_if_fail (attributes != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	/* Warnings raised already */
+	if (!_secret_util_attributes_validate (schema, attributes))
+		return;
+
+	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
+	                                 secret_service_lookupv);
+	closure = g_slice_new0 (LookupClosure);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	closure->attributes = g_hash_table_ref (attributes);
+	closure->cache_key = _secret_service_cache_key (self, schema, attributes);
+	closure->flight_key = _secret_util_attributes_canonical_key (schema->name, attributes);
+	g_simple_async_result_set_op_res_gpointer (res, closure, lookup_closure_free);
+
+	lookup_start (self, res);
+
+	g_object_unref (res);
+}
+
+/**
+ * secret_service_lookup_finish:
+ * @self: the secret service
+ * @result: the asynchronous result passed to the callback
+ * @error: location to place an error on failure
+ *
+ * Finish asynchronous operation to lookup a secret value in the secret service.
+ *
+ * If no secret is found then %NULL is returned.
+ *
+ * Returns: (transfer full): a newly allocated #SecretValue, which should be
+ *          released with secret_value_unref(), or %NULL if no secret found
+ */
+SecretValue *
+secret_service_lookup_finish (SecretService *self,
+                              GAsyncResult *result,
+                              GError **error)
+{
+	GSimpleAsyncResult *res;
+	LookupClosure *closure;
+	SecretValue *value;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (self),
+	                      secret_service_lookupv), NULL);
+
+	res = G_SIMPLE_ASYNC_RESULT (result);
+	if (g_simple_async_result_propagate_error (res, error))
+		return NULL;
+
+	closure = g_simple_async_result_get_op_res_gpointer (res);
+	value = closure->value;
+	closure->value = NULL;
+	return value;
+}
+
+/**
+ * secret_service_lookup_sync:
+ * @self: the secret service
+ * @schema: the schema to for attributes
+ * @cancellable: optional cancellation object
+ * @error: location to place an error on failure
+ * @...: the attribute keys and values, terminated with %NULL
+ *
+ * Lookup a secret value in the secret service.
+ *
+ * The variable argument list should contain pairs of a) The attribute name as
+ * a null-terminated string, followed by b) attribute value, either a character
+ * string, an int number, or a gboolean value, as defined in the password
+ * @schema. The list of attribtues should be terminated with a %NULL.
+ *
+ * If no secret is found then %NULL is returned.
+ *
+ * This method may block indefinitely and should not be used in user interface
+ * threads.
+ *
+ * Returns: (transfer full): a newly allocated #SecretValue, which should be
+ *          released with secret_value_unref(), or %NULL if no secret found
+ */
+SecretValue *
+secret_service_lookup_sync (SecretService *self,
+                            const SecretSchema *schema,
+                            GCancellable *cancellable,
+                            GError **error,
+                            ...)
+{
+	GHashTable *attributes;
+	SecretValue *value;
+	va_list va;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (schema != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+
+	va_start (va, error);
+	attributes = _secret_util_attributes_for_varargs (schema, va);
+	va_end (va);
+
+	value = secret_service_lookupv_sync (self, schema, attributes, cancellable, error);
+
+	g_hash_table_unref (attributes);
+
+	return value;
+}
+
+/**
+ * secret_service_lookupv_sync:
+ * @self: the secret service
+ * @schema: the schema to for attributes
+ * @attributes: (element-type utf8 utf8): the attribute keys and values
+ * @cancellable: optional cancellation object
+ * @error: location to place an error on failure
+ *
+ * Lookup a secret value in the secret service.
+ *
+ * The @attributes should be a set of key and value string pairs.
+ *
+ * This method may block indefinitely and should not be used in user interface
+ * threads.
+ *
+ * Returns: (transfer full): a newly allocated #SecretValue, which should be
+ *          released with secret_value_unref(), or %NULL if no secret found
+ */
+SecretValue *
+secret_service_lookupv_sync (SecretService *self,
+                             const SecretSchema *schema,
+                             GHashTable *attributes,
+                             GCancellable *cancellable,
+                             GError **error)
+{
+	SecretSync *sync;
+	SecretValue *value;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (schema != NULL, NULL);
+	g_return_val_if_fail (attributes != NULL, NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+
+	/* Warnings raised already */
+	if (!_secret_util_attributes_validate (schema, attributes))
+		return NULL;
+
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	secret_service_lookupv (self, schema, attributes, cancellable,
+	                        _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	value = secret_service_lookup_finish (self, sync->result, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
+
+	return value;
+}
+
+typedef struct {
+	GCancellable *cancellable;
+	guint n_lookups;
+	gchar **paths;
+	gchar **locked;
+	gint searching;
+	GError *error;
+	GPtrArray *results;
+} BatchClosure;
+
+typedef struct {
+	GSimpleAsyncResult *res;
+	guint index;
+} BatchSearch;
+
+static void
+batch_value_unref (gpointer value)
+{
+	if (value != NULL)
+		secret_value_unref (value);
+}
+
+static void
+batch_closure_free (gpointer data)
+{
+	BatchClosure *closure = data;
+	guint i;
+
+	g_clear_object (&closure->cancellable);
+	for (i = 0; i < closure->n_lookups; i++) {
+		g_free (closure->paths[i]);
+		g_free (closure->locked[i]);
+	}
+	g_free (closure->paths);
+	g_free (closure->locked);
+	g_clear_error (&closure->error);
+	if (closure->results)
+		g_ptr_array_unref (closure->results);
+	g_slice_free (BatchClosure, closure);
+}
+
+static void
+on_batch_get_secrets (GObject *source,
+                      GAsyncResult *result,
+                      gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	BatchClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GError *error = NULL;
+	GHashTable *values;
+	SecretValue *value;
+	guint i;
+
+	values = secret_service_get_secrets_for_paths_finish (SECRET_SERVICE (source),
+	                                                      result, &error);
+	if (error != NULL) {
+		g_simple_async_result_take_error (res, error);
+
+	} else {
+		for (i = 0; i < closure->n_lookups; i++) {
+			value = NULL;
+			if (closure->paths[i])
+				value = g_hash_table_lookup (values, closure->paths[i]);
+			g_ptr_array_index (closure->results, i) = value ? secret_value_ref (value) : NULL;
+		}
+		g_hash_table_unref (values);
+	}
+
+	g_simple_async_result_complete (res);
+	g_object_unref (res);
+}
+
+static void
+batch_get_secrets (SecretService *self,
+                   GSimpleAsyncResult *res)
+{
+	BatchClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GHashTable *seen;
+	GPtrArray *paths;
+	guint i;
+
+	/* Several lookups may well match the same item */
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+	paths = g_ptr_array_new ();
+	for (i = 0; i < closure->n_lookups; i++) {
+		if (closure->paths[i] && !g_hash_table_lookup (seen, closure->paths[i])) {
+			g_hash_table_insert (seen, closure->paths[i], closure->paths[i]);
+			g_ptr_array_add (paths, closure->paths[i]);
+		}
+	}
+	g_ptr_array_add (paths, NULL);
+	g_hash_table_destroy (seen);
 
-	secret_service_lookupv (self, schema, attributes, cancellable,
-	                        callback, user_data);
+	if (paths->len == 1) {
+		g_simple_async_result_complete (res);
+	} else {
+		secret_service_get_secrets_for_paths (self, (const gchar **)paths->pdata,
+		                                      closure->cancellable,
+		                                      on_batch_get_secrets,
+		                                      g_object_ref (res));
+	}
 
-	g_hash_table_unref (attributes);
+	g_ptr_array_free (paths, TRUE);
 }
 
 static void
-on_lookup_get_secret (GObject *source,
-                      GAsyncResult *result,
-                      gpointer user_data)
+on_batch_unlocked (GObject *source,
+                   GAsyncResult *result,
+                   gpointer user_data)
 {
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
-	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	BatchClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	SecretService *self = SECRET_SERVICE (source);
 	GError *error = NULL;
+	gchar **unlocked = NULL;
+	guint i, j;
 
-	closure->value = secret_service_get_secret_for_path_finish (self, result, &error);
-	if (error != NULL)
+	secret_service_unlock_paths_finish (self, result, &unlocked, &error);
+	if (error != NULL) {
 		g_simple_async_result_take_error (res, error);
+		g_simple_async_result_complete (res);
 
-	g_simple_async_result_complete (res);
+	} else {
+		for (i = 0; i < closure->n_lookups; i++) {
+			if (closure->locked[i] == NULL)
+				continue;
+			for (j = 0; unlocked && unlocked[j]; j++) {
+				if (g_str_equal (closure->locked[i], unlocked[j])) {
+					closure->paths[i] = g_strdup (unlocked[j]);
+					break;
+				}
+			}
+		}
+
+		batch_get_secrets (self, res);
+	}
+
+	g_strfreev (unlocked);
 	g_object_unref (res);
 }
 
 static void
-on_lookup_unlocked (GObject *source,
-                    GAsyncResult *result,
-                    gpointer user_data)
+batch_searched (SecretService *self,
+                GSimpleAsyncResult *res)
 {
-	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
-	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
-	SecretService *self = SECRET_SERVICE (source);
-	GError *error = NULL;
-	gchar **unlocked = NULL;
+	BatchClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GPtrArray *locked;
+	guint i;
 
-	secret_service_unlock_paths_finish (SECRET_SERVICE (source),
-	                                     result, &unlocked, &error);
-	if (error != NULL) {
-		g_simple_async_result_take_error (res, error);
+	if (closure->error != NULL) {
+		g_simple_async_result_take_error (res, closure->error);
+		closure->error = NULL;
 		g_simple_async_result_complete (res);
+		return;
+	}
 
-	} else if (unlocked && unlocked[0]) {
-		secret_service_get_secret_for_path (self, unlocked[0],
-		                                    closure->cancellable,
-		                                    on_lookup_get_secret,
-		                                    g_object_ref (res));
+	/* Unlock everything that needs it in one go */
+	locked = g_ptr_array_new ();
+	for (i = 0; i < closure->n_lookups; i++) {
+		if (closure->locked[i])
+			g_ptr_array_add (locked, closure->locked[i]);
+	}
+	g_ptr_array_add (locked, NULL);
 
+	if (locked->len == 1) {
+		batch_get_secrets (self, res);
 	} else {
-		g_simple_async_result_complete (res);
+		secret_service_unlock_paths (self, (const gchar **)locked->pdata,
+		                             closure->cancellable, on_batch_unlocked,
+		                             g_object_ref (res));
 	}
 
-	g_strfreev (unlocked);
-	g_object_unref (res);
+	g_ptr_array_free (locked, TRUE);
 }
 
 static void
-on_lookup_searched (GObject *source,
-                    GAsyncResult *result,
-                    gpointer user_data)
+on_batch_search (GObject *source,
+                 GAsyncResult *result,
+                 gpointer user_data)
 {
-	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
-	LookupClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	BatchSearch *search = user_data;
+	BatchClosure *closure = g_simple_async_result_get_op_res_gpointer (search->res);
 	SecretService *self = SECRET_SERVICE (source);
 	GError *error = NULL;
 	gchar **unlocked = NULL;
 	gchar **locked = NULL;
 
+	closure->searching--;
+
 	secret_service_search_for_paths_finish (self, result, &unlocked, &locked, &error);
 	if (error != NULL) {
-		g_simple_async_result_take_error (res, error);
-		g_simple_async_result_complete (res);
-
-	} else if (unlocked && unlocked[0]) {
-		secret_service_get_secret_for_path (self, unlocked[0],
-		                                    closure->cancellable,
-		                                    on_lookup_get_secret,
-		                                    g_object_ref (res));
-
-	} else if (locked && locked[0]) {
-		const gchar *paths[] = { locked[0], NULL };
-		secret_service_unlock_paths (self, paths,
-		                             closure->cancellable,
-		                             on_lookup_unlocked,
-		                             g_object_ref (res));
+		if (closure->error == NULL)
+			closure->error = error;
+		else
+			g_error_free (error);
 
-	} else {
-		g_simple_async_result_complete (res);
+	/* Once another search failed, the batch fails as a whole */
+	} else if (closure->error == NULL) {
+		if (unlocked && unlocked[0])
+			closure->paths[search->index] = g_strdup (unlocked[0]);
+		else if (locked && locked[0])
+			closure->locked[search->index] = g_strdup (locked[0]);
 	}
 
+	if (closure->searching == 0)
+		batch_searched (self, search->res);
+
 	g_strfreev (unlocked);
 	g_strfreev (locked);
-	g_object_unref (res);
+	g_object_unref (search->res);
+	g_slice_free (BatchSearch, search);
 }
 
 /**
- * secret_service_lookupv:
+ * secret_service_lookup_batch:
  * @self: the secret service
- * @schema: the schema to for attributes
- * @attributes: (element-type utf8 utf8): the attribute keys and values
+ * @schemas: (array length=n_lookups): the schema for each set of attributes
+ * @attributes: (array length=n_lookups): the attribute keys and values for each lookup
+ * @n_lookups: the number of lookups
  * @cancellable: optional cancellation object
  * @callback: called when the operation completes
  * @user_data: data to be passed to the callback
  *
- * Lookup a secret value in the secret service.
+ * Lookup many secret values in the secret service at once.
  *
- * The @attributes should be a set of key and value string pairs.
+ * Each of the @attributes should be a set of key and value string pairs, and
+ * is validated against the corresponding schema in @schemas.
+ *
+ * All the searches are sent to the Secret Service without waiting for each
+ * other to complete, and then the secrets for all the matching items are
+ * retrieved together. This is much faster than calling secret_service_lookup()
+ * once for each set of attributes.
  *
  * This method will return immediately and complete asynchronously.
  */
 void
-secret_service_lookupv (SecretService *self,
-                        const SecretSchema *schema,
-                        GHashTable *attributes,
-                        GCancellable *cancellable,
-                        GAsyncReadyCallback callback,
-                        gpointer user_data)
+secret_service_lookup_batch (SecretService *self,
+                             const SecretSchema **schemas,
+                             GHashTable **attributes,
+                             guint n_lookups,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data)
 {
 	GSimpleAsyncResult *res;
-	LookupClosure *closure;
+	BatchClosure *closure;
+	BatchSearch *search;
+	guint i;
 
 	g_return_if_fail (SECRET_IS_SERVICE (self));
-	g_return_if_fail (schema != NULL);
-	g_return_if_fail (attributes != NULL);
+	g_return_if_fail (schemas != NULL || n_lookups == 0);
+	g_return_if_fail (attributes != NULL || n_lookups == 0);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-	/* Warnings raised already */
-	if (!_secret_util_attributes_validate (schema, attributes))
-		return;
+	for (i = 0; i < n_lookups; i++) {
+		g_return_if_fail (schemas[i] != NULL);
+		g_return_if_fail (attributes[i] != NULL);
+
+		/* Warnings raised already */
+		if (!_secret_util_attributes_validate (schemas[i], attributes[i]))
+			return;
+	}
 
 	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
-	                                 secret_service_lookupv);
-	closure = g_slice_new0 (LookupClosure);
+	                                 secret_service_lookup_batch);
+	closure = g_slice_new0 (BatchClosure);
 	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
-	g_simple_async_result_set_op_res_gpointer (res, closure, lookup_closure_free);
+	closure->n_lookups = n_lookups;
+	closure->paths = g_new0 (gchar *, n_lookups + 1);
+	closure->locked = g_new0 (gchar *, n_lookups + 1);
+	closure->results = g_ptr_array_new_with_free_func (batch_value_unref);
+	g_ptr_array_set_size (closure->results, n_lookups);
+	g_simple_async_result_set_op_res_gpointer (res, closure, batch_closure_free);
 
-	secret_service_search_for_paths (self, attributes, cancellable,
-	                                 on_lookup_searched, g_object_ref (res));
+	if (n_lookups == 0) {
+		g_simple_async_result_complete_in_idle (res);
+
+	} else {
+		for (i = 0; i < n_lookups; i++) {
+			search = g_slice_new (BatchSearch);
+			search->res = g_object_ref (res);
+			search->index = i;
+			closure->searching++;
+			secret_service_search_for_paths (self, attributes[i], closure->cancellable,
+			                                 on_batch_search, search);
+		}
+	}
 
 	g_object_unref (res);
 }
 
 /**
- * secret_service_lookup_finish:
+ * secret_service_lookup_batch_finish:
  * @self: the secret service
  * @result: the asynchronous result passed to the callback
  * @error: location to place an error on failure
  *
- * Finish asynchronous operation to lookup a secret value in the secret service.
+ * Finish asynchronous operation to lookup many secret values in the secret
+ * service.
  *
- * If no secret is found then %NULL is returned.
+ * The result contains one entry for each lookup, in the same order as they
+ * were passed to secret_service_lookup_batch(). Entries for lookups where
+ * no secret was found are %NULL.
  *
- * Returns: (transfer full): a newly allocated #SecretValue, which should be
- *          released with secret_value_unref(), or %NULL if no secret found
+ * Returns: (transfer full) (element-type Secret.Value): an array of
+ *          #SecretValue or %NULL entries, which should be released with
+ *          g_ptr_array_unref(), or %NULL if an error occurred
  */
-SecretValue *
-secret_service_lookup_finish (SecretService *self,
-                              GAsyncResult *result,
-                              GError **error)
+GPtrArray *
+secret_service_lookup_batch_finish (SecretService *self,
+                                    GAsyncResult *result,
+                                    GError **error)
 {
 	GSimpleAsyncResult *res;
-	LookupClosure *closure;
-	SecretValue *value;
+	BatchClosure *closure;
 
 	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 	g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (self),
-	                      secret_service_lookupv), NULL);
+	                      secret_service_lookup_batch), NULL);
 
 	res = G_SIMPLE_ASYNC_RESULT (result);
 	if (g_simple_async_result_propagate_error (res, error))
 		return NULL;
 
 	closure = g_simple_async_result_get_op_res_gpointer (res);
-	value = closure->value;
-	closure->value = NULL;
-	return value;
+	return g_ptr_array_ref (closure->results);
 }
 
 /**
- * secret_service_lookup_sync:
+ * secret_service_lookup_batch_sync:
  * @self: the secret service
- * @schema: the schema to for attributes
+ * @schemas: (array length=n_lookups): the schema for each set of attributes
+ * @attributes: (array length=n_lookups): the attribute keys and values for each lookup
+ * @n_lookups: the number of lookups
  * @cancellable: optional cancellation object
  * @error: location to place an error on failure
- * @...: the attribute keys and values, terminated with %NULL
- *
- * Lookup a secret value in the secret service.
- *
- * The variable argument list should contain pairs of a) The attribute name as
- * a null-terminated string, followed by b) attribute value, either a character
- * string, an int number, or a gboolean value, as defined in the password
- * @schema. The list of attribtues should be terminated with a %NULL.
- *
- * If no secret is found then %NULL is returned.
  *
- * This method may block indefinitely and should not be used in user interface
- * threads.
- *
- * Returns: (transfer full): a newly allocated #SecretValue, which should be
- *          released with secret_value_unref(), or %NULL if no secret found
- */
-SecretValue *
-secret_service_lookup_sync (SecretService *self,
-                            const SecretSchema *schema,
-                            GCancellable *cancellable,
-                            GError **error,
-                            ...)
-{
-	GHashTable *attributes;
-	SecretValue *value;
-	va_list va;
-
-	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
-	g_return_val_if_fail (schema != NULL, NULL);
-	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
-
-	va_start (va, error);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
-	va_end (va);
-
-	value = secret_service_lookupv_sync (self, schema, attributes, cancellable, error);
-
-	g_hash_table_unref (attributes);
-
-	return value;
-}
-
-/**
- * secret_service_lookupv_sync:
- * @self: the secret service
- * @schema: the schema to for attributes
- * @attributes: (element-type utf8 utf8): the attribute keys and values
- * @cancellable: optional cancellation object
- * @error: location to place an error on failure
+ * Lookup many secret values in the secret service at once.
  *
- * Lookup a secret value in the secret service.
+ * Each of the @attributes should be a set of key and value string pairs, and
+ * is validated against the corresponding schema in @schemas.
  *
- * The @attributes should be a set of key and value string pairs.
+ * The result contains one entry for each lookup, in the same order as the
+ * @attributes. Entries for lookups where no secret was found are %NULL.
  *
  * This method may block indefinitely and should not be used in user interface
  * threads.
  *
- * Returns: (transfer full): a newly allocated #SecretValue, which should be
- *          released with secret_value_unref(), or %NULL if no secret found
+ * Returns: (transfer full) (element-type Secret.Value): an array of
+ *          #SecretValue or %NULL entries, which should be released with
+ *          g_ptr_array_unref(), or %NULL if an error occurred
  */
-SecretValue *
-secret_service_lookupv_sync (SecretService *self,
-                             const SecretSchema *schema,
-                             GHashTable *attributes,
-                             GCancellable *cancellable,
-                             GError **error)
+GPtrArray *
+secret_service_lookup_batch_sync (SecretService *self,
+                                  const SecretSchema **schemas,
+                                  GHashTable **attributes,
+                                  guint n_lookups,
+                                  GCancellable *cancellable,
+                                  GError **error)
 {
 	SecretSync *sync;
-	SecretValue *value;
+	GPtrArray *values;
+	guint i;
 
 	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
-	g_return_val_if_fail (schema != NULL, NULL);
-	g_return_val_if_fail (attributes != NULL, NULL);
+	g_return_val_if_fail (schemas != NULL || n_lookups == 0, NULL);
+	g_return_val_if_fail (attributes != NULL || n_lookups == 0, NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
 	/* Warnings raised already */
-	if (!_secret_util_attributes_validate (schema, attributes))
-		return NULL;
+	for (i = 0; i < n_lookups; i++) {
+		if (!_secret_util_attributes_validate (schemas[i], attributes[i]))
+			return NULL;
+	}
 
 	sync = _secret_sync_new ();
 	g_main_context_push_thread_default (sync->context);
 
-	secret_service_lookupv (self, schema, attributes, cancellable,
-	                        _secret_sync_on_result, sync);
+	secret_service_lookup_batch (self, schemas, attributes, n_lookups, cancellable,
+	                             _secret_sync_on_result, sync);
 
 	g_main_loop_run (sync->loop);
 
-	value = secret_service_lookup_finish (self, sync->result, error);
+	values = secret_service_lookup_batch_finish (self, sync->result, error);
 
 	g_main_context_pop_thread_default (sync->context);
 	_secret_sync_free (sync);
 
-	return value;
+	return values;
 }
 
 typedef struct {
@@ -2300,6 +3510,7 @@ on_delete_prompted (GObject *source,
 	GError *error = NULL;
 
 	secret_service_prompt_finish (SECRET_SERVICE (source), result, &error);
+	_secret_service_cache_invalidate (SECRET_SERVICE (source));
 
 	if (error == NULL)
 		closure->deleted = TRUE;
@@ -2324,6 +3535,7 @@ on_delete_complete (GObject *source,
 
 	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
 	if (error == NULL) {
+		_secret_service_cache_invalidate (self);
 		g_variant_get (retval, "(&o)", &prompt_path);
 
 		if (_secret_util_empty_path (prompt_path)) {
@@ -2577,7 +3789,7 @@ secret_service_remove (SecretService *self,
                        gpointer user_data,
                        ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
 	va_list va;
 
 	g_return_if_fail (SECRET_SERVICE (self));
@@ -2585,13 +3797,15 @@ secret_service_remove (SecretService *self,
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	va_start (va, user_data);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	secret_service_removev (self, schema, attributes, cancellable,
-	                        callback, user_data);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return;
 
-	g_hash_table_unref (attributes);
+	_secret_service_remove_attributes (self, attributes, cancellable,
+	                                   callback, user_data);
 }
 
 /**
@@ -2619,9 +3833,6 @@ secret_service_removev (SecretService *self,
                         GAsyncReadyCallback callback,
                         gpointer user_data)
 {
-	GSimpleAsyncResult *res;
-	DeleteClosure *closure;
-
 	g_return_if_fail (SECRET_SERVICE (self));
 	g_return_if_fail (schema != NULL);
 	g_return_if_fail (attributes != NULL);
@@ -2631,14 +3842,33 @@ secret_service_removev (SecretService *self,
 	if (!_secret_util_attributes_validate (schema, attributes))
 		return;
 
+	_secret_service_remove_attributes (self, _secret_util_variant_for_attributes (attributes),
+	                                   cancellable, callback, user_data);
+}
+
+/*
+ * Remove a secret matching attributes already validated against the schema,
+ * and in an a{ss} variant. If floating, the variant is consumed. Completes
+ * with secret_service_remove_finish().
+ */
+void
+_secret_service_remove_attributes (SecretService *self,
+                                   GVariant *attributes,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	DeleteClosure *closure;
+
 	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
 	                                 secret_service_remove);
 	closure = g_slice_new0 (DeleteClosure);
 	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
 	g_simple_async_result_set_op_res_gpointer (res, closure, delete_closure_free);
 
-	secret_service_search_for_paths (self, attributes, cancellable,
-	                                 on_search_delete_password, g_object_ref (res));
+	search_for_paths_variant (self, attributes, cancellable,
+	                          on_search_delete_password, g_object_ref (res));
 
 	g_object_unref (res);
 }
@@ -2704,7 +3934,8 @@ secret_service_remove_sync (SecretService *self,
                             GError **error,
                             ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
+	SecretSync *sync;
 	gboolean result;
 	va_list va;
 
@@ -2714,12 +3945,25 @@ secret_service_remove_sync (SecretService *self,
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	va_start (va, error);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	result = secret_service_removev_sync (self, schema, attributes, cancellable, error);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return FALSE;
 
-	g_hash_table_unref (attributes);
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	_secret_service_remove_attributes (self, attributes, cancellable,
+	                                   _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	result = secret_service_remove_finish (self, sync->result, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
 
 	return result;
 }
@@ -3030,12 +4274,15 @@ typedef struct {
 	gchar *collection_path;
 	SecretPrompt *prompt;
 	gchar *item_path;
+	SecretSession *session;
+	gboolean retried;
 } ItemClosure;
 
 static void
 item_closure_free (gpointer data)
 {
 	ItemClosure *closure = data;
+	_secret_session_unref (closure->session);
 	g_variant_unref (closure->properties);
 	secret_value_unref (closure->value);
 	g_clear_object (&closure->cancellable);
@@ -3059,6 +4306,8 @@ on_create_item_prompt (GObject *source,
 	if (error != NULL)
 		g_simple_async_result_take_error (res, error);
 
+	_secret_service_cache_invalidate (SECRET_SERVICE (source));
+
 	if (created) {
 		value = secret_prompt_get_result_value (closure->prompt, G_VARIANT_TYPE ("o"));
 		closure->item_path = g_variant_dup_string (value, NULL);
@@ -3069,6 +4318,10 @@ on_create_item_prompt (GObject *source,
 	g_object_unref (res);
 }
 
+static void          on_create_item_session      (GObject *source,
+                                                  GAsyncResult *result,
+                                                  gpointer user_data);
+
 static void
 on_create_item_called (GObject *source,
                        GAsyncResult *result,
@@ -3083,7 +4336,22 @@ on_create_item_called (GObject *source,
 	GVariant *retval;
 
 	retval = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+
+	/* The service lost our session, open a new one and try again once */
+	if (_secret_util_is_session_error (error) && !closure->retried) {
+		closure->retried = TRUE;
+		g_clear_error (&error);
+		_secret_service_reset_session (self, closure->session);
+		_secret_session_unref (closure->session);
+		closure->session = NULL;
+		secret_service_ensure_session (self, closure->cancellable,
+		                               on_create_item_session, res);
+		g_object_unref (self);
+		return;
+	}
+
 	if (error == NULL) {
+		_secret_service_cache_invalidate (self);
 		g_variant_get (retval, "(&o&o)", &item_path, &prompt_path);
 		if (!_secret_util_empty_path (prompt_path)) {
 			closure->prompt = _secret_prompt_instance (self, prompt_path);
@@ -3115,17 +4383,15 @@ on_create_item_session (GObject *source,
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
 	ItemClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	SecretService *self = SECRET_SERVICE (source);
-	SecretSession *session;
 	GVariant *params;
 	GError *error = NULL;
 	GDBusProxy *proxy;
 
-	secret_service_ensure_session_finish (self, result, &error);
+	closure->session = _secret_service_ensure_session_take (self, result, &error);
 	if (error == NULL) {
-		session = _secret_service_get_session (self);
 		params = g_variant_new ("(@a{sv}@(oayays)b)",
 		                        closure->properties,
-		                        _secret_session_encode_secret (session, closure->value),
+		                        _secret_session_encode_secret (closure->session, closure->value),
 		                        closure->replace);
 
 		proxy = G_DBUS_PROXY (self);
@@ -39,7 +39,7 @@
 
 typedef struct {
 	const SecretSchema *schema;
-	GHashTable *attributes;
+	GVariant *attributes;
 	gchar *collection_path;
 	gchar *label;
 	SecretValue *value;
@@ -52,7 +52,7 @@ store_closure_free (gpointer data)
 {
 	StoreClosure *closure = data;
 	_secret_schema_unref_if_nonstatic (closure->schema);
-	g_hash_table_unref (closure->attributes);
+	g_variant_unref (closure->attributes);
 	g_free (closure->collection_path);
 	g_free (closure->label);
 	secret_value_unref (closure->value);
@@ -90,13 +90,13 @@ on_store_connected (GObject *source,
 
 	service = secret_service_get_finish (result, &error);
 	if (error == NULL) {
-		secret_service_storev (service, closure->schema,
-		                       closure->attributes,
-		                       closure->collection_path,
-		                       closure->label, closure->value,
-		                       closure->cancellable,
-		                       on_store_complete,
-		                       g_object_ref (res));
+		_secret_service_store_attributes (service, closure->schema,
+		                                  closure->attributes,
+		                                  closure->collection_path,
+		                                  closure->label, closure->value,
+		                                  closure->cancellable,
+		                                  on_store_complete,
+		                                  g_object_ref (res));
 		g_object_unref (service);
 
 	} else {
@@ -107,6 +107,36 @@ on_store_connected (GObject *source,
 	g_object_unref (res);
 }
 
+static void
+password_store_attributes (const SecretSchema *schema,
+                           GVariant *attributes,
+                           const gchar *collection_path,
+                           const gchar *label,
+                           const gchar *password,
+                           GCancellable *cancellable,
+                           GAsyncReadyCallback callback,
+                           gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	StoreClosure *closure;
+
+	res = g_simple_async_result_new (NULL, callback, user_data,
+	                                 secret_password_storev);
+	closure = g_slice_new0 (StoreClosure);
+	closure->schema = _secret_schema_ref_if_nonstatic (schema);
+	closure->collection_path = g_strdup (collection_path);
+	closure->label = g_strdup (label);
+	closure->value = secret_value_new (password, -1, "text/plain");
+	closure->attributes = g_variant_ref_sink (attributes);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	g_simple_async_result_set_op_res_gpointer (res, closure, store_closure_free);
+
+	secret_service_get (SECRET_SERVICE_OPEN_SESSION, cancellable,
+	                    on_store_connected, g_object_ref (res));
+
+	g_object_unref (res);
+}
+
 /**
  * secret_password_store:
  * @schema: the schema for attributes
@@ -144,7 +174,7 @@ secret_password_store (const SecretSchema *schema,
                        gpointer user_data,
                        ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
 	va_list va;
 
 	g_return_if_fail (schema != NULL);
@@ -153,13 +183,15 @@ secret_password_store (const SecretSchema *schema,
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	va_start (va, user_data);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	secret_password_storev (schema, attributes, collection_path, label, password,
-	                        cancellable, callback, user_data);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return;
 
-	g_hash_table_unref (attributes);
+	password_store_attributes (schema, attributes, collection_path, label,
+	                           password, cancellable, callback, user_data);
 }
 
 /**
@@ -198,9 +230,6 @@ secret_password_storev (const SecretSchema *schema,
                         GAsyncReadyCallback callback,
                         gpointer user_data)
 {
-	GSimpleAsyncResult *res;
-	StoreClosure *closure;
-
 	g_return_if_fail (schema != NULL);
 	g_return_if_fail (label != NULL);
 	g_return_if_fail (password != NULL);
@@ -211,21 +240,9 @@ secret_password_storev (const SecretSchema *schema,
 	if (!_secret_util_attributes_validate (schema, attributes))
 		return;
 
-	res = g_simple_async_result_new (NULL, callback, user_data,
-	                                 secret_password_storev);
-	closure = g_slice_new0 (StoreClosure);
-	closure->schema = _secret_schema_ref_if_nonstatic (schema);
-	closure->collection_path = g_strdup (collection_path);
-	closure->label = g_strdup (label);
-	closure->value = secret_value_new (password, -1, "text/plain");
-	closure->attributes = _secret_util_attributes_copy (attributes);
-	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
-	g_simple_async_result_set_op_res_gpointer (res, closure, store_closure_free);
-
-	secret_service_get (SECRET_SERVICE_OPEN_SESSION, cancellable,
-	                    on_store_connected, g_object_ref (res));
-
-	g_object_unref (res);
+	password_store_attributes (schema, _secret_util_variant_for_attributes (attributes),
+	                           collection_path, label, password,
+	                           cancellable, callback, user_data);
 }
 
 /**
@@ -295,7 +312,8 @@ secret_password_store_sync (const SecretSchema *schema,
                             GError **error,
                             ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
+	SecretSync *sync;
 	va_list va;
 	gboolean ret;
 
@@ -306,13 +324,26 @@ secret_password_store_sync (const SecretSchema *schema,
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	va_start (va, error);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	ret = secret_password_storev_sync (schema, attributes, collection_path,
-	                                   label, password, cancellable, error);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return FALSE;
+
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	password_store_attributes (schema, attributes, collection_path, label,
+	                           password, cancellable, _secret_sync_on_result, sync);
+
+	g_main_loop_run (sync->loop);
+
+	ret = secret_password_store_finish (sync->result, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
 
-	g_hash_table_unref (attributes);
 	return ret;
 }
 
@@ -821,9 +852,8 @@ secret_password_lookupv_sync (const SecretSchema *schema,
 
 typedef struct {
 	GCancellable *cancellable;
-	GHashTable *attributes;
+	GVariant *attributes;
 	gboolean deleted;
-	const SecretSchema *schema;
 } DeleteClosure;
 
 static void
@@ -831,53 +861,10 @@ delete_closure_free (gpointer data)
 {
 	DeleteClosure *closure = data;
 	g_clear_object (&closure->cancellable);
-	g_hash_table_unref (closure->attributes);
-	_secret_schema_unref_if_nonstatic (closure->schema);
+	g_variant_unref (closure->attributes);
 	g_slice_free (DeleteClosure, closure);
 }
 
-/**
- * secret_password_remove:
- * @schema: the schema to for attributes
- * @cancellable: optional cancellation object
- * @callback: called when the operation completes
- * @user_data: data to be passed to the callback
- * @...: the attribute keys and values, terminated with %NULL
- *
- * Remove a password from the secret service.
- *
- * The variable argument list should contain pairs of a) The attribute name as
- * a null-terminated string, followed by b) attribute value, either a character
- * string, an int number, or a gboolean value, as defined in the password
- * @schema. The list of attribtues should be terminated with a %NULL.
- *
- * If multiple items match the attributes, then only one will be deleted.
- *
- * This method will return immediately and complete asynchronously.
- */
-void
-secret_password_remove (const SecretSchema *schema,
-                        GCancellable *cancellable,
-                        GAsyncReadyCallback callback,
-                        gpointer user_data,
-                        ...)
-{
-	GHashTable *attributes;
-	va_list va;
-
-	g_return_if_fail (schema != NULL);
-	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-
-	va_start (va, user_data);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
-	va_end (va);
-
-	secret_password_removev (schema, attributes, cancellable,
-	                         callback, user_data);
-
-	g_hash_table_unref (attributes);
-}
-
 static void
 on_delete_complete (GObject *source,
                     GAsyncResult *result,
@@ -908,9 +895,9 @@ on_delete_connect (GObject *source,
 
 	service = secret_service_get_finish (result, &error);
 	if (error == NULL) {
-		secret_service_removev (service, closure->schema, closure->attributes,
-		                        closure->cancellable, on_delete_complete,
-		                        g_object_ref (res));
+		_secret_service_remove_attributes (service, closure->attributes,
+		                                   closure->cancellable, on_delete_complete,
+		                                   g_object_ref (res));
 		g_object_unref (service);
 
 	} else {
@@ -921,6 +908,71 @@ on_delete_connect (GObject *source,
 	g_object_unref (res);
 }
 
+static void
+password_remove_attributes (GVariant *attributes,
+                            GCancellable *cancellable,
+                            GAsyncReadyCallback callback,
+                            gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	DeleteClosure *closure;
+
+	res = g_simple_async_result_new (NULL, callback, user_data,
+	                                 secret_password_removev);
+	closure = g_slice_new0 (DeleteClosure);
+	closure->attributes = g_variant_ref_sink (attributes);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	g_simple_async_result_set_op_res_gpointer (res, closure, delete_closure_free);
+
+	secret_service_get (SECRET_SERVICE_NONE, cancellable,
+	                    on_delete_connect, g_object_ref (res));
+
+	g_object_unref (res);
+}
+
+/**
+ * secret_password_remove:
+ * @schema: the schema to for attributes
+ * @cancellable: optional cancellation object
+ * @callback: called when the operation completes
+ * @user_data: data to be passed to the callback
+ * @...: the attribute keys and values, terminated with %NULL
+ *
+ * Remove a password from the secret service.
+ *
+ * The variable argument list should contain pairs of a) The attribute name as
+ * a null-terminated string, followed by b) attribute value, either a character
+ * string, an int number, or a gboolean value, as defined in the password
+ * @schema. The list of attribtues should be terminated with a %NULL.
+ *
+ * If multiple items match the attributes, then only one will be deleted.
+ *
+ * This method will return immediately and complete asynchronously.
+ */
+void
+secret_password_remove (const SecretSchema *schema,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data,
+                        ...)
+{
+	GVariant *attributes;
+	va_list va;
+
+	g_return_if_fail (schema != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	va_start (va, user_data);
+	attributes = _secret_util_variant_for_varargs (schema, va);
+	va_end (va);
+
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return;
+
+	password_remove_attributes (attributes, cancellable, callback, user_data);
+}
+
 /**
  * secret_password_removev:
  * @schema: (allow-none): the schema to for attributes
@@ -946,9 +998,6 @@ secret_password_removev (const SecretSchema *schema,
                          GAsyncReadyCallback callback,
                          gpointer user_data)
 {
-	GSimpleAsyncResult *res;
-	DeleteClosure *closure;
-
 	g_return_if_fail (attributes != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
@@ -956,18 +1005,8 @@ secret_password_removev (const SecretSchema *schema,
 	if (!_secret_util_attributes_validate (schema, attributes))
 		return;
 
-	res = g_simple_async_result_new (NULL, callback, user_data,
-	                                 secret_password_removev);
-	closure = g_slice_new0 (DeleteClosure);
-	closure->schema = _secret_schema_ref_if_nonstatic (schema);
-	closure->attributes = _secret_util_attributes_copy (attributes);
-	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
-	g_simple_async_result_set_op_res_gpointer (res, closure, delete_closure_free);
-
-	secret_service_get (SECRET_SERVICE_NONE, cancellable,
-	                    on_delete_connect, g_object_ref (res));
-
-	g_object_unref (res);
+	password_remove_attributes (_secret_util_variant_for_attributes (attributes),
+	                            cancellable, callback, user_data);
 }
 
 /**
@@ -1026,7 +1065,8 @@ secret_password_remove_sync (const SecretSchema* schema,
                              GError **error,
                              ...)
 {
-	GHashTable *attributes;
+	GVariant *attributes;
+	SecretSync *sync;
 	gboolean result;
 	va_list va;
 
@@ -1035,13 +1075,25 @@ secret_password_remove_sync (const SecretSchema* schema,
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
 	va_start (va, error);
-	attributes = _secret_util_attributes_for_varargs (schema, va);
+	attributes = _secret_util_variant_for_varargs (schema, va);
 	va_end (va);
 
-	result = secret_password_removev_sync (schema, attributes,
-	                                       cancellable, error);
+	/* Warnings raised already */
+	if (attributes == NULL)
+		return FALSE;
+
+	sync = _secret_sync_new ();
+	g_main_context_push_thread_default (sync->context);
+
+	password_remove_attributes (attributes, cancellable,
+	                            _secret_sync_on_result, sync);
 
-	g_hash_table_unref (attributes);
+	g_main_loop_run (sync->loop);
+
+	result = secret_password_remove_finish (sync->result, error);
+
+	g_main_context_pop_thread_default (sync->context);
+	_secret_sync_free (sync);
 
 	return result;
 }
@@ -20,14 +20,29 @@
 
 G_BEGIN_DECLS
 
-typedef struct {
+typedef struct _SecretSync SecretSync;
+
+struct _SecretSync {
 	GAsyncResult *result;
 	GMainContext *context;
 	GMainLoop *loop;
-} SecretSync;
+	gboolean retained;
+	guint holds;
+	SecretSync *outer;
+};
 
 typedef struct _SecretSession SecretSession;
 
+typedef struct _SecretWaiter SecretWaiter;
+
+typedef struct _SecretValueArena SecretValueArena;
+
+typedef enum {
+	SECRET_EXTENSION_UNKNOWN,
+	SECRET_EXTENSION_SUPPORTED,
+	SECRET_EXTENSION_MISSING
+} SecretExtensionState;
+
 #define              SECRET_SERVICE_PATH                      "/org/freedesktop/secrets"
 
 #define              SECRET_SERVICE_BUS_NAME                  "org.freedesktop.Secret.Service"
@@ -36,6 +51,9 @@ typedef struct _SecretSession SecretSession;
 #define              SECRET_COLLECTION_INTERFACE              "org.freedesktop.Secret.Collection"
 #define              SECRET_PROMPT_INTERFACE                  "org.freedesktop.Secret.Prompt"
 #define              SECRET_SERVICE_INTERFACE                 "org.freedesktop.Secret.Service"
+#define              SECRET_SESSION_INTERFACE                 "org.freedesktop.Secret.Session"
+/* Optional, not part of the Secret Service spec; probed for before use */
+#define              SECRET_EXTENSIONS_INTERFACE              "org.gnome.libsecret.Extensions"
 
 #define              SECRET_PROMPT_SIGNAL_COMPLETED           "Completed"
 
@@ -49,6 +67,19 @@ void                 _secret_sync_on_result                   (GObject *source,
                                                                GAsyncResult *result,
                                                                gpointer user_data);
 
+void                 _secret_sync_retain_context              (void);
+
+SecretSync *         _secret_sync_hold                        (void);
+
+void                 _secret_sync_release                     (SecretSync *sync);
+
+SecretWaiter *       _secret_waiter_new                       (GSimpleAsyncResult *res,
+                                                               GCancellable *cancellable);
+
+GSimpleAsyncResult * _secret_waiter_claim                     (SecretWaiter *waiter);
+
+void                 _secret_waiter_free                      (gpointer data);
+
 SecretPrompt *       _secret_prompt_instance                  (SecretService *service,
                                                                const gchar *prompt_path);
 
@@ -65,8 +96,14 @@ GHashTable *         _secret_util_attributes_for_variant      (GVariant *variant
 GHashTable *         _secret_util_attributes_for_varargs      (const SecretSchema *schema,
                                                                va_list va);
 
+GVariant *           _secret_util_variant_for_varargs         (const SecretSchema *schema,
+                                                               va_list va);
+
 GHashTable *         _secret_util_attributes_copy             (GHashTable *attributes);
 
+gchar *              _secret_util_attributes_canonical_key    (const gchar *schema_name,
+                                                               GHashTable *attributes);
+
 gboolean             _secret_util_attributes_validate         (const SecretSchema *schema,
                                                                GHashTable *attributes);
 
@@ -104,13 +141,20 @@ gboolean             _secret_util_set_property_sync           (GDBusProxy *proxy
 
 gboolean             _secret_util_have_cached_properties      (GDBusProxy *proxy);
 
+gboolean             _secret_util_is_session_error            (GError *error);
+
 void                 _secret_service_set_default_bus_name     (const gchar *bus_name);
 
-SecretSession *      _secret_service_get_session              (SecretService *self);
+SecretSession *      _secret_service_ensure_session_take      (SecretService *self,
+                                                               GAsyncResult *result,
+                                                               GError **error);
 
 void                 _secret_service_take_session             (SecretService *self,
                                                                SecretSession *session);
 
+void                 _secret_service_reset_session            (SecretService *self,
+                                                               SecretSession *session);
+
 void                 _secret_service_delete_path              (SecretService *self,
                                                                const gchar *object_path,
                                                                gboolean is_an_item,
@@ -121,14 +165,122 @@ void                 _secret_service_delete_path              (SecretService *se
 SecretItem *         _secret_service_find_item_instance       (SecretService *self,
                                                                const gchar *item_path);
 
+gchar *              _secret_service_cache_key                (SecretService *self,
+                                                               const SecretSchema *schema,
+                                                               GHashTable *attributes);
+
+gboolean             _secret_service_cache_lookup             (SecretService *self,
+                                                               const gchar *key,
+                                                               gchar **item_path,
+                                                               SecretValue **value,
+                                                               guint *generation);
+
+void                 _secret_service_cache_store              (SecretService *self,
+                                                               const gchar *key,
+                                                               guint generation,
+                                                               const gchar *item_path,
+                                                               SecretValue *value);
+
+guint                _secret_service_cache_invalidate         (SecretService *self);
+
+SecretExtensionState _secret_service_get_search_secrets       (SecretService *self);
+
+void                 _secret_service_set_search_secrets       (SecretService *self,
+                                                               gboolean supported);
+
+SecretExtensionState _secret_service_get_x25519               (SecretService *self);
+
+void                 _secret_service_set_x25519               (SecretService *self,
+                                                               gboolean supported);
+
+gboolean             _secret_service_inflight_join            (SecretService *self,
+                                                               const gchar *key,
+                                                               GSimpleAsyncResult *join,
+                                                               GCancellable *cancellable);
+
+GSimpleAsyncResult * _secret_service_inflight_promote         (SecretService *self,
+                                                               const gchar *key);
+
+GPtrArray *          _secret_service_inflight_release         (SecretService *self,
+                                                               const gchar *key);
+
+void                 _secret_item_load_paths                  (SecretService *service,
+                                                               const gchar **paths,
+                                                               GCancellable *cancellable,
+                                                               GAsyncReadyCallback callback,
+                                                               gpointer user_data);
+
+GHashTable *         _secret_item_load_paths_finish           (GAsyncResult *result,
+                                                               GError **error);
+
+GHashTable *         _secret_item_load_paths_sync             (SecretService *service,
+                                                               const gchar **paths,
+                                                               GCancellable *cancellable,
+                                                               GError **error);
+
+void                 _secret_item_load_properties             (SecretService *service,
+                                                               const gchar **paths,
+                                                               GCancellable *cancellable,
+                                                               GAsyncReadyCallback callback,
+                                                               gpointer user_data);
+
+GHashTable *         _secret_item_load_properties_finish      (GAsyncResult *result,
+                                                               GError **error);
+
+SecretItemHandle *   _secret_item_handle_new                  (const gchar *item_path,
+                                                               GVariant *properties);
+
+void                 _secret_service_store_attributes         (SecretService *self,
+                                                               const SecretSchema *schema,
+                                                               GVariant *attributes,
+                                                               const gchar *collection_path,
+                                                               const gchar *label,
+                                                               SecretValue *value,
+                                                               GCancellable *cancellable,
+                                                               GAsyncReadyCallback callback,
+                                                               gpointer user_data);
+
+void                 _secret_service_remove_attributes        (SecretService *self,
+                                                               GVariant *attributes,
+                                                               GCancellable *cancellable,
+                                                               GAsyncReadyCallback callback,
+                                                               gpointer user_data);
+
 SecretItem *         _secret_collection_find_item_instance    (SecretCollection *self,
                                                                const gchar *item_path);
 
+gboolean             _secret_collection_load_items_sync       (SecretCollection *self,
+                                                               GCancellable *cancellable,
+                                                               GError **error);
+
 gchar *              _secret_value_unref_to_password          (SecretValue *value);
 
 gchar *              _secret_value_unref_to_string            (SecretValue *value);
 
-void                 _secret_session_free                     (gpointer data);
+SecretValueArena *   _secret_value_arena_new                  (gsize length);
+
+gchar *              _secret_value_arena_alloc                (SecretValueArena *arena,
+                                                               gsize length);
+
+void                 _secret_value_arena_unref                (SecretValueArena *arena);
+
+SecretValue *        _secret_value_new_in_arena               (SecretValueArena *arena,
+                                                               gchar *secret,
+                                                               gsize length,
+                                                               const gchar *content_type);
+
+SecretValueArray *   _secret_value_array_new                  (GVariant *reply,
+                                                               guint n_values);
+
+void                 _secret_value_array_take                 (SecretValueArray *array,
+                                                               const gchar *path,
+                                                               SecretValue *value);
+
+SecretSession *      _secret_session_ref                      (SecretSession *session);
+
+void                 _secret_session_unref                    (gpointer data);
+
+void                 _secret_session_retire                   (SecretSession *session);
 
 const gchar *        _secret_session_get_algorithms           (SecretSession *session);
 
@@ -148,10 +300,17 @@ GVariant *           _secret_session_encode_secret            (SecretSession *se
 SecretValue *        _secret_session_decode_secret            (SecretSession *session,
                                                                GVariant *encoded);
 
+SecretValueArray *   _secret_session_decode_secrets           (SecretSession *session,
+                                                               GVariant *reply);
+
 const SecretSchema * _secret_schema_ref_if_nonstatic          (const SecretSchema *schema);
 
 void                 _secret_schema_unref_if_nonstatic        (const SecretSchema *schema);
 
+const SecretSchemaAttribute *
+                     _secret_schema_find_attribute            (const SecretSchema *schema,
+                                                               const gchar *name);
+
 G_END_DECLS
 
 #endif /* __SECRET_PRIVATE_H___ */
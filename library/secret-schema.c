@@ -19,6 +19,8 @@
 
 #include <egg/egg-secure-memory.h>
 
+#include <string.h>
+
 /**
  * SECTION:secret-schema
  * @title: SecretSchema
@@ -83,6 +85,18 @@
  * to store integer and boolean values as strings.
  */
 
+/*
+ * An index of the attributes of a schema: their positions in the attributes
+ * array, in the order of their names. Built lazily for schemas allocated by
+ * secret_schema_new() and stored in @reserved1, and precomputed below for the
+ * predefined schemas. Other static schemas may live in read only memory, or
+ * go away without us knowing, so they're searched linearly.
+ */
+typedef struct {
+	guint8 n_attributes;
+	guint8 sorted[32];
+} SchemaIndex;
+
 static const SecretSchema network_schema = {
 	SECRET_SCHEMA_IDENTIFIER_NETWORK,
 	SECRET_SCHEMA_NONE,
@@ -97,6 +111,9 @@ static const SecretSchema network_schema = {
 	}
 };
 
+/* user, domain, object, protocol, port, server, NULL sorted by name */
+static const SchemaIndex network_index = { 7, { 6, 1, 2, 4, 3, 5, 0 } };
+
 const SecretSchema *  SECRET_SCHEMA_NETWORK = &network_schema;
 
 static const SecretSchema generic_schema = {
@@ -119,6 +136,108 @@ static const SecretSchema note_schema = {
 
 const SecretSchema *  SECRET_SCHEMA_NOTE = &note_schema;
 
+/* The generic and note schemas only have the one attribute */
+static const SchemaIndex single_index = { 1, { 0 } };
+
+static SchemaIndex *
+schema_index_build (const SecretSchema *schema)
+{
+	SchemaIndex *index;
+	guint8 position;
+	gint i, j;
+
+	index = g_new0 (SchemaIndex, 1);
+
+	/* An insertion sort, there are never more than a few attributes */
+	for (i = 0; i < G_N_ELEMENTS (schema->attributes); i++) {
+		if (schema->attributes[i].name == NULL)
+			break;
+		position = i;
+		for (j = i; j > 0; j--) {
+			if (strcmp (schema->attributes[index->sorted[j - 1]].name,
+			            schema->attributes[position].name) <= 0)
+				break;
+			index->sorted[j] = index->sorted[j - 1];
+		}
+		index->sorted[j] = position;
+	}
+
+	index->n_attributes = i;
+	return index;
+}
+
+static const SchemaIndex *
+schema_get_index (const SecretSchema *schema)
+{
+	SchemaIndex *index;
+	gpointer *location;
+
+	if (schema == &network_schema)
+		return &network_index;
+	if (schema == &generic_schema || schema == &note_schema)
+		return &single_index;
+
+	/* Not allocated by us, so we can't store anything in it */
+	if (g_atomic_int_get (&schema->reserved) <= 0)
+		return NULL;
+
+	location = (gpointer *)&schema->reserved1;
+	index = g_atomic_pointer_get (location);
+	if (index == NULL) {
+		index = schema_index_build (schema);
+		if (!g_atomic_pointer_compare_and_exchange (location, NULL, index)) {
+			g_free (index);
+			index = g_atomic_pointer_get (location);
+		}
+	}
+
+	return index;
+}
+
+/*
+ * Find an attribute in the schema by its name. Schemas allocated by
+ * secret_schema_new() and the predefined schemas use a binary search over
+ * an index of the attribute names, others are searched linearly.
+ */
+const SecretSchemaAttribute *
+_secret_schema_find_attribute (const SecretSchema *schema,
+                               const gchar *name)
+{
+	const SchemaIndex *index;
+	const SecretSchemaAttribute *attribute;
+	gint low, high, middle;
+	gint cmp;
+	gint i;
+
+	index = schema_get_index (schema);
+
+	if (index == NULL) {
+		for (i = 0; i < G_N_ELEMENTS (schema->attributes); i++) {
+			if (schema->attributes[i].name == NULL)
+				break;
+			if (g_str_equal (schema->attributes[i].name, name))
+				return &schema->attributes[i];
+		}
+		return NULL;
+	}
+
+	low = 0;
+	high = index->n_attributes - 1;
+	while (low <= high) {
+		middle = (low + high) / 2;
+		attribute = &schema->attributes[index->sorted[middle]];
+		cmp = strcmp (attribute->name, name);
+		if (cmp == 0)
+			return attribute;
+		else if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+
+	return NULL;
+}
+
 static SecretSchemaAttribute *
 schema_attribute_copy (SecretSchemaAttribute *attribute)
 {
@@ -295,6 +414,7 @@ secret_schema_unref (SecretSchema *schema)
 		g_free ((gpointer)schema->identifier);
 		for (i = 0; i < G_N_ELEMENTS (schema->attributes); i++)
 			g_free ((gpointer)schema->attributes[i].name);
+		g_free (schema->reserved1);
 		g_slice_free (SecretSchema, schema);
 	}
 }
@@ -24,6 +24,8 @@
 
 #include "egg/egg-secure-memory.h"
 
+#include <glib/gi18n-lib.h>
+
 /**
  * SECTION:secret-service
  * @title: SecretService
@@ -114,12 +116,59 @@ typedef struct _SecretServicePrivate {
 	/* Locked by mutex */
 	GMutex mutex;
 	gpointer session;
+	gpointer session_open;
+	gint64 session_opened;
+	guint session_rotation;
+	gchar *name_owner;
+	SecretExtensionState x25519;
+	guint name_owner_sig;
+	SecretService **name_owner_weak;
 	GHashTable *collections;
+	GHashTable *collections_creating;
+	GHashTable *collection_deltas;
+	guint collections_loading;
+
+	/* Lookup cache, locked by mutex */
+	GHashTable *lookup_cache;
+	guint lookup_cache_max;
+	guint lookup_cache_ttl;
+	gboolean lookup_cache_secrets;
+	guint lookup_cache_generation;
+	guint lookup_cache_hits;
+	guint lookup_cache_misses;
+	guint lookup_cache_subscription;
+
+	/* Lookups in progress, locked by mutex */
+	GHashTable *lookups_in_flight;
+	SecretExtensionState search_secrets;
 } SecretServicePrivate;
 
+typedef struct {
+	gchar *item_path;
+	SecretValue *value;
+	gint64 stored;
+} LookupCacheEntry;
+
 G_LOCK_DEFINE (service_instance);
+
+/* Guards the weak pointers that the name owner signal holds */
+G_LOCK_DEFINE_STATIC (service_weak);
 static gpointer service_instance = NULL;
 
+/* Construction of the shared instance, locked by service_instance */
+static gboolean service_loading = FALSE;
+static GList *service_waiters = NULL;
+
+/* When created by secret_service_get(), the thread and context it runs in */
+static GThread *service_loading_thread = NULL;
+static GMainContext *service_loading_context = NULL;
+
+/* Keep alive for the shared instance, locked by service_instance */
+static guint service_keep_alive = 0;
+static gpointer service_kept = NULL;
+static gint64 service_kept_until = 0;
+static guint service_kept_timeout = 0;
+
 static GInitableIface *secret_service_initable_parent_iface = NULL;
 
 static GAsyncInitableIface *secret_service_async_initable_parent_iface = NULL;
@@ -133,6 +182,13 @@ G_DEFINE_TYPE_WITH_CODE (SecretService, secret_service, G_TYPE_DBUS_PROXY,
                          G_IMPLEMENT_INTERFACE (G_TYPE_ASYNC_INITABLE, secret_service_async_initable_iface);
 );
 
+static void
+collection_delta_free (gpointer data)
+{
+	if (data != NULL)
+		g_object_unref (data);
+}
+
 static void
 secret_service_init (SecretService *self)
 {
@@ -141,6 +197,10 @@ secret_service_init (SecretService *self)
 
 	g_mutex_init (&self->pv->mutex);
 	self->pv->cancellable = g_cancellable_new ();
+	self->pv->collections_creating = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                                        g_free, NULL);
+	self->pv->collection_deltas = g_hash_table_new_full (g_str_hash, g_str_equal,
+	                                                     g_free, collection_delta_free);
 }
 
 static void
@@ -189,6 +249,24 @@ secret_service_dispose (GObject *obj)
 
 	g_cancellable_cancel (self->pv->cancellable);
 
+	G_LOCK (service_weak);
+	if (self->pv->name_owner_weak)
+		*(self->pv->name_owner_weak) = NULL;
+	self->pv->name_owner_weak = NULL;
+	G_UNLOCK (service_weak);
+
+	if (self->pv->name_owner_sig) {
+		g_dbus_connection_signal_unsubscribe (g_dbus_proxy_get_connection (G_DBUS_PROXY (self)),
+		                                      self->pv->name_owner_sig);
+		self->pv->name_owner_sig = 0;
+	}
+
+	if (self->pv->lookup_cache_subscription) {
+		g_dbus_connection_signal_unsubscribe (g_dbus_proxy_get_connection (G_DBUS_PROXY (self)),
+		                                      self->pv->lookup_cache_subscription);
+		self->pv->lookup_cache_subscription = 0;
+	}
+
 	G_OBJECT_CLASS (secret_service_parent_class)->dispose (obj);
 }
 
@@ -197,9 +275,16 @@ secret_service_finalize (GObject *obj)
 {
 	SecretService *self = SECRET_SERVICE (obj);
 
-	_secret_session_free (self->pv->session);
+	_secret_session_unref (self->pv->session);
+	g_free (self->pv->name_owner);
 	if (self->pv->collections)
 		g_hash_table_destroy (self->pv->collections);
+	g_hash_table_destroy (self->pv->collections_creating);
+	g_hash_table_destroy (self->pv->collection_deltas);
+	if (self->pv->lookup_cache)
+		g_hash_table_destroy (self->pv->lookup_cache);
+	if (self->pv->lookups_in_flight)
+		g_hash_table_destroy (self->pv->lookups_in_flight);
 	g_clear_object (&self->pv->cancellable);
 
 	G_OBJECT_CLASS (secret_service_parent_class)->finalize (obj);
@@ -264,6 +349,27 @@ secret_service_real_prompt_finish (SecretService *self,
 	return g_simple_async_result_get_op_res_gboolean (res);
 }
 
+/* Whether the Collections property agrees with what we track from signals */
+static gboolean
+service_collections_match (SecretService *self,
+                           GVariant *paths)
+{
+	GVariantIter iter;
+	const gchar *path;
+	gboolean match = TRUE;
+	guint count = 0;
+
+	g_variant_iter_init (&iter, paths);
+	while (match && g_variant_iter_next (&iter, "&o", &path)) {
+		if (g_hash_table_lookup (self->pv->collections, path))
+			count++;
+		else if (!g_hash_table_lookup (self->pv->collections_creating, path))
+			match = FALSE;
+	}
+
+	return match && count == g_hash_table_size (self->pv->collections);
+}
+
 static void
 handle_property_changed (SecretService *self,
                          const gchar *property_name,
@@ -273,8 +379,10 @@ handle_property_changed (SecretService *self,
 
 	if (g_str_equal (property_name, "Collections")) {
 
+		/* Only reload when the collection signals haven't already told us the same */
 		g_mutex_lock (&self->pv->mutex);
-		perform = self->pv->collections != NULL;
+		perform = self->pv->collections != NULL &&
+		          !service_collections_match (self, value);
 		g_mutex_unlock (&self->pv->mutex);
 
 		if (perform)
@@ -292,6 +400,8 @@ secret_service_properties_changed (GDBusProxy *proxy,
 	GVariantIter iter;
 	GVariant *value;
 
+	_secret_service_cache_invalidate (self);
+
 	g_object_freeze_notify (G_OBJECT (self));
 
 	g_variant_iter_init (&iter, changed_properties);
@@ -301,6 +411,38 @@ secret_service_properties_changed (GDBusProxy *proxy,
 	g_object_thaw_notify (G_OBJECT (self));
 }
 
+static void   service_collection_created   (SecretService *self,
+                                            const gchar *collection_path);
+
+static void   service_collection_deleted   (SecretService *self,
+                                            const gchar *collection_path);
+
+static void
+secret_service_signal (GDBusProxy *proxy,
+                       const gchar *sender_name,
+                       const gchar *signal_name,
+                       GVariant *parameters)
+{
+	SecretService *self = SECRET_SERVICE (proxy);
+	const gchar *collection_path;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(o)")))
+		return;
+
+	/*
+	 * Apply the change to our table of collections, rather than loading
+	 * the whole Collections property again.
+	 */
+	g_variant_get (parameters, "(&o)", &collection_path);
+
+	if (g_str_equal (signal_name, "CollectionCreated") ||
+	    g_str_equal (signal_name, "CollectionChanged"))
+		service_collection_created (self, collection_path);
+
+	else if (g_str_equal (signal_name, "CollectionDeleted"))
+		service_collection_deleted (self, collection_path);
+}
+
 static void
 secret_service_class_init (SecretServiceClass *klass)
 {
@@ -313,6 +455,7 @@ secret_service_class_init (SecretServiceClass *klass)
 	object_class->finalize = secret_service_finalize;
 
 	proxy_class->g_properties_changed = secret_service_properties_changed;
+	proxy_class->g_signal = secret_service_signal;
 
 	klass->prompt_sync = secret_service_real_prompt_sync;
 	klass->prompt_async = secret_service_real_prompt_async;
@@ -443,6 +586,109 @@ service_ensure_for_flags_async (SecretService *self,
 		g_simple_async_result_complete_in_idle (res);
 }
 
+static void
+service_name_appeared (SecretService *self,
+                       const gchar *name_owner)
+{
+	gboolean restarted;
+
+	g_mutex_lock (&self->pv->mutex);
+	restarted = self->pv->name_owner != NULL &&
+	            !g_str_equal (self->pv->name_owner, name_owner);
+	g_free (self->pv->name_owner);
+	self->pv->name_owner = g_strdup (name_owner);
+	if (restarted)
+		self->pv->x25519 = SECRET_EXTENSION_UNKNOWN;
+	g_mutex_unlock (&self->pv->mutex);
+
+	/* The service was replaced, and our session went with it */
+	if (restarted)
+		_secret_service_reset_session (self, NULL);
+}
+
+static void
+service_name_vanished (SecretService *self)
+{
+	gboolean owned;
+
+	g_mutex_lock (&self->pv->mutex);
+	owned = self->pv->name_owner != NULL;
+	g_free (self->pv->name_owner);
+	self->pv->name_owner = NULL;
+	self->pv->x25519 = SECRET_EXTENSION_UNKNOWN;
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (owned)
+		_secret_service_reset_session (self, NULL);
+}
+
+static void
+on_service_name_owner_changed (GDBusConnection *connection,
+                               const gchar *sender_name,
+                               const gchar *object_path,
+                               const gchar *interface_name,
+                               const gchar *signal_name,
+                               GVariant *parameters,
+                               gpointer user_data)
+{
+	SecretService **weak = user_data;
+	SecretService *self = NULL;
+	const gchar *name;
+	const gchar *old_owner;
+	const gchar *new_owner;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sss)")))
+		return;
+
+	/* May be running in another thread while the service is disposed */
+	G_LOCK (service_weak);
+	if (*weak != NULL)
+		self = g_object_ref (*weak);
+	G_UNLOCK (service_weak);
+
+	if (self == NULL)
+		return;
+
+	g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+	if (new_owner[0] != '\0')
+		service_name_appeared (self, new_owner);
+	else
+		service_name_vanished (self);
+
+	g_object_unref (self);
+}
+
+/* Called once the proxy is built, in the context it was created in */
+static void
+service_watch_name (SecretService *self)
+{
+	GDBusProxy *proxy = G_DBUS_PROXY (self);
+	SecretService **weak;
+
+	/* A signal that's already queued may be delivered after dispose */
+	weak = g_new (SecretService *, 1);
+	*weak = self;
+	self->pv->name_owner_weak = weak;
+
+	self->pv->name_owner_sig =
+		g_dbus_connection_signal_subscribe (g_dbus_proxy_get_connection (proxy),
+		                                    "org.freedesktop.DBus",
+		                                    "org.freedesktop.DBus",
+		                                    "NameOwnerChanged",
+		                                    "/org/freedesktop/DBus",
+		                                    g_dbus_proxy_get_name (proxy),
+		                                    G_DBUS_SIGNAL_FLAGS_NONE,
+		                                    on_service_name_owner_changed,
+		                                    weak, g_free);
+	_secret_sync_retain_context ();
+
+	/* After subscribing, so that a restart from now on is noticed */
+	g_mutex_lock (&self->pv->mutex);
+	g_free (self->pv->name_owner);
+	self->pv->name_owner = g_dbus_proxy_get_name_owner (proxy);
+	g_mutex_unlock (&self->pv->mutex);
+}
+
 static gboolean
 secret_service_initable_init (GInitable *initable,
                               GCancellable *cancellable,
@@ -450,10 +696,15 @@ secret_service_initable_init (GInitable *initable,
 {
 	SecretService *self;
 
+	/* Signals for the proxy are delivered in the current context */
+	_secret_sync_retain_context ();
+
 	if (!secret_service_initable_parent_iface->init (initable, cancellable, error))
 		return FALSE;
 
 	self = SECRET_SERVICE (initable);
+	service_watch_name (self);
+
 	return service_ensure_for_flags_sync (self, self->pv->init_flags, cancellable, error);
 }
 
@@ -479,10 +730,10 @@ on_init_base (GObject *source,
 		g_simple_async_result_take_error (res, error);
 		g_simple_async_result_complete (res);
 	} else {
-
+		service_watch_name (self);
+		service_ensure_for_flags_async (self, self->pv->init_flags, res);
 	}
 
-	service_ensure_for_flags_async (self, self->pv->init_flags, res);
 	g_object_unref (res);
 }
 
@@ -502,6 +753,8 @@ secret_service_async_initable_init_async (GAsyncInitable *initable,
 	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
 	g_simple_async_result_set_op_res_gpointer (res, closure, init_closure_free);
 
+	_secret_sync_retain_context ();
+
 	secret_service_async_initable_parent_iface->init_async (initable, io_priority,
 	                                                        cancellable,
 	                                                        on_init_base,
@@ -552,6 +805,259 @@ on_service_instance_gone (gpointer user_data,
 	G_UNLOCK (service_instance);
 }
 
+static gboolean
+on_service_keep_alive_timeout (gpointer user_data)
+{
+	gpointer release = NULL;
+	gboolean ret = TRUE;
+
+	G_LOCK (service_instance);
+
+	if (service_kept == NULL || g_get_monotonic_time () >= service_kept_until) {
+		release = service_kept;
+		service_kept = NULL;
+		service_kept_timeout = 0;
+		ret = FALSE;
+	}
+
+	G_UNLOCK (service_instance);
+
+	/* Outside the lock, since this may be the last reference */
+	if (release)
+		g_object_unref (release);
+
+	return ret;
+}
+
+static void
+service_keep_alive_touch (SecretService *service)
+{
+	gpointer release = NULL;
+
+	G_LOCK (service_instance);
+
+	if (service_keep_alive > 0 && service == service_instance) {
+		if (service_kept != service) {
+			release = service_kept;
+			service_kept = g_object_ref (service);
+		}
+
+		service_kept_until = g_get_monotonic_time () +
+		                     (gint64)service_keep_alive * G_USEC_PER_SEC;
+
+		if (service_kept_timeout == 0)
+			service_kept_timeout = g_timeout_add_seconds (service_keep_alive,
+			                                              on_service_keep_alive_timeout,
+			                                              NULL);
+	}
+
+	G_UNLOCK (service_instance);
+
+	if (release)
+		g_object_unref (release);
+}
+
+/**
+ * secret_service_set_keep_alive:
+ * @idle_seconds: number of seconds to keep the shared proxy after last use,
+ *                or zero to disable
+ *
+ * Keep the shared #SecretService proxy returned by secret_service_get()
+ * alive for @idle_seconds after it was last requested, even when no one
+ * holds a reference to it.
+ *
+ * By default the shared proxy goes away as soon as the last reference to it
+ * is released. Functions such as secret_password_lookup_sync() release it
+ * when they complete, so each call connects to the Secret Service, loads its
+ * properties and negotiates a new session from scratch. With a keep alive,
+ * repeated calls reuse the proxy and its session.
+ *
+ * The proxy is released from the global default main context once it has
+ * been idle for @idle_seconds. If that main context is not running, the
+ * proxy is kept until it is next used, or until this function is called
+ * with zero.
+ */
+void
+secret_service_set_keep_alive (guint idle_seconds)
+{
+	gpointer release = NULL;
+	guint timeout = 0;
+
+	G_LOCK (service_instance);
+
+	service_keep_alive = idle_seconds;
+	if (idle_seconds == 0) {
+		release = service_kept;
+		service_kept = NULL;
+		timeout = service_kept_timeout;
+		service_kept_timeout = 0;
+	}
+
+	G_UNLOCK (service_instance);
+
+	if (timeout)
+		g_source_remove (timeout);
+	if (release)
+		g_object_unref (release);
+}
+
+typedef struct {
+	GCancellable *cancellable;
+	SecretServiceFlags flags;
+	GAsyncReadyCallback callback;
+	gpointer user_data;
+	SecretService *service;
+} WaitClosure;
+
+static void
+wait_closure_free (gpointer data)
+{
+	WaitClosure *closure = data;
+	g_clear_object (&closure->cancellable);
+	g_clear_object (&closure->service);
+	g_slice_free (WaitClosure, closure);
+}
+
+static void
+service_get_existing (SecretService *service,
+                      SecretServiceFlags flags,
+                      GCancellable *cancellable,
+                      GAsyncReadyCallback callback,
+                      gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	InitClosure *closure;
+
+	res = g_simple_async_result_new (G_OBJECT (service), callback,
+	                                 user_data, secret_service_get);
+	closure = g_slice_new0 (InitClosure);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	closure->flags = flags;
+	g_simple_async_result_set_op_res_gpointer (res, closure, init_closure_free);
+
+	service_ensure_for_flags_async (service, flags, res);
+
+	service_keep_alive_touch (service);
+	g_object_unref (res);
+}
+
+static void
+on_service_instance_waited (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (result);
+	WaitClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+	GSimpleAsyncResult *failed;
+	GError *error = NULL;
+
+	/* Back in the caller's main context, now ensure the flags */
+	if (!g_simple_async_result_propagate_error (res, &error)) {
+		service_get_existing (closure->service, closure->flags, closure->cancellable,
+		                      closure->callback, closure->user_data);
+
+	} else {
+		failed = g_simple_async_result_new (NULL, closure->callback,
+		                                    closure->user_data, secret_service_get);
+		g_simple_async_result_take_error (failed, error);
+		g_simple_async_result_complete (failed);
+		g_object_unref (failed);
+	}
+}
+
+static void
+service_instance_loaded (SecretService *service,
+                         const GError *error)
+{
+	GMainContext *context;
+	GSimpleAsyncResult *res;
+	WaitClosure *closure;
+	GList *waiters, *l;
+
+	G_LOCK (service_instance);
+
+	if (service != NULL && service_instance == NULL) {
+		service_instance = service;
+		g_object_weak_ref (G_OBJECT (service), on_service_instance_gone, NULL);
+	}
+
+	waiters = service_waiters;
+	service_waiters = NULL;
+	service_loading = FALSE;
+	service_loading_thread = NULL;
+	context = service_loading_context;
+	service_loading_context = NULL;
+
+	G_UNLOCK (service_instance);
+
+	if (context)
+		g_main_context_unref (context);
+
+	/* Each waiter completes in its own main context, unless cancelled */
+	for (l = waiters; l != NULL; l = g_list_next (l)) {
+		res = _secret_waiter_claim (l->data);
+		if (res == NULL)
+			continue;
+		closure = g_simple_async_result_get_op_res_gpointer (res);
+		if (service != NULL)
+			closure->service = g_object_ref (service);
+		else
+			g_simple_async_result_set_from_error (res, error);
+		g_simple_async_result_complete_in_idle (res);
+	}
+
+	g_list_free_full (waiters, _secret_waiter_free);
+}
+
+static void
+on_service_instance_loaded (GObject *source,
+                            GAsyncResult *result,
+                            gpointer user_data)
+{
+	GError *error = NULL;
+	GObject *service;
+
+	service = g_async_initable_new_finish (G_ASYNC_INITABLE (source), result, &error);
+	service_instance_loaded (service ? SECRET_SERVICE (service) : NULL, error);
+
+	g_clear_error (&error);
+	if (service)
+		g_object_unref (service);
+}
+
+/*
+ * Queue up to get the shared instance once it's been created. Returns
+ * TRUE if the caller should create it, and FALSE if someone else is
+ * already doing so. Called with the service_instance lock held.
+ */
+static gboolean
+service_instance_wait (SecretServiceFlags flags,
+                       GCancellable *cancellable,
+                       GAsyncReadyCallback callback,
+                       gpointer user_data)
+{
+	GSimpleAsyncResult *res;
+	WaitClosure *closure;
+	gboolean create;
+
+	res = g_simple_async_result_new (NULL, on_service_instance_waited, NULL,
+	                                 service_instance_wait);
+	closure = g_slice_new0 (WaitClosure);
+	closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+	closure->flags = flags;
+	closure->callback = callback;
+	closure->user_data = user_data;
+	g_simple_async_result_set_op_res_gpointer (res, closure, wait_closure_free);
+
+	/* The shared service keeps loading if this waiter is cancelled */
+	service_waiters = g_list_prepend (service_waiters, _secret_waiter_new (res, cancellable));
+	g_object_unref (res);
+
+	create = !service_loading;
+	service_loading = TRUE;
+	return create;
+}
+
 /**
  * secret_service_get:
  * @flags: flags for which service functionality to ensure is initialized
@@ -560,7 +1066,9 @@ on_service_instance_gone (gpointer user_data,
  * @user_data: data to be passed to the callback
  *
  * Get a #SecretService proxy for the Secret Service. If such a proxy object
- * already exists, then the same proxy is returned.
+ * already exists, then the same proxy is returned. If the proxy is already
+ * being created, for example in another thread, then this operation completes
+ * with that proxy once it has been created.
  *
  * If @flags contains any flags of which parts of the secret service to
  * ensure are initialized, then those will be initialized before completing.
@@ -574,40 +1082,43 @@ secret_service_get (SecretServiceFlags flags,
                     gpointer user_data)
 {
 	SecretService *service = NULL;
-	GSimpleAsyncResult *res;
-	InitClosure *closure;
+	gboolean create = FALSE;
 
 	G_LOCK (service_instance);
-	if (service_instance != NULL)
+	if (service_instance != NULL) {
 		service = g_object_ref (service_instance);
+	} else {
+		create = service_instance_wait (flags, cancellable, callback, user_data);
+		if (create) {
+			service_loading_thread = g_thread_self ();
+			service_loading_context = g_main_context_get_thread_default ();
+			if (service_loading_context == NULL)
+				service_loading_context = g_main_context_default ();
+			g_main_context_ref (service_loading_context);
+		}
+	}
 	G_UNLOCK (service_instance);
 
-	/* Create a whole new service */
-	if (service == NULL) {
+	/*
+	 * Create a whole new service. Others may be waiting for it, so don't
+	 * cancel it on behalf of this caller. The flags are ensured per waiter.
+	 */
+	if (create) {
 		g_async_initable_new_async (SECRET_TYPE_SERVICE, G_PRIORITY_DEFAULT,
-		                            cancellable, callback, user_data,
+		                            NULL, on_service_instance_loaded, NULL,
 		                            "g-flags", G_DBUS_PROXY_FLAGS_NONE,
 		                            "g-interface-info", _secret_gen_service_interface_info (),
 		                            "g-name", default_bus_name,
 		                            "g-bus-type", G_BUS_TYPE_SESSION,
 		                            "g-object-path", SECRET_SERVICE_PATH,
 		                            "g-interface-name", SECRET_SERVICE_INTERFACE,
-		                            "flags", flags,
+		                            "flags", SECRET_SERVICE_NONE,
 		                            NULL);
 
 	/* Just have to ensure that the service matches flags */
-	} else {
-		res = g_simple_async_result_new (G_OBJECT (service), callback,
-		                                 user_data, secret_service_get);
-		closure = g_slice_new0 (InitClosure);
-		closure->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
-		closure->flags = flags;
-		g_simple_async_result_set_op_res_gpointer (res, closure, init_closure_free);
-
-		service_ensure_for_flags_async (service, flags, res);
-
+	} else if (service != NULL) {
+		service_get_existing (service, flags, cancellable, callback, user_data);
 		g_object_unref (service);
-		g_object_unref (res);
 	}
 }
 
@@ -634,24 +1145,11 @@ secret_service_get_finish (GAsyncResult *result,
 
 	source_object = g_async_result_get_source_object (result);
 
-	/* Just ensuring that the service matches flags */
-	if (g_simple_async_result_is_valid (result, source_object, secret_service_get)) {
-		if (!g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), error))
-			service = g_object_ref (source_object);
+	g_return_val_if_fail (g_simple_async_result_is_valid (result, source_object,
+	                      secret_service_get), NULL);
 
-	/* Creating a whole new service */
-	} else {
-		service = g_async_initable_new_finish (G_ASYNC_INITABLE (source_object), result, error);
-
-		if (service) {
-			G_LOCK (service_instance);
-			if (service_instance == NULL) {
-				service_instance = service;
-				g_object_weak_ref (G_OBJECT (service), on_service_instance_gone, NULL);
-			}
-			G_UNLOCK (service_instance);
-		}
-	}
+	if (!g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), error))
+		service = g_object_ref (source_object);
 
 	if (source_object)
 		g_object_unref (source_object);
@@ -669,7 +1167,9 @@ secret_service_get_finish (GAsyncResult *result,
  * @error: location to place an error on failure
  *
  * Get a #SecretService proxy for the Secret Service. If such a proxy object
- * already exists, then the same proxy is returned.
+ * already exists, then the same proxy is returned. If the proxy is already
+ * being created, for example in another thread, then this waits for that
+ * proxy to be created.
  *
  * If @flags contains any flags of which parts of the secret service to
  * ensure are initialized, then those will be initialized before returning.
@@ -686,39 +1186,88 @@ secret_service_get_sync (SecretServiceFlags flags,
                          GError **error)
 {
 	SecretService *service = NULL;
+	gboolean create = FALSE;
+	GError *init_error = NULL;
+	GMainContext *context;
+	SecretSync *sync;
 
 	G_LOCK (service_instance);
-	if (service_instance != NULL)
+
+	/*
+	 * This thread started creating the service with secret_service_get(),
+	 * in a main context that it isn't running while it's blocked in here.
+	 * So run that context until the service is created, unless some other
+	 * thread is running it.
+	 */
+	while (service_instance == NULL && service_loading &&
+	       service_loading_thread == g_thread_self ()) {
+		context = g_main_context_ref (service_loading_context);
+		G_UNLOCK (service_instance);
+
+		if (!g_main_context_acquire (context)) {
+			g_main_context_unref (context);
+			G_LOCK (service_instance);
+			break;
+		}
+
+		g_main_context_iteration (context, TRUE);
+		g_main_context_release (context);
+		g_main_context_unref (context);
+
+		G_LOCK (service_instance);
+	}
+
+	if (service_instance != NULL) {
 		service = g_object_ref (service_instance);
+	} else if (!service_loading) {
+		service_loading = TRUE;
+		create = TRUE;
+	}
 	G_UNLOCK (service_instance);
 
-	if (service == NULL) {
-		service = g_initable_new (SECRET_TYPE_SERVICE, cancellable, error,
+	/* Someone else is creating the service, wait for them */
+	if (service == NULL && !create) {
+		sync = _secret_sync_new ();
+		g_main_context_push_thread_default (sync->context);
+
+		secret_service_get (flags, cancellable, _secret_sync_on_result, sync);
+
+		g_main_loop_run (sync->loop);
+
+		service = secret_service_get_finish (sync->result, error);
+
+		g_main_context_pop_thread_default (sync->context);
+		_secret_sync_free (sync);
+
+		return service;
+	}
+
+	/* Create in the caller's main context, so it gets signals there */
+	if (create) {
+		service = g_initable_new (SECRET_TYPE_SERVICE, NULL, &init_error,
 		                          "g-flags", G_DBUS_PROXY_FLAGS_NONE,
 		                          "g-interface-info", _secret_gen_service_interface_info (),
 		                          "g-name", default_bus_name,
 		                          "g-bus-type", G_BUS_TYPE_SESSION,
 		                          "g-object-path", SECRET_SERVICE_PATH,
 		                          "g-interface-name", SECRET_SERVICE_INTERFACE,
-		                          "flags", flags,
+		                          "flags", SECRET_SERVICE_NONE,
 		                          NULL);
 
-		if (service != NULL) {
-			G_LOCK (service_instance);
-			if (service_instance == NULL) {
-				service_instance = service;
-				g_object_weak_ref (G_OBJECT (service), on_service_instance_gone, NULL);
-			}
-			G_UNLOCK (service_instance);
-		}
+		service_instance_loaded (service, init_error);
 
-	} else {
-		if (!service_ensure_for_flags_sync (service, flags, cancellable, error)) {
-			g_object_unref (service);
+		if (service == NULL) {
+			g_propagate_error (error, init_error);
 			return NULL;
 		}
 	}
 
+	if (!service_ensure_for_flags_sync (service, flags, cancellable, error)) {
+		g_object_unref (service);
+		return NULL;
+	}
+
+	service_keep_alive_touch (service);
 	return service;
 }
 
@@ -938,32 +1487,528 @@ _secret_service_find_item_instance (SecretService *self,
 	return item;
 }
 
-SecretSession *
-_secret_service_get_session (SecretService *self)
+void
+_secret_service_take_session (SecretService *self,
+                              SecretSession *session)
 {
-	SecretSession *session;
-
-	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+	g_return_if_fail (session != NULL);
 
 	g_mutex_lock (&self->pv->mutex);
-	session = self->pv->session;
+	if (self->pv->session == NULL) {
+		self->pv->session = session;
+		self->pv->session_opened = g_get_monotonic_time ();
+	} else {
+		_secret_session_unref (session);
+	}
 	g_mutex_unlock (&self->pv->mutex);
+}
+
+static gboolean
+service_retire_session_unlocked (SecretService *self)
+{
+	if (self->pv->session == NULL)
+		return FALSE;
 
-	return session;
+	/* Transfers still using the session hold their own reference */
+	_secret_session_retire (self->pv->session);
+	self->pv->session = NULL;
+	return TRUE;
 }
 
+/*
+ * Drop the current session, so that the next transfer opens a new one.
+ * When @session is set, only drop the current session if it is that one,
+ * so that concurrent failures don't throw away a fresh session.
+ */
 void
-_secret_service_take_session (SecretService *self,
-                              SecretSession *session)
+_secret_service_reset_session (SecretService *self,
+                               SecretSession *session)
 {
+	gboolean reset = FALSE;
+
 	g_return_if_fail (SECRET_IS_SERVICE (self));
-	g_return_if_fail (session != NULL);
 
 	g_mutex_lock (&self->pv->mutex);
-	if (self->pv->session == NULL)
-		self->pv->session = session;
-	else
-		_secret_session_free (session);
+	if (session == NULL || session == self->pv->session)
+		reset = service_retire_session_unlocked (self);
+	g_mutex_unlock (&self->pv->mutex);
+
+	/* Cached lookups may refer to the old service */
+	if (reset)
+		_secret_service_cache_invalidate (self);
+}
+
+/**
+ * secret_service_set_session_rotation:
+ * @self: the secret service
+ * @seconds: how long a session is used before a new one is opened, or
+ *           zero to keep using a session for the life of the proxy
+ *
+ * Periodically replace the session used to transfer secrets, and so the
+ * keys used to encrypt them. Once a session is older than @seconds, the
+ * next transfer of a secret opens a new session first.
+ *
+ * Sessions are replaced automatically whenever the Secret Service restarts,
+ * regardless of this setting. Restarts are noticed while the default main
+ * context is running, and otherwise when a transfer next fails because the
+ * service no longer knows the session.
+ */
+void
+secret_service_set_session_rotation (SecretService *self,
+                                     guint seconds)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+
+	g_mutex_lock (&self->pv->mutex);
+	self->pv->session_rotation = seconds;
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+static void
+lookup_cache_entry_free (gpointer data)
+{
+	LookupCacheEntry *entry = data;
+	g_free (entry->item_path);
+	if (entry->value)
+		secret_value_unref (entry->value);
+	g_slice_free (LookupCacheEntry, entry);
+}
+
+static gboolean
+lookup_cache_entry_expired (SecretService *self,
+                            LookupCacheEntry *entry,
+                            gint64 now)
+{
+	if (self->pv->lookup_cache_ttl == 0)
+		return FALSE;
+	return now - entry->stored >= (gint64)self->pv->lookup_cache_ttl * G_USEC_PER_SEC;
+}
+
+static void
+lookup_cache_evict (SecretService *self,
+                    gint64 now)
+{
+	GHashTableIter iter;
+	LookupCacheEntry *entry;
+	LookupCacheEntry *oldest = NULL;
+	gpointer key, oldest_key = NULL;
+
+	g_hash_table_iter_init (&iter, self->pv->lookup_cache);
+	while (g_hash_table_iter_next (&iter, &key, (gpointer *)&entry)) {
+		if (lookup_cache_entry_expired (self, entry, now)) {
+			g_hash_table_iter_remove (&iter);
+		} else if (oldest == NULL || entry->stored < oldest->stored) {
+			oldest = entry;
+			oldest_key = key;
+		}
+	}
+
+	if (oldest_key != NULL &&
+	    g_hash_table_size (self->pv->lookup_cache) >= self->pv->lookup_cache_max)
+		g_hash_table_remove (self->pv->lookup_cache, oldest_key);
+}
+
+gchar *
+_secret_service_cache_key (SecretService *self,
+                           const SecretSchema *schema,
+                           GHashTable *attributes)
+{
+	gboolean enabled;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+
+	g_mutex_lock (&self->pv->mutex);
+	enabled = self->pv->lookup_cache != NULL;
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (!enabled)
+		return NULL;
+
+	return _secret_util_attributes_canonical_key (schema->name, attributes);
+}
+
+gboolean
+_secret_service_cache_lookup (SecretService *self,
+                              const gchar *key,
+                              gchar **item_path,
+                              SecretValue **value,
+                              guint *generation)
+{
+	LookupCacheEntry *entry = NULL;
+	gboolean ret = FALSE;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+
+	g_mutex_lock (&self->pv->mutex);
+
+	if (generation)
+		*generation = self->pv->lookup_cache_generation;
+
+	if (self->pv->lookup_cache) {
+		entry = g_hash_table_lookup (self->pv->lookup_cache, key);
+		if (entry && lookup_cache_entry_expired (self, entry, g_get_monotonic_time ())) {
+			g_hash_table_remove (self->pv->lookup_cache, key);
+			entry = NULL;
+		}
+
+		if (entry == NULL) {
+			self->pv->lookup_cache_misses++;
+		} else {
+			self->pv->lookup_cache_hits++;
+			if (item_path)
+				*item_path = g_strdup (entry->item_path);
+			if (value)
+				*value = entry->value ? secret_value_ref (entry->value) : NULL;
+			ret = TRUE;
+		}
+	}
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	return ret;
+}
+
+void
+_secret_service_cache_store (SecretService *self,
+                             const gchar *key,
+                             guint generation,
+                             const gchar *item_path,
+                             SecretValue *value)
+{
+	LookupCacheEntry *entry;
+	gint64 now;
+
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+	g_return_if_fail (key != NULL);
+	g_return_if_fail (item_path != NULL);
+
+	g_mutex_lock (&self->pv->mutex);
+
+	/* Something changed while this lookup was in flight */
+	if (self->pv->lookup_cache && generation == self->pv->lookup_cache_generation) {
+		now = g_get_monotonic_time ();
+		if (g_hash_table_size (self->pv->lookup_cache) >= self->pv->lookup_cache_max &&
+		    !g_hash_table_lookup (self->pv->lookup_cache, key))
+			lookup_cache_evict (self, now);
+
+		entry = g_slice_new0 (LookupCacheEntry);
+		entry->item_path = g_strdup (item_path);
+		if (value && self->pv->lookup_cache_secrets)
+			entry->value = secret_value_ref (value);
+		entry->stored = now;
+		g_hash_table_replace (self->pv->lookup_cache, g_strdup (key), entry);
+	}
+
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+guint
+_secret_service_cache_invalidate (SecretService *self)
+{
+	guint generation;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), 0);
+
+	g_mutex_lock (&self->pv->mutex);
+
+	generation = ++self->pv->lookup_cache_generation;
+	if (self->pv->lookup_cache)
+		g_hash_table_remove_all (self->pv->lookup_cache);
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	return generation;
+}
+
+/* Whether the service supports the SearchItemsWithSecrets extension */
+SecretExtensionState
+_secret_service_get_search_secrets (SecretService *self)
+{
+	SecretExtensionState state;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), SECRET_EXTENSION_MISSING);
+
+	g_mutex_lock (&self->pv->mutex);
+	state = self->pv->search_secrets;
+	g_mutex_unlock (&self->pv->mutex);
+
+	return state;
+}
+
+void
+_secret_service_set_search_secrets (SecretService *self,
+                                    gboolean supported)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+
+	g_mutex_lock (&self->pv->mutex);
+	self->pv->search_secrets = supported ? SECRET_EXTENSION_SUPPORTED : SECRET_EXTENSION_MISSING;
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+/*
+ * Whether the service supports X25519 sessions. Most don't, so once it has
+ * said so, later sessions go straight to the DH algorithm. Forgotten when
+ * the service is replaced.
+ */
+SecretExtensionState
+_secret_service_get_x25519 (SecretService *self)
+{
+	SecretExtensionState state;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), SECRET_EXTENSION_MISSING);
+
+	g_mutex_lock (&self->pv->mutex);
+	state = self->pv->x25519;
+	g_mutex_unlock (&self->pv->mutex);
+
+	return state;
+}
+
+void
+_secret_service_set_x25519 (SecretService *self,
+                            gboolean supported)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+
+	g_mutex_lock (&self->pv->mutex);
+	self->pv->x25519 = supported ? SECRET_EXTENSION_SUPPORTED : SECRET_EXTENSION_MISSING;
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+/*
+ * Returns TRUE if a lookup for @key is already in progress, in which case
+ * @join is queued to be completed when it is done, or right away when
+ * @cancellable is cancelled. Otherwise the caller becomes responsible for
+ * the lookup, and must call _secret_service_inflight_release() when done.
+ */
+gboolean
+_secret_service_inflight_join (SecretService *self,
+                               const gchar *key,
+                               GSimpleAsyncResult *join,
+                               GCancellable *cancellable)
+{
+	GPtrArray *joined;
+	gboolean ret;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+
+	g_mutex_lock (&self->pv->mutex);
+
+	if (self->pv->lookups_in_flight == NULL)
+		self->pv->lookups_in_flight = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+		                                                     (GDestroyNotify)g_ptr_array_unref);
+
+	joined = g_hash_table_lookup (self->pv->lookups_in_flight, key);
+	if (joined != NULL) {
+		g_ptr_array_add (joined, _secret_waiter_new (join, cancellable));
+		ret = TRUE;
+	} else {
+		joined = g_ptr_array_new_with_free_func (_secret_waiter_free);
+		g_hash_table_insert (self->pv->lookups_in_flight, g_strdup (key), joined);
+		ret = FALSE;
+	}
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	return ret;
+}
+
+/*
+ * When the lookup for @key was cancelled, pick one of the lookups that
+ * joined it to take over, and return its join result. The others stay
+ * queued behind it. Returns NULL if every lookup that joined was itself
+ * cancelled, in which case nothing is in progress for @key any more.
+ */
+GSimpleAsyncResult *
+_secret_service_inflight_promote (SecretService *self,
+                                  const gchar *key)
+{
+	GSimpleAsyncResult *join = NULL;
+	GPtrArray *joined = NULL;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+
+	g_mutex_lock (&self->pv->mutex);
+
+	if (self->pv->lookups_in_flight)
+		joined = g_hash_table_lookup (self->pv->lookups_in_flight, key);
+
+	while (joined != NULL && joined->len > 0 && join == NULL) {
+		join = _secret_waiter_claim (joined->pdata[0]);
+		if (join != NULL)
+			g_object_ref (join);
+		g_ptr_array_remove_index (joined, 0);
+	}
+
+	if (joined != NULL && join == NULL)
+		g_hash_table_remove (self->pv->lookups_in_flight, key);
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	return join;
+}
+
+/* Returns the lookups that joined the one for @key */
+GPtrArray *
+_secret_service_inflight_release (SecretService *self,
+                                  const gchar *key)
+{
+	GPtrArray *joined = NULL;
+
+	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+
+	g_mutex_lock (&self->pv->mutex);
+
+	if (self->pv->lookups_in_flight) {
+		joined = g_hash_table_lookup (self->pv->lookups_in_flight, key);
+		if (joined != NULL) {
+			g_ptr_array_ref (joined);
+			g_hash_table_remove (self->pv->lookups_in_flight, key);
+		}
+	}
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	return joined;
+}
+
+static void
+on_lookup_cache_signal (GDBusConnection *connection,
+                        const gchar *sender_name,
+                        const gchar *object_path,
+                        const gchar *interface_name,
+                        const gchar *signal_name,
+                        GVariant *parameters,
+                        gpointer user_data)
+{
+	SecretService *self = SECRET_SERVICE (user_data);
+
+	/* Item, collection and property changes all affect lookups */
+	if (!g_str_equal (interface_name, SECRET_PROMPT_INTERFACE))
+		_secret_service_cache_invalidate (self);
+}
+
+/**
+ * secret_service_set_lookup_cache:
+ * @self: the secret service
+ * @max_entries: maximum number of lookups to remember, or zero to disable
+ * @ttl_seconds: number of seconds a lookup is remembered, or zero for no limit
+ * @cache_secrets: whether to also remember the secret values
+ *
+ * Enable or disable caching of the results of secret_service_lookup() and
+ * friends on this #SecretService proxy.
+ *
+ * Lookups are remembered by schema name and attributes. When @cache_secrets
+ * is %FALSE only the matching item path is remembered, which saves the search
+ * on the next lookup, but the secret is still retrieved from the Secret
+ * Service. When %TRUE the secret value is kept in non-pageable memory and
+ * a repeated lookup completes without any DBus traffic.
+ *
+ * The cache is cleared when this library changes, locks or removes items,
+ * and when the Secret Service reports that items or collections have changed.
+ * Those notifications are delivered to the thread default main context at the
+ * time this function is called, so the @ttl_seconds limit is the only thing
+ * that bounds staleness if that main context is not running.
+ *
+ * Calling this function clears any results already cached.
+ */
+void
+secret_service_set_lookup_cache (SecretService *self,
+                                 guint max_entries,
+                                 guint ttl_seconds,
+                                 gboolean cache_secrets)
+{
+	GDBusConnection *connection;
+	GHashTable *previous;
+	guint subscription = 0;
+	guint unsubscribe = 0;
+
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+
+	connection = g_dbus_proxy_get_connection (G_DBUS_PROXY (self));
+	if (max_entries > 0) {
+		subscription = g_dbus_connection_signal_subscribe (connection,
+		                                                   g_dbus_proxy_get_name (G_DBUS_PROXY (self)),
+		                                                   NULL, NULL, NULL, NULL,
+		                                                   G_DBUS_SIGNAL_FLAGS_NONE,
+		                                                   on_lookup_cache_signal,
+		                                                   self, NULL);
+		_secret_sync_retain_context ();
+	}
+
+	g_mutex_lock (&self->pv->mutex);
+
+	previous = self->pv->lookup_cache;
+	self->pv->lookup_cache = NULL;
+	if (max_entries > 0)
+		self->pv->lookup_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+		                                                g_free, lookup_cache_entry_free);
+	self->pv->lookup_cache_max = max_entries;
+	self->pv->lookup_cache_ttl = ttl_seconds;
+	self->pv->lookup_cache_secrets = cache_secrets;
+	self->pv->lookup_cache_generation++;
+	self->pv->lookup_cache_hits = 0;
+	self->pv->lookup_cache_misses = 0;
+
+	unsubscribe = self->pv->lookup_cache_subscription;
+	self->pv->lookup_cache_subscription = subscription;
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (unsubscribe)
+		g_dbus_connection_signal_unsubscribe (connection, unsubscribe);
+	if (previous)
+		g_hash_table_destroy (previous);
+}
+
+/**
+ * secret_service_get_lookup_cache_stats:
+ * @self: the secret service
+ * @hits: (out) (allow-none): location to place number of lookups served from the cache
+ * @misses: (out) (allow-none): location to place number of lookups not in the cache
+ *
+ * Get the number of cache hits and misses since the lookup cache was enabled
+ * with secret_service_set_lookup_cache(), or since the counters were last reset
+ * by secret_service_clear_lookup_cache().
+ */
+void
+secret_service_get_lookup_cache_stats (SecretService *self,
+                                       guint *hits,
+                                       guint *misses)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+
+	g_mutex_lock (&self->pv->mutex);
+	if (hits)
+		*hits = self->pv->lookup_cache_hits;
+	if (misses)
+		*misses = self->pv->lookup_cache_misses;
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+/**
+ * secret_service_clear_lookup_cache:
+ * @self: the secret service
+ *
+ * Forget all the cached lookups, and reset the hit and miss counters.
+ * The cache stays enabled.
+ */
+void
+secret_service_clear_lookup_cache (SecretService *self)
+{
+	g_return_if_fail (SECRET_IS_SERVICE (self));
+
+	_secret_service_cache_invalidate (self);
+
+	g_mutex_lock (&self->pv->mutex);
+	self->pv->lookup_cache_hits = 0;
+	self->pv->lookup_cache_misses = 0;
 	g_mutex_unlock (&self->pv->mutex);
 }
 
@@ -1007,6 +2052,9 @@ secret_service_get_session_algorithms (SecretService *self)
  * This will be %NULL if no session has been established. Use
  * secret_service_ensure_session() to establish a session.
  *
+ * The returned path belongs to the session, and remains valid until the
+ * session is closed or replaced by a new one.
+ *
  * Returns: (allow-none): a string representing the dbus object path of the
  *          session
  */
@@ -1023,10 +2071,147 @@ secret_service_get_session_path (SecretService *self)
 	path = session ? _secret_session_get_path (session) : NULL;
 	g_mutex_unlock (&self->pv->mutex);
 
-	/* Session never changes once established, so can return const */
 	return path;
 }
 
+/*
+ * A session being opened on behalf of everyone waiting for it. The open
+ * runs in the main context of the caller that started it, and is only
+ * cancelled once every one of the waiters has been cancelled.
+ */
+typedef struct {
+	SecretService *self;
+	SecretSync *sync;
+	GCancellable *cancellable;
+	GList *waiters;
+	guint waiting;
+} EnsureOpen;
+
+typedef struct {
+	SecretWaiter *waiter;
+	GCancellable *cancellable;
+	gulong cancelled_sig;
+} EnsureWaiter;
+
+static void
+on_ensure_waiter_cancelled (GCancellable *cancellable,
+                            gpointer user_data)
+{
+	EnsureOpen *open = user_data;
+	gboolean cancel;
+
+	g_mutex_lock (&open->self->pv->mutex);
+	g_assert (open->waiting > 0);
+	cancel = (--open->waiting == 0);
+	g_mutex_unlock (&open->self->pv->mutex);
+
+	/* Nobody is left to use the session */
+	if (cancel)
+		g_cancellable_cancel (open->cancellable);
+}
+
+static EnsureOpen *
+ensure_open_new_unlocked (SecretService *self)
+{
+	EnsureOpen *open;
+
+	open = g_slice_new0 (EnsureOpen);
+	open->self = g_object_ref (self);
+	open->cancellable = g_cancellable_new ();
+
+	/* A sync call that starts the open keeps running it for the others */
+	open->sync = _secret_sync_hold ();
+
+	return open;
+}
+
+static void
+ensure_open_join_unlocked (EnsureOpen *open,
+                           GSimpleAsyncResult *res,
+                           GCancellable *cancellable)
+{
+	EnsureWaiter *waiter;
+
+	waiter = g_slice_new0 (EnsureWaiter);
+	waiter->waiter = _secret_waiter_new (res, cancellable);
+	open->waiters = g_list_prepend (open->waiters, waiter);
+	open->waiting++;
+
+	/* Not g_cancellable_connect(), which may call back with the lock held */
+	if (cancellable != NULL) {
+		waiter->cancellable = g_object_ref (cancellable);
+		waiter->cancelled_sig = g_signal_connect (cancellable, "cancelled",
+		                                          G_CALLBACK (on_ensure_waiter_cancelled),
+		                                          open);
+	}
+}
+
+static void
+ensure_open_complete (EnsureOpen *open,
+                      const GError *error)
+{
+	SecretService *self = open->self;
+	SecretSession *session = NULL;
+	GSimpleAsyncResult *res;
+	EnsureWaiter *waiter;
+	GList *waiters, *l;
+
+	g_mutex_lock (&self->pv->mutex);
+	if (self->pv->session_open == open)
+		self->pv->session_open = NULL;
+	waiters = open->waiters;
+	open->waiters = NULL;
+	if (error == NULL && self->pv->session != NULL)
+		session = _secret_session_ref (self->pv->session);
+	g_mutex_unlock (&self->pv->mutex);
+
+	/* Each waiter completes in its own main context */
+	for (l = waiters; l != NULL; l = g_list_next (l)) {
+		waiter = l->data;
+		if (waiter->cancellable) {
+			g_cancellable_disconnect (waiter->cancellable, waiter->cancelled_sig);
+			g_object_unref (waiter->cancellable);
+		}
+
+		res = _secret_waiter_claim (waiter->waiter);
+		if (res != NULL) {
+			if (error != NULL)
+				g_simple_async_result_set_from_error (res, error);
+			else if (session != NULL)
+				g_simple_async_result_set_op_res_gpointer (res, _secret_session_ref (session),
+				                                           _secret_session_unref);
+			else
+				g_simple_async_result_set_error (res, SECRET_ERROR, SECRET_ERROR_PROTOCOL,
+				                                 _("Couldn't communicate with the secret storage"));
+			g_simple_async_result_complete_in_idle (res);
+		}
+
+		_secret_waiter_free (waiter->waiter);
+		g_slice_free (EnsureWaiter, waiter);
+	}
+
+	g_list_free (waiters);
+	_secret_session_unref (session);
+
+	_secret_sync_release (open->sync);
+	g_object_unref (open->cancellable);
+	g_object_unref (open->self);
+	g_slice_free (EnsureOpen, open);
+}
+
+static void
+on_ensure_open_session (GObject *source,
+                        GAsyncResult *result,
+                        gpointer user_data)
+{
+	EnsureOpen *open = user_data;
+	GError *error = NULL;
+
+	_secret_session_open_finish (result, &error);
+	ensure_open_complete (open, error);
+	g_clear_error (&error);
+}
+
 /**
  * secret_service_ensure_session:
  * @self: the secret service
@@ -1042,6 +2227,14 @@ secret_service_get_session_path (SecretService *self)
  * to secret_service_get() in order to ensure that a session has been established
  * by the time you get the #SecretService proxy.
  *
+ * If a session is already being established, for example by another thread,
+ * then this operation completes when that session has been established.
+ * Cancelling @cancellable completes this operation right away, but the
+ * session continues to be established for others. The session is
+ * established in the thread default main context of the caller that started
+ * establishing it, so that main context must keep running until the others
+ * are done.
+ *
  * This method will return immediately and complete asynchronously.
  */
 void
@@ -1051,24 +2244,51 @@ secret_service_ensure_session (SecretService *self,
                                gpointer user_data)
 {
 	GSimpleAsyncResult *res;
-	SecretSession *session;
+	EnsureOpen *open = NULL;
+	gboolean start = FALSE;
 
 	g_return_if_fail (SECRET_IS_SERVICE (self));
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
+	res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
+	                                 secret_service_ensure_session);
+
 	g_mutex_lock (&self->pv->mutex);
-	session = self->pv->session;
-	g_mutex_unlock (&self->pv->mutex);
 
-	if (session == NULL) {
-		_secret_session_open (self, cancellable, callback, user_data);
+	/* Time for a new session and key */
+	if (self->pv->session != NULL && self->pv->session_rotation > 0 &&
+	    g_get_monotonic_time () - self->pv->session_opened >
+	    (gint64)self->pv->session_rotation * G_USEC_PER_SEC)
+		service_retire_session_unlocked (self);
 
-	} else {
-		res = g_simple_async_result_new (G_OBJECT (self), callback, user_data,
-		                                 secret_service_ensure_session);
+	if (self->pv->session != NULL) {
+		g_simple_async_result_set_op_res_gpointer (res, _secret_session_ref (self->pv->session),
+		                                           _secret_session_unref);
 		g_simple_async_result_complete_in_idle (res);
-		g_object_unref (res);
+
+	/* Wait for the session that is being opened, or open one */
+	} else {
+		open = self->pv->session_open;
+
+		/* Everyone waiting on that one cancelled, and so it is cancelled */
+		if (open != NULL && open->waiting == 0)
+			open = NULL;
+
+		if (open == NULL) {
+			open = ensure_open_new_unlocked (self);
+			self->pv->session_open = open;
+			start = TRUE;
+		}
+
+		ensure_open_join_unlocked (open, res, cancellable);
 	}
+
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (start)
+		_secret_session_open (self, open->cancellable, on_ensure_open_session, open);
+
+	g_object_unref (res);
 }
 
 /**
@@ -1080,6 +2300,9 @@ secret_service_ensure_session (SecretService *self,
  * Finish an asynchronous operation to ensure that the #SecretService proxy
  * has established a session with the Secret Service.
  *
+ * The returned path belongs to the session. It remains valid while @result
+ * is alive, and after that until the session is closed or replaced.
+ *
  * Returns: the path of the established session
  */
 const gchar *
@@ -1087,17 +2310,43 @@ secret_service_ensure_session_finish (SecretService *self,
                                       GAsyncResult *result,
                                       GError **error)
 {
+	SecretSession *session;
+	const gchar *path;
+
+	session = _secret_service_ensure_session_take (self, result, error);
+	if (session == NULL)
+		return NULL;
+
+	/* The result holds on to the session too */
+	path = _secret_session_get_path (session);
+	_secret_session_unref (session);
+
+	return path;
+}
+
+/*
+ * Returns a reference to the session that secret_service_ensure_session()
+ * completed with. Secrets must be encoded and decoded with that session
+ * rather than the current one, which may have been rotated or reset since.
+ */
+SecretSession *
+_secret_service_ensure_session_take (SecretService *self,
+                                     GAsyncResult *result,
+                                     GError **error)
+{
+	SecretSession *session;
+
 	g_return_val_if_fail (SECRET_IS_SERVICE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	g_return_val_if_fail (g_simple_async_result_is_valid (result, G_OBJECT (self),
+	                      secret_service_ensure_session), NULL);
 
-	if (!g_simple_async_result_is_valid (result, G_OBJECT (self),
-	                                     secret_service_ensure_session)) {
-		if (!_secret_session_open_finish (result, error))
-			return NULL;
-	}
+	if (g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (result), error))
+		return NULL;
 
-	g_return_val_if_fail (self->pv->session != NULL, NULL);
-	return secret_service_get_session_path (self);
+	session = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
+	g_return_val_if_fail (session != NULL, NULL);
+	return _secret_session_ref (session);
 }
 
 /**
@@ -1117,6 +2366,9 @@ secret_service_ensure_session_finish (SecretService *self,
  * This method may block indefinitely and should not be used in user interface
  * threads.
  *
+ * The returned path belongs to the session, and remains valid until the
+ * session is closed or replaced by a new one.
+ *
  * Returns: the path of the established session
  */
 const gchar *
@@ -1166,18 +2418,45 @@ service_lookup_collection (SecretService *self,
 	return collection;
 }
 
+static void
+service_begin_collections (SecretService *self)
+{
+	g_mutex_lock (&self->pv->mutex);
+	self->pv->collections_loading++;
+	g_mutex_unlock (&self->pv->mutex);
+}
+
+/* Pass NULL @collections when loading failed */
 static void
 service_update_collections (SecretService *self,
                             GHashTable *collections)
 {
-	GHashTable *previous;
-
-	g_hash_table_ref (collections);
+	GHashTable *previous = NULL;
+	SecretCollection *collection;
+	GHashTableIter iter;
+	const gchar *path;
 
 	g_mutex_lock (&self->pv->mutex);
 
-	previous = self->pv->collections;
-	self->pv->collections = collections;
+	g_assert (self->pv->collections_loading > 0);
+	self->pv->collections_loading--;
+
+	/* Collections created or deleted while loading are newer than what we loaded */
+	if (collections != NULL) {
+		g_hash_table_iter_init (&iter, self->pv->collection_deltas);
+		while (g_hash_table_iter_next (&iter, (gpointer *)&path, (gpointer *)&collection)) {
+			if (collection != NULL)
+				g_hash_table_insert (collections, g_strdup (path), g_object_ref (collection));
+			else
+				g_hash_table_remove (collections, path);
+		}
+
+		previous = self->pv->collections;
+		self->pv->collections = g_hash_table_ref (collections);
+	}
+
+	if (self->pv->collections_loading == 0)
+		g_hash_table_remove_all (self->pv->collection_deltas);
 
 	g_mutex_unlock (&self->pv->mutex);
 
@@ -1185,6 +2464,94 @@ service_update_collections (SecretService *self,
 		g_hash_table_unref (previous);
 }
 
+static void
+on_collection_created (GObject *source,
+                       GAsyncResult *result,
+                       gpointer user_data)
+{
+	SecretService *self = SECRET_SERVICE (user_data);
+	SecretCollection *collection;
+	GError *error = NULL;
+	gboolean added = FALSE;
+	gchar *path = NULL;
+
+	collection = secret_collection_new_finish (result, &error);
+
+	if (collection != NULL) {
+		path = g_strdup (g_dbus_proxy_get_object_path (G_DBUS_PROXY (collection)));
+
+		/* Not added if it was deleted again while we were loading it */
+		g_mutex_lock (&self->pv->mutex);
+		if (g_hash_table_remove (self->pv->collections_creating, path)) {
+			if (self->pv->collections && !g_hash_table_lookup (self->pv->collections, path)) {
+				g_hash_table_insert (self->pv->collections, g_strdup (path),
+				                     g_object_ref (collection));
+				added = TRUE;
+			}
+			if (self->pv->collections_loading > 0)
+				g_hash_table_insert (self->pv->collection_deltas, g_strdup (path),
+				                     g_object_ref (collection));
+		}
+		g_mutex_unlock (&self->pv->mutex);
+
+		if (added)
+			g_object_notify (G_OBJECT (self), "collections");
+		g_object_unref (collection);
+
+	/* Couldn't load the collection, so go back to loading them all */
+	} else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		secret_service_ensure_collections (self, self->pv->cancellable, NULL, NULL);
+	}
+
+	g_free (path);
+	g_clear_error (&error);
+	g_object_unref (self);
+}
+
+static void
+service_collection_created (SecretService *self,
+                            const gchar *collection_path)
+{
+	gboolean create;
+	gchar *path;
+
+	/* Collections are only tracked once they are being loaded */
+	g_mutex_lock (&self->pv->mutex);
+	if (self->pv->collections != NULL)
+		create = !g_hash_table_lookup (self->pv->collections, collection_path);
+	else
+		create = self->pv->collections_loading > 0;
+	if (create && g_hash_table_lookup (self->pv->collections_creating, collection_path))
+		create = FALSE;
+	if (create) {
+		path = g_strdup (collection_path);
+		g_hash_table_insert (self->pv->collections_creating, path, path);
+	}
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (create)
+		secret_collection_new (self, collection_path, self->pv->cancellable,
+		                       on_collection_created, g_object_ref (self));
+}
+
+static void
+service_collection_deleted (SecretService *self,
+                            const gchar *collection_path)
+{
+	gboolean removed = FALSE;
+
+	g_mutex_lock (&self->pv->mutex);
+	if (self->pv->collections)
+		removed = g_hash_table_remove (self->pv->collections, collection_path);
+	g_hash_table_remove (self->pv->collections_creating, collection_path);
+	if (self->pv->collections_loading > 0)
+		g_hash_table_insert (self->pv->collection_deltas, g_strdup (collection_path), NULL);
+	g_mutex_unlock (&self->pv->mutex);
+
+	if (removed)
+		g_object_notify (G_OBJECT (self), "collections");
+}
+
 typedef struct {
 	GCancellable *cancellable;
 	GHashTable *collections;
@@ -1227,7 +2594,7 @@ on_ensure_collection (GObject *source,
 		g_simple_async_result_take_error (res, error);
 
 	if (collection != NULL) {
-		path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (self));
+		path = g_dbus_proxy_get_object_path (G_DBUS_PROXY (collection));
 		g_hash_table_insert (closure->collections, g_strdup (path), collection);
 	}
 
@@ -1283,6 +2650,8 @@ secret_service_ensure_collections (SecretService *self,
 	closure->collections = collections_table_new ();
 	g_simple_async_result_set_op_res_gpointer (res, closure, ensure_closure_free);
 
+	service_begin_collections (self);
+
 	g_variant_iter_init (&iter, paths);
 	while (g_variant_iter_loop (&iter, "&o", &path)) {
 		collection = service_lookup_collection (self, path);
@@ -1372,6 +2741,7 @@ secret_service_ensure_collections_sync (SecretService *self,
 	g_return_val_if_fail (paths != NULL, FALSE);
 
 	collections = collections_table_new ();
+	service_begin_collections (self);
 
 	g_variant_iter_init (&iter, paths);
 	while (g_variant_iter_next (&iter, "&o", &path)) {
@@ -1389,8 +2759,7 @@ secret_service_ensure_collections_sync (SecretService *self,
 		g_hash_table_insert (collections, g_strdup (path), collection);
 	}
 
-	if (ret)
-		service_update_collections (self, collections);
+	service_update_collections (self, ret ? collections : NULL);
 
 	g_hash_table_unref (collections);
 	g_variant_unref (paths);
@@ -89,6 +89,8 @@ SecretService *      secret_service_get_sync                      (SecretService
                                                                    GCancellable *cancellable,
                                                                    GError **error);
 
+void                 secret_service_set_keep_alive                (guint idle_seconds);
+
 void                 secret_service_new                           (const gchar *service_bus_name,
                                                                    SecretServiceFlags flags,
                                                                    GCancellable *cancellable,
@@ -124,6 +126,20 @@ const gchar *        secret_service_ensure_session_sync           (SecretService
                                                                    GCancellable *cancellable,
                                                                    GError **error);
 
+void                 secret_service_set_session_rotation          (SecretService *self,
+                                                                   guint seconds);
+
+void                 secret_service_set_lookup_cache              (SecretService *self,
+                                                                   guint max_entries,
+                                                                   guint ttl_seconds,
+                                                                   gboolean cache_secrets);
+
+void                 secret_service_get_lookup_cache_stats        (SecretService *self,
+                                                                   guint *hits,
+                                                                   guint *misses);
+
+void                 secret_service_clear_lookup_cache            (SecretService *self);
+
 void                 secret_service_ensure_collections            (SecretService *self,
                                                                    GCancellable *cancellable,
                                                                    GAsyncReadyCallback callback,
@@ -156,6 +172,25 @@ gboolean             secret_service_search_sync                   (SecretService
                                                                    GList **locked,
                                                                    GError **error);
 
+void                 secret_service_search_handles                (SecretService *self,
+                                                                   GHashTable *attributes,
+                                                                   GCancellable *cancellable,
+                                                                   GAsyncReadyCallback callback,
+                                                                   gpointer user_data);
+
+gboolean             secret_service_search_handles_finish         (SecretService *self,
+                                                                   GAsyncResult *result,
+                                                                   GList **unlocked,
+                                                                   GList **locked,
+                                                                   GError **error);
+
+gboolean             secret_service_search_handles_sync           (SecretService *self,
+                                                                   GHashTable *attributes,
+                                                                   GCancellable *cancellable,
+                                                                   GList **unlocked,
+                                                                   GList **locked,
+                                                                   GError **error);
+
 void                 secret_service_search_for_paths              (SecretService *self,
                                                                    GHashTable *attributes,
                                                                    GCancellable *cancellable,
@@ -205,6 +240,21 @@ GHashTable *         secret_service_get_secrets_for_paths_sync    (SecretService
                                                                    GCancellable *cancellable,
                                                                    GError **error);
 
+void                 secret_service_get_secret_array_for_paths    (SecretService *self,
+                                                                   const gchar **item_paths,
+                                                                   GCancellable *cancellable,
+                                                                   GAsyncReadyCallback callback,
+                                                                   gpointer user_data);
+
+SecretValueArray *   secret_service_get_secret_array_for_paths_finish (SecretService *self,
+                                                                   GAsyncResult *result,
+                                                                   GError **error);
+
+SecretValueArray *   secret_service_get_secret_array_for_paths_sync (SecretService *self,
+                                                                   const gchar **item_paths,
+                                                                   GCancellable *cancellable,
+                                                                   GError **error);
+
 void                 secret_service_get_secrets                   (SecretService *self,
                                                                    GList *items,
                                                                    GCancellable *cancellable,
@@ -375,6 +425,25 @@ SecretValue *        secret_service_lookupv_sync                  (SecretService
                                                                    GCancellable *cancellable,
                                                                    GError **error);
 
+void                 secret_service_lookup_batch                  (SecretService *self,
+                                                                   const SecretSchema **schemas,
+                                                                   GHashTable **attributes,
+                                                                   guint n_lookups,
+                                                                   GCancellable *cancellable,
+                                                                   GAsyncReadyCallback callback,
+                                                                   gpointer user_data);
+
+GPtrArray *          secret_service_lookup_batch_finish           (SecretService *self,
+                                                                   GAsyncResult *result,
+                                                                   GError **error);
+
+GPtrArray *          secret_service_lookup_batch_sync             (SecretService *self,
+                                                                   const SecretSchema **schemas,
+                                                                   GHashTable **attributes,
+                                                                   guint n_lookups,
+                                                                   GCancellable *cancellable,
+                                                                   GError **error);
+
 void                 secret_service_delete_path                   (SecretService *self,
                                                                    const gchar *item_path,
                                                                    GCancellable *cancellable,
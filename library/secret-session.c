@@ -26,48 +26,126 @@
 
 #include <glib/gi18n-lib.h>
 
+#include <string.h>
+
 EGG_SECURE_DECLARE (secret_session);
 
+#define ALGORITHMS_X25519 "ecdh-x25519-sha256-aes128-gcm"
 #define ALGORITHMS_AES    "dh-ietf1024-sha256-aes128-cbc-pkcs7"
 #define ALGORITHMS_PLAIN  "plain"
 
+#define DH_GROUP          "ietf-ike-grp-modp-1024"
+
+#define X25519_KEY_LENGTH 32
+#define GCM_NONCE_LENGTH  12
+#define GCM_TAG_LENGTH    16
+
 struct _SecretSession {
+	gint refs;
 	gchar *path;
 	const gchar *algorithms;
+
+	/* The service instance that the session was opened with */
+	GDBusConnection *connection;
+	gchar *owner;
+	gboolean retired;
 #ifdef WITH_GCRYPT
 	gcry_mpi_t prime;
 	gcry_mpi_t privat;
 	gcry_mpi_t publi;
+#ifdef WITH_X25519
+	gpointer x25519_privat;
+#endif
+
+	/* Key-scheduled cipher, reused for each secret, guarded by mutex */
+	GMutex mutex;
+	gcry_cipher_hd_t cipher;
+
+	/* Cipher is AES-GCM: no padding, tag appended to each secret */
+	gboolean aead;
 #endif
 	gpointer key;
 	gsize n_key;
 };
 
+static SecretSession *
+session_new (void)
+{
+	SecretSession *session;
+
+	session = g_new0 (SecretSession, 1);
+	session->refs = 1;
+#ifdef WITH_GCRYPT
+	g_mutex_init (&session->mutex);
+#endif
+
+	return session;
+}
+
+SecretSession *
+_secret_session_ref (SecretSession *session)
+{
+	g_return_val_if_fail (session != NULL, NULL);
+	g_atomic_int_inc (&session->refs);
+	return session;
+}
+
 void
-_secret_session_free (gpointer data)
+_secret_session_unref (gpointer data)
 {
 	SecretSession *session = data;
 
-	if (session == NULL)
+	if (session == NULL || !g_atomic_int_dec_and_test (&session->refs))
 		return;
 
+	/*
+	 * Sent to the unique name the session was opened with, so that a
+	 * restarted service doesn't close a new session with the same path.
+	 * Nobody waits for the reply, so this doesn't need a main context.
+	 */
+	if (session->retired && session->path && session->owner) {
+		g_dbus_connection_call (session->connection, session->owner, session->path,
+		                        SECRET_SESSION_INTERFACE, "Close", NULL, NULL,
+		                        G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, NULL, NULL);
+	}
+
+	g_clear_object (&session->connection);
+	g_free (session->owner);
 	g_free (session->path);
 #ifdef WITH_GCRYPT
 	gcry_mpi_release (session->publi);
 	gcry_mpi_release (session->privat);
 	gcry_mpi_release (session->prime);
+#ifdef WITH_X25519
+	egg_secure_free (session->x25519_privat);
+#endif
+	if (session->cipher)
+		gcry_cipher_close (session->cipher);
+	g_mutex_clear (&session->mutex);
 #endif
 	egg_secure_free (session->key);
 	g_free (session);
 }
 
+/*
+ * Drops the reference to a session that is being replaced. The session
+ * is closed on the service once the secrets in transit with it are done.
+ */
+void
+_secret_session_retire (SecretSession *session)
+{
+	g_return_if_fail (session != NULL);
+
+	session->retired = TRUE;
+	_secret_session_unref (session);
+}
+
 #ifdef WITH_GCRYPT
 
 static GVariant *
 request_open_session_aes (SecretSession *session)
 {
 	gcry_error_t gcry;
-	gcry_mpi_t base;
 	unsigned char *buffer;
 	size_t n_buffer;
 	GVariant *argument;
@@ -76,24 +154,17 @@ request_open_session_aes (SecretSession *session)
 	g_assert (session->privat == NULL);
 	g_assert (session->publi == NULL);
 
-	/* Initialize our local parameters and values */
-	if (!egg_dh_default_params ("ietf-ike-grp-modp-1024",
-	                            &session->prime, &base))
+	/* Cached group parameters, and a pre-generated key pair if we have one */
+	if (!egg_dh_gen_pair_for_group (DH_GROUP, &session->prime,
+	                                &session->publi, &session->privat))
 		g_return_val_if_reached (NULL);
 
 #if 0
 	g_printerr ("\n lib prime: ");
 	gcry_mpi_dump (session->prime);
-	g_printerr ("\n  lib base: ");
-	gcry_mpi_dump (base);
 	g_printerr ("\n");
 #endif
 
-	if (!egg_dh_gen_pair (session->prime, base, 0,
-	                      &session->publi, &session->privat))
-		g_return_val_if_reached (NULL);
-	gcry_mpi_release (base);
-
 	gcry = gcry_mpi_aprint (GCRYMPI_FMT_USG, &buffer, &n_buffer, session->publi);
 	g_return_val_if_fail (gcry == 0, NULL);
 	argument = g_variant_new_from_data (G_VARIANT_TYPE ("ay"),
@@ -161,10 +232,134 @@ response_open_session_aes (SecretSession *session,
 		g_return_val_if_reached (FALSE);
 	egg_secure_free (ikm);
 
+	/* Expand the key once, each secret then only needs a new IV */
+	gcry = gcry_cipher_open (&session->cipher, GCRY_CIPHER_AES,
+	                         GCRY_CIPHER_MODE_CBC, GCRY_CIPHER_SECURE);
+	if (gcry != 0) {
+		g_warning ("couldn't create AES cipher: %s", gcry_strerror (gcry));
+		g_free (session->path);
+		session->path = NULL;
+		return FALSE;
+	}
+
+	gcry = gcry_cipher_setkey (session->cipher, session->key, session->n_key);
+	g_return_val_if_fail (gcry == 0, FALSE);
+
 	session->algorithms = ALGORITHMS_AES;
 	return TRUE;
 }
 
+#ifdef WITH_X25519
+
+static GVariant *
+request_open_session_x25519 (SecretSession *session)
+{
+	guchar publi[X25519_KEY_LENGTH];
+	guchar *privat;
+	gcry_error_t gcry;
+	GVariant *argument;
+
+	g_assert (session->x25519_privat == NULL);
+
+	privat = egg_secure_alloc (X25519_KEY_LENGTH);
+	gcry_randomize (privat, X25519_KEY_LENGTH, GCRY_STRONG_RANDOM);
+
+	/* Clamp the scalar as described in RFC 7748 */
+	privat[0] &= 248;
+	privat[31] &= 127;
+	privat[31] |= 64;
+
+	gcry = gcry_ecc_mul_point (GCRY_ECC_CURVE25519, publi, privat, NULL);
+	if (gcry != 0) {
+		egg_secure_free (privat);
+		g_return_val_if_reached (NULL);
+	}
+
+	session->x25519_privat = privat;
+	argument = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, publi,
+	                                      X25519_KEY_LENGTH, sizeof (guchar));
+
+	return g_variant_new ("(sv)", ALGORITHMS_X25519, argument);
+}
+
+static gboolean
+response_open_session_x25519 (SecretSession *session,
+                              GVariant *response)
+{
+	static const guchar zeros[X25519_KEY_LENGTH] = { 0, };
+	gconstpointer peer;
+	GVariant *argument;
+	const gchar *sig;
+	gsize n_peer;
+	gcry_error_t gcry;
+	guchar *ikm;
+
+	sig = g_variant_get_type_string (response);
+	g_return_val_if_fail (sig != NULL, FALSE);
+
+	if (!g_str_equal (sig, "(vo)")) {
+		g_warning ("invalid OpenSession() response from daemon with signature: %s", sig);
+		return FALSE;
+	}
+
+	g_assert (session->path == NULL);
+	g_variant_get (response, "(vo)", &argument, &session->path);
+
+	if (!g_variant_is_of_type (argument, G_VARIANT_TYPE_BYTESTRING)) {
+		g_warning ("invalid OpenSession() response from daemon with argument: %s",
+		           g_variant_get_type_string (argument));
+		g_variant_unref (argument);
+		g_free (session->path);
+		session->path = NULL;
+		return FALSE;
+	}
+
+	peer = g_variant_get_fixed_array (argument, &n_peer, sizeof (guchar));
+	ikm = egg_secure_alloc (X25519_KEY_LENGTH);
+
+	gcry = GPG_ERR_INV_DATA;
+	if (n_peer == X25519_KEY_LENGTH)
+		gcry = gcry_ecc_mul_point (GCRY_ECC_CURVE25519, ikm, session->x25519_privat, peer);
+	g_variant_unref (argument);
+
+	egg_secure_free (session->x25519_privat);
+	session->x25519_privat = NULL;
+
+	/* An all zero result means the peer sent a low order point */
+	if (gcry != 0 || memcmp (ikm, zeros, X25519_KEY_LENGTH) == 0) {
+		g_warning ("couldn't negotiate a valid X25519 session key");
+		egg_secure_free (ikm);
+		g_free (session->path);
+		session->path = NULL;
+		return FALSE;
+	}
+
+	session->n_key = 16;
+	session->key = egg_secure_alloc (session->n_key);
+	if (!egg_hkdf_perform ("sha256", ikm, X25519_KEY_LENGTH, NULL, 0, NULL, 0,
+	                       session->key, session->n_key))
+		g_return_val_if_reached (FALSE);
+	egg_secure_free (ikm);
+
+	gcry = gcry_cipher_open (&session->cipher, GCRY_CIPHER_AES,
+	                         GCRY_CIPHER_MODE_GCM, GCRY_CIPHER_SECURE);
+	if (gcry != 0) {
+		g_warning ("couldn't create AES-GCM cipher: %s", gcry_strerror (gcry));
+		g_free (session->path);
+		session->path = NULL;
+		return FALSE;
+	}
+
+	gcry = gcry_cipher_setkey (session->cipher, session->key, session->n_key);
+	g_return_val_if_fail (gcry == 0, FALSE);
+
+	session->aead = TRUE;
+	session->algorithms = ALGORITHMS_X25519;
+	return TRUE;
+}
+
+#endif /* WITH_X25519 */
+
 #endif /* WITH_GCRYPT */
 
 static GVariant *
@@ -201,9 +396,18 @@ response_open_session_plain (SecretSession *session,
 	return TRUE;
 }
 
+typedef enum {
+	OPEN_SESSION_X25519,
+	OPEN_SESSION_AES
+} OpenSessionAlgorithm;
+
 typedef struct {
 	GCancellable *cancellable;
 	SecretSession *session;
+	OpenSessionAlgorithm algorithm;
+	GVariant *request;
+	GVariant *response;
+	gboolean negotiated;
 } OpenSessionClosure;
 
 static void
@@ -212,7 +416,11 @@ open_session_closure_free (gpointer data)
 	OpenSessionClosure *closure = data;
 	g_assert (closure);
 	g_clear_object (&closure->cancellable);
-	_secret_session_free (closure->session);
+	if (closure->request)
+		g_variant_unref (closure->request);
+	if (closure->response)
+		g_variant_unref (closure->response);
+	_secret_session_unref (closure->session);
 	g_free (closure);
 }
 
@@ -253,55 +461,172 @@ on_service_open_session_plain (GObject *source,
 
 #ifdef WITH_GCRYPT
 
+/*
+ * Key generation and key agreement take milliseconds, so they run in a
+ * worker thread rather than stalling the caller's main loop. The
+ * callback runs back in the caller's thread default main context, which
+ * is where secret_service_ensure_session() opens the session. This is
+ * the only thread involved.
+ */
+static void
+open_session_run_in_thread (GSimpleAsyncResult *res,
+                            GSimpleAsyncThreadFunc func,
+                            GAsyncReadyCallback callback)
+{
+	GSimpleAsyncResult *inner;
+	GObject *source;
+
+	source = g_async_result_get_source_object (G_ASYNC_RESULT (res));
+	inner = g_simple_async_result_new (source, callback, g_object_ref (res),
+	                                   open_session_run_in_thread);
+	g_simple_async_result_set_op_res_gpointer (inner,
+	                                           g_simple_async_result_get_op_res_gpointer (res),
+	                                           NULL);
+	g_simple_async_result_run_in_thread (inner, func, G_PRIORITY_DEFAULT, NULL);
+
+	g_object_unref (inner);
+	g_object_unref (source);
+}
+
+static void
+open_session_request_thread (GSimpleAsyncResult *inner,
+                             GObject *source,
+                             GCancellable *cancellable)
+{
+	OpenSessionClosure *closure = g_simple_async_result_get_op_res_gpointer (inner);
+
+#ifdef WITH_X25519
+	if (closure->algorithm == OPEN_SESSION_X25519)
+		closure->request = request_open_session_x25519 (closure->session);
+	else
+#endif
+		closure->request = request_open_session_aes (closure->session);
+
+	if (closure->request)
+		g_variant_ref_sink (closure->request);
+}
+
+static void
+open_session_response_thread (GSimpleAsyncResult *inner,
+                              GObject *source,
+                              GCancellable *cancellable)
+{
+	OpenSessionClosure *closure = g_simple_async_result_get_op_res_gpointer (inner);
+
+#ifdef WITH_X25519
+	if (closure->algorithm == OPEN_SESSION_X25519)
+		closure->negotiated = response_open_session_x25519 (closure->session,
+		                                                    closure->response);
+	else
+#endif
+		closure->negotiated = response_open_session_aes (closure->session,
+		                                                 closure->response);
+}
+
 static void
-on_service_open_session_aes (GObject *source,
-                             GAsyncResult *result,
-                             gpointer user_data)
+on_open_session_response (GObject *source,
+                          GAsyncResult *result,
+                          gpointer user_data)
 {
 	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
-	OpenSessionClosure * closure = g_simple_async_result_get_op_res_gpointer (res);
-	SecretService *service = SECRET_SERVICE (source);
+	OpenSessionClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+
+	if (closure->negotiated) {
+#ifdef WITH_X25519
+		if (closure->algorithm == OPEN_SESSION_X25519)
+			_secret_service_set_x25519 (SECRET_SERVICE (source), TRUE);
+#endif
+		_secret_service_take_session (SECRET_SERVICE (source), closure->session);
+		closure->session = NULL;
+
+	} else {
+		g_simple_async_result_set_error (res, SECRET_ERROR, SECRET_ERROR_PROTOCOL,
+		                                 _("Couldn't communicate with the secret storage"));
+	}
+
+	g_simple_async_result_complete (res);
+	g_object_unref (res);
+}
+
+static void
+on_open_session_request (GObject *source,
+                         GAsyncResult *result,
+                         gpointer user_data);
+
+static void
+on_service_open_session_crypto (GObject *source,
+                                GAsyncResult *result,
+                                gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	OpenSessionClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
 	GError *error = NULL;
-	GVariant *response;
 
-	response =  g_dbus_proxy_call_finish (G_DBUS_PROXY (service), result, &error);
+	g_variant_unref (closure->request);
+	closure->request = NULL;
 
-	/* A successful response, decode it */
-	if (response != NULL) {
-		if (response_open_session_aes (closure->session, response)) {
-			_secret_service_take_session (service, closure->session);
-			closure->session = NULL;
+	closure->response = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), result, &error);
 
-		} else {
-			g_simple_async_result_set_error (res, SECRET_ERROR, SECRET_ERROR_PROTOCOL,
-			                                 _("Couldn't communicate with the secret storage"));
-		}
+	/* A successful response, derive the key off the main loop */
+	if (closure->response != NULL) {
+		open_session_run_in_thread (res, open_session_response_thread,
+		                            on_open_session_response);
 
-		g_simple_async_result_complete (res);
-		g_variant_unref (response);
+	/* Algorithm not supported, fall back to the next one */
+	} else if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED)) {
+		g_error_free (error);
 
-	} else {
-		/* AES session not supported, request a plain session */
-		if (g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED)) {
+#ifdef WITH_X25519
+		if (closure->algorithm == OPEN_SESSION_X25519) {
+			egg_secure_free (closure->session->x25519_privat);
+			closure->session->x25519_privat = NULL;
+			_secret_service_set_x25519 (SECRET_SERVICE (source), FALSE);
+
+			closure->algorithm = OPEN_SESSION_AES;
+			open_session_run_in_thread (res, open_session_request_thread,
+			                            on_open_session_request);
+		} else
+#endif
+		{
 			g_dbus_proxy_call (G_DBUS_PROXY (source), "OpenSession",
 			                   request_open_session_plain (closure->session),
 			                   G_DBUS_CALL_FLAGS_NONE, -1,
 			                   closure->cancellable, on_service_open_session_plain,
 			                   g_object_ref (res));
-			g_error_free (error);
-
-		/* Other errors result in a failure */
-		} else {
-			g_simple_async_result_take_error (res, error);
-			g_simple_async_result_complete (res);
 		}
+
+	/* Other errors result in a failure */
+	} else {
+		g_simple_async_result_take_error (res, error);
+		g_simple_async_result_complete (res);
 	}
 
 	g_object_unref (res);
 }
 
-#endif /* WITH_GCRYPT */
+static void
+on_open_session_request (GObject *source,
+                         GAsyncResult *result,
+                         gpointer user_data)
+{
+	GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (user_data);
+	OpenSessionClosure *closure = g_simple_async_result_get_op_res_gpointer (res);
+
+	if (closure->request == NULL) {
+		g_simple_async_result_set_error (res, SECRET_ERROR, SECRET_ERROR_PROTOCOL,
+		                                 _("Couldn't communicate with the secret storage"));
+		g_simple_async_result_complete (res);
+
+	} else {
+		g_dbus_proxy_call (G_DBUS_PROXY (source), "OpenSession", closure->request,
+		                   G_DBUS_CALL_FLAGS_NONE, -1, closure->cancellable,
+		                   on_service_open_session_crypto, g_object_ref (res));
+	}
 
+	g_object_unref (res);
+}
+
+#endif /* WITH_GCRYPT */
 
 void
 _secret_session_open (SecretService *service,
@@ -314,22 +639,29 @@ _secret_session_open (SecretService *service,
 
 	res = g_simple_async_result_new (G_OBJECT (service), callback, user_data,
 	                                 _secret_session_open);
-	closure = g_new (OpenSessionClosure, 1);
+	closure = g_new0 (OpenSessionClosure, 1);
 	closure->cancellable = cancellable ? g_object_ref (cancellable) : cancellable;
-	closure->session = g_new0 (SecretSession, 1);
+	closure->session = session_new ();
+	closure->session->connection = g_object_ref (g_dbus_proxy_get_connection (G_DBUS_PROXY (service)));
+	closure->session->owner = g_dbus_proxy_get_name_owner (G_DBUS_PROXY (service));
 	g_simple_async_result_set_op_res_gpointer (res, closure, open_session_closure_free);
 
-	g_dbus_proxy_call (G_DBUS_PROXY (service), "OpenSession",
 #ifdef WITH_GCRYPT
-	                   request_open_session_aes (closure->session),
-	                   G_DBUS_CALL_FLAGS_NONE, -1,
-	                   cancellable, on_service_open_session_aes,
+	closure->algorithm = OPEN_SESSION_AES;
+#ifdef WITH_X25519
+	/* Don't make a key pair the service has already said it can't use */
+	if (_secret_service_get_x25519 (service) != SECRET_EXTENSION_MISSING)
+		closure->algorithm = OPEN_SESSION_X25519;
+#endif
+	open_session_run_in_thread (res, open_session_request_thread,
+	                            on_open_session_request);
 #else
+	g_dbus_proxy_call (G_DBUS_PROXY (service), "OpenSession",
 	                   request_open_session_plain (closure->session),
 	                   G_DBUS_CALL_FLAGS_NONE, -1,
 	                   cancellable, on_service_open_session_plain,
-#endif
 	                   g_object_ref (res));
+#endif
 
 	g_object_unref (res);
 }
@@ -376,71 +708,153 @@ pkcs7_unpad_bytes_in_place (guchar *padded,
 	return TRUE;
 }
 
-static SecretValue *
-service_decode_aes_secret (SecretSession *session,
-                           gconstpointer param,
-                           gsize n_param,
-                           gconstpointer value,
-                           gsize n_value,
-                           const gchar *content_type)
+static gboolean
+service_decrypt_aes_secret (SecretSession *session,
+                            gconstpointer param,
+                            gsize n_param,
+                            gconstpointer value,
+                            gsize n_value,
+                            guchar *padded,
+                            gsize *n_padded)
 {
-	gcry_cipher_hd_t cih;
-	gsize n_padded;
 	gcry_error_t gcry;
-	guchar *padded;
-	gsize pos;
 
 	if (n_param != 16) {
 		g_message ("received an encrypted secret structure with invalid parameter");
-		return NULL;
+		return FALSE;
 	}
 
 	if (n_value == 0 || n_value % 16 != 0) {
 		g_message ("received an encrypted secret structure with bad secret length");
-		return NULL;
+		return FALSE;
 	}
 
-	gcry = gcry_cipher_open (&cih, GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CBC, 0);
-	if (gcry != 0) {
-		g_warning ("couldn't create AES cipher: %s", gcry_strerror (gcry));
-		return NULL;
-	}
+	g_return_val_if_fail (session->cipher != NULL, FALSE);
 
 #if 0
 	g_printerr ("    lib iv:  %s\n", egg_hex_encode (param, n_param));
+	g_printerr ("   lib key:  %s\n", egg_hex_encode (session->key, session->n_key));
 #endif
 
-	gcry = gcry_cipher_setiv (cih, param, n_param);
-	g_return_val_if_fail (gcry == 0, NULL);
+	*n_padded = n_value;
 
-#if 0
-	g_printerr ("   lib key:  %s\n", egg_hex_encode (session->key, session->n_key));
-#endif
+	g_mutex_lock (&session->mutex);
 
-	gcry = gcry_cipher_setkey (cih, session->key, session->n_key);
-	g_return_val_if_fail (gcry == 0, NULL);
+	/* Decrypt the whole buffer straight into secure memory */
+	gcry = gcry_cipher_setiv (session->cipher, param, n_param);
+	if (gcry == 0)
+		gcry = gcry_cipher_decrypt (session->cipher, padded, *n_padded, value, n_value);
 
-	/* Copy the memory buffer */
-	n_padded = n_value;
-	padded = egg_secure_alloc (n_padded);
-	memcpy (padded, value, n_padded);
+	g_mutex_unlock (&session->mutex);
 
-	/* Perform the decryption */
-	for (pos = 0; pos < n_padded; pos += 16) {
-		gcry = gcry_cipher_decrypt (cih, (guchar*)padded + pos, 16, NULL, 0);
-		g_return_val_if_fail (gcry == 0, FALSE);
+	if (gcry != 0) {
+		egg_secure_clear (padded, *n_padded);
+		g_return_val_if_reached (FALSE);
 	}
 
-	gcry_cipher_close (cih);
-
 	/* Unpad the resulting value */
-	if (!pkcs7_unpad_bytes_in_place (padded, &n_padded)) {
-		egg_secure_clear (padded, n_padded);
-		egg_secure_free (padded);
+	if (!pkcs7_unpad_bytes_in_place (padded, n_padded)) {
+		egg_secure_clear (padded, n_value);
 		g_message ("received an invalid or unencryptable secret");
 		return FALSE;
 	}
 
+	return TRUE;
+}
+
+#ifdef WITH_X25519
+
+static gboolean
+service_decrypt_gcm_secret (SecretSession *session,
+                            gconstpointer param,
+                            gsize n_param,
+                            gconstpointer value,
+                            gsize n_value,
+                            guchar *plain,
+                            gsize *n_plain)
+{
+	gcry_error_t gcry;
+
+	if (n_param != GCM_NONCE_LENGTH) {
+		g_message ("received an encrypted secret structure with invalid parameter");
+		return FALSE;
+	}
+
+	if (n_value < GCM_TAG_LENGTH) {
+		g_message ("received an encrypted secret structure with bad secret length");
+		return FALSE;
+	}
+
+	g_return_val_if_fail (session->cipher != NULL, FALSE);
+
+	*n_plain = n_value - GCM_TAG_LENGTH;
+
+	g_mutex_lock (&session->mutex);
+
+	/* Setting the nonce starts a new message, then check the trailing tag */
+	gcry = gcry_cipher_setiv (session->cipher, param, n_param);
+	if (gcry == 0)
+		gcry = gcry_cipher_decrypt (session->cipher, plain, *n_plain, value, *n_plain);
+	if (gcry == 0)
+		gcry = gcry_cipher_checktag (session->cipher, (const guchar *)value + *n_plain,
+		                             GCM_TAG_LENGTH);
+
+	g_mutex_unlock (&session->mutex);
+
+	if (gcry != 0) {
+		egg_secure_clear (plain, *n_plain);
+		g_message ("received an invalid or unencryptable secret");
+		return FALSE;
+	}
+
+	/* Null teriminate as a courtesy */
+	plain[*n_plain] = 0;
+
+	return TRUE;
+}
+
+#endif /* WITH_X25519 */
+
+/*
+ * Decrypt into @plain, which must have room for @n_value bytes plus a
+ * null terminator.
+ */
+static gboolean
+service_decrypt_secret (SecretSession *session,
+                        gconstpointer param,
+                        gsize n_param,
+                        gconstpointer value,
+                        gsize n_value,
+                        guchar *plain,
+                        gsize *n_plain)
+{
+#ifdef WITH_X25519
+	if (session->aead)
+		return service_decrypt_gcm_secret (session, param, n_param, value, n_value,
+		                                   plain, n_plain);
+#endif
+	return service_decrypt_aes_secret (session, param, n_param, value, n_value,
+	                                   plain, n_plain);
+}
+
+static SecretValue *
+service_decode_aes_secret (SecretSession *session,
+                           gconstpointer param,
+                           gsize n_param,
+                           gconstpointer value,
+                           gsize n_value,
+                           const gchar *content_type)
+{
+	gsize n_padded;
+	guchar *padded;
+
+	padded = egg_secure_alloc (n_value + 1);
+	if (!service_decrypt_secret (session, param, n_param, value, n_value,
+	                             padded, &n_padded)) {
+		egg_secure_free (padded);
+		return NULL;
+	}
+
 	return secret_value_new_full ((gchar *)padded, n_padded, content_type, egg_secure_free);
 }
 
@@ -512,6 +926,123 @@ _secret_session_decode_secret (SecretSession *session,
 	return result;
 }
 
+typedef struct {
+	const gchar *path;
+	const gchar *content_type;
+	gconstpointer param;
+	gsize n_param;
+	gconstpointer value;
+	gsize n_value;
+} DecodeEntry;
+
+/*
+ * Decode a whole GetSecrets reply of the form (a{o(oayays)}) at once.
+ *
+ * Paths are borrowed from the reply, content types are interned, and all
+ * the secrets are decrypted into one shared block of secure memory. This
+ * keeps the per-secret cost to the SecretValue itself.
+ */
+SecretValueArray *
+_secret_session_decode_secrets (SecretSession *session,
+                                GVariant *reply)
+{
+	SecretValueArray *array;
+	SecretValueArena *arena;
+	DecodeEntry *entries;
+	const gchar *last_type = NULL;
+	const gchar *interned = NULL;
+	const gchar *session_path;
+	const gchar *content_type;
+	GVariant *vparam;
+	GVariant *vvalue;
+	GVariant *dict;
+	GVariantIter iter;
+	gsize n_entries = 0;
+	gsize total = 0;
+	gsize n_children;
+	gsize n_padded;
+	gchar *secret;
+	DecodeEntry *entry;
+	gsize i;
+
+	g_return_val_if_fail (session != NULL, NULL);
+	g_return_val_if_fail (reply != NULL, NULL);
+
+	dict = g_variant_get_child_value (reply, 0);
+	n_children = g_variant_n_children (dict);
+	entries = g_new (DecodeEntry, MAX (n_children, 1));
+
+	/*
+	 * First pass, find out where everything is in the reply. The reply
+	 * is already serialized, so the pointers into its children stay
+	 * valid for as long as the reply itself.
+	 */
+	g_variant_iter_init (&iter, dict);
+	while (g_variant_iter_next (&iter, "{&o(&o@ay@ay&s)}", &entries[n_entries].path,
+	                            &session_path, &vparam, &vvalue, &content_type)) {
+		entry = entries + n_entries;
+
+		if (!g_str_equal (session_path, session->path)) {
+			g_message ("received a secret encoded with wrong session: %s != %s",
+			           session_path, session->path);
+
+		} else {
+			entry->param = g_variant_get_fixed_array (vparam, &entry->n_param, sizeof (guchar));
+			entry->value = g_variant_get_fixed_array (vvalue, &entry->n_value, sizeof (guchar));
+
+			/* Replies almost always use the same content type */
+			if (last_type == NULL || !g_str_equal (last_type, content_type))
+				interned = g_intern_string (content_type);
+			last_type = content_type;
+			entry->content_type = interned;
+
+			/* Room for a null terminator on plain secrets */
+			total += entry->n_value + 1;
+			n_entries++;
+		}
+
+		g_variant_unref (vparam);
+		g_variant_unref (vvalue);
+	}
+
+	/* Second pass, decode everything into one block of secure memory */
+	arena = _secret_value_arena_new (total);
+	array = _secret_value_array_new (reply, n_entries);
+
+	for (i = 0; i < n_entries; i++) {
+		entry = entries + i;
+		secret = _secret_value_arena_alloc (arena, entry->n_value + 1);
+
+#ifdef WITH_GCRYPT
+		if (session->key != NULL) {
+			if (!service_decrypt_secret (session, entry->param, entry->n_param,
+			                             entry->value, entry->n_value,
+			                             (guchar *)secret, &n_padded))
+				continue;
+		} else
+#endif
+		{
+			if (entry->n_param != 0) {
+				g_message ("received a plain secret structure with invalid parameter");
+				continue;
+			}
+			memcpy (secret, entry->value, entry->n_value);
+			secret[entry->n_value] = 0;
+			n_padded = entry->n_value;
+		}
+
+		_secret_value_array_take (array, entry->path,
+		                          _secret_value_new_in_arena (arena, secret, n_padded,
+		                                                      entry->content_type));
+	}
+
+	_secret_value_arena_unref (arena);
+	g_variant_unref (dict);
+	g_free (entries);
+
+	return array;
+}
+
 #ifdef WITH_GCRYPT
 
 static guchar*
@@ -539,23 +1070,17 @@ service_encode_aes_secret (SecretSession *session,
                            SecretValue *value,
                            GVariantBuilder *builder)
 {
-	gcry_cipher_hd_t cih;
 	guchar *padded;
-	gsize n_padded, pos;
+	gsize n_padded;
 	gcry_error_t gcry;
 	gpointer iv;
 	gconstpointer secret;
 	gsize n_secret;
 	GVariant *child;
 
-	g_variant_builder_add (builder, "o", session->path);
+	g_return_val_if_fail (session->cipher != NULL, FALSE);
 
-	/* Create the cipher */
-	gcry = gcry_cipher_open (&cih, GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CBC, 0);
-	if (gcry != 0) {
-		g_warning ("couldn't create AES cipher: %s", gcry_strerror (gcry));
-		return FALSE;
-	}
+	g_variant_builder_add (builder, "o", session->path);
 
 	secret = secret_value_get (value, &n_secret);
 
@@ -566,20 +1091,22 @@ service_encode_aes_secret (SecretSession *session,
 	/* Setup the IV */
 	iv = g_malloc0 (16);
 	gcry_create_nonce (iv, 16);
-	gcry = gcry_cipher_setiv (cih, iv, 16);
-	g_return_val_if_fail (gcry == 0, FALSE);
 
-	/* Setup the key */
-	gcry = gcry_cipher_setkey (cih, session->key, session->n_key);
-	g_return_val_if_fail (gcry == 0, FALSE);
+	g_mutex_lock (&session->mutex);
 
-	/* Perform the encryption */
-	for (pos = 0; pos < n_padded; pos += 16) {
-		gcry = gcry_cipher_encrypt (cih, (guchar*)padded + pos, 16, NULL, 0);
-		g_return_val_if_fail (gcry == 0, FALSE);
-	}
+	/* Perform the encryption in place, over the whole buffer */
+	gcry = gcry_cipher_setiv (session->cipher, iv, 16);
+	if (gcry == 0)
+		gcry = gcry_cipher_encrypt (session->cipher, padded, n_padded, NULL, 0);
 
-	gcry_cipher_close (cih);
+	g_mutex_unlock (&session->mutex);
+
+	if (gcry != 0) {
+		egg_secure_clear (padded, n_padded);
+		egg_secure_free (padded);
+		g_free (iv);
+		g_return_val_if_reached (FALSE);
+	}
 
 	child = g_variant_new_from_data (G_VARIANT_TYPE ("ay"), iv, 16, TRUE, g_free, iv);
 	g_variant_builder_add_value (builder, child);
@@ -591,6 +1118,62 @@ service_encode_aes_secret (SecretSession *session,
 	return TRUE;
 }
 
+#ifdef WITH_X25519
+
+static gboolean
+service_encode_gcm_secret (SecretSession *session,
+                           SecretValue *value,
+                           GVariantBuilder *builder)
+{
+	gconstpointer secret;
+	gsize n_secret;
+	gcry_error_t gcry;
+	guchar *sealed;
+	gpointer nonce;
+	GVariant *child;
+
+	g_return_val_if_fail (session->cipher != NULL, FALSE);
+
+	g_variant_builder_add (builder, "o", session->path);
+
+	secret = secret_value_get (value, &n_secret);
+	sealed = egg_secure_alloc (n_secret + GCM_TAG_LENGTH);
+
+	nonce = g_malloc0 (GCM_NONCE_LENGTH);
+	gcry_create_nonce (nonce, GCM_NONCE_LENGTH);
+
+	g_mutex_lock (&session->mutex);
+
+	/* No padding needed, the tag goes right after the ciphertext */
+	gcry = gcry_cipher_setiv (session->cipher, nonce, GCM_NONCE_LENGTH);
+	if (gcry == 0)
+		gcry = gcry_cipher_encrypt (session->cipher, sealed, n_secret, secret, n_secret);
+	if (gcry == 0)
+		gcry = gcry_cipher_gettag (session->cipher, sealed + n_secret, GCM_TAG_LENGTH);
+
+	g_mutex_unlock (&session->mutex);
+
+	if (gcry != 0) {
+		egg_secure_clear (sealed, n_secret + GCM_TAG_LENGTH);
+		egg_secure_free (sealed);
+		g_free (nonce);
+		g_return_val_if_reached (FALSE);
+	}
+
+	child = g_variant_new_from_data (G_VARIANT_TYPE ("ay"), nonce, GCM_NONCE_LENGTH,
+	                                 TRUE, g_free, nonce);
+	g_variant_builder_add_value (builder, child);
+
+	child = g_variant_new_from_data (G_VARIANT_TYPE ("ay"), sealed, n_secret + GCM_TAG_LENGTH,
+	                                 TRUE, egg_secure_free, sealed);
+	g_variant_builder_add_value (builder, child);
+
+	g_variant_builder_add (builder, "s", secret_value_get_content_type (value));
+	return TRUE;
+}
+
+#endif /* WITH_X25519 */
+
 #endif /* WITH_GCRYPT */
 
 static gboolean
@@ -634,6 +1217,11 @@ _secret_session_encode_secret (SecretSession *session,
 	type = g_variant_type_new ("(oayays)");
 	builder = g_variant_builder_new (type);
 
+#ifdef WITH_X25519
+	if (session->key && session->aead)
+		ret = service_encode_gcm_secret (session, value, builder);
+	else
+#endif
 #ifdef WITH_GCRYPT
 	if (session->key)
 		ret = service_encode_aes_secret (session, value, builder);
@@ -31,9 +31,11 @@ typedef enum {
 
 typedef struct _SecretCollection  SecretCollection;
 typedef struct _SecretItem        SecretItem;
+typedef struct _SecretItemHandle  SecretItemHandle;
 typedef struct _SecretPrompt      SecretPrompt;
 typedef struct _SecretService     SecretService;
 typedef struct _SecretValue       SecretValue;
+typedef struct _SecretValueArray  SecretValueArray;
 
 #define SECRET_COLLECTION_DEFAULT "/org/freedesktop/secrets/aliases/default"
 
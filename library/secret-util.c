@@ -154,15 +154,13 @@ GHashTable *
 _secret_util_attributes_for_varargs (const SecretSchema *schema,
                                      va_list args)
 {
+	const SecretSchemaAttribute *attribute;
 	const gchar *attribute_name;
-	SecretSchemaAttributeType type;
 	GHashTable *attributes;
 	const gchar *string;
-	gboolean type_found;
 	gchar *value = NULL;
 	gboolean boolean;
 	gint integer;
-	gint i;
 
 	attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
@@ -171,24 +169,14 @@ _secret_util_attributes_for_varargs (const SecretSchema *schema,
 		if (attribute_name == NULL)
 			break;
 
-		type_found = FALSE;
-		for (i = 0; i < G_N_ELEMENTS (schema->attributes); ++i) {
-			if (!schema->attributes[i].name)
-				break;
-			if (g_str_equal (schema->attributes[i].name, attribute_name)) {
-				type_found = TRUE;
-				type = schema->attributes[i].type;
-				break;
-			}
-		}
-
-		if (!type_found) {
+		attribute = _secret_schema_find_attribute (schema, attribute_name);
+		if (attribute == NULL) {
 			g_warning ("The attribute '%s' was not found in the password schema.", attribute_name);
 			g_hash_table_unref (attributes);
 			return NULL;
 		}
 
-		switch (type) {
+		switch (attribute->type) {
 		case SECRET_SCHEMA_ATTRIBUTE_BOOLEAN:
 			boolean = va_arg (args, gboolean);
 			value = g_strdup (boolean ? "true" : "false");
@@ -218,6 +206,63 @@ _secret_util_attributes_for_varargs (const SecretSchema *schema,
 	return attributes;
 }
 
+/*
+ * Like _secret_util_attributes_for_varargs() but validates the attributes
+ * against the schema, and writes them directly into an a{ss} variant in a
+ * single pass, without a hash table or any intermediate copies.
+ */
+GVariant *
+_secret_util_variant_for_varargs (const SecretSchema *schema,
+                                  va_list args)
+{
+	const SecretSchemaAttribute *attribute;
+	const gchar *attribute_name;
+	GVariantBuilder builder;
+	const gchar *value;
+	gchar buffer[16];
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
+
+	for (;;) {
+		attribute_name = va_arg (args, const gchar *);
+		if (attribute_name == NULL)
+			break;
+
+		attribute = _secret_schema_find_attribute (schema, attribute_name);
+		if (attribute == NULL) {
+			g_warning ("The attribute '%s' was not found in the password schema.", attribute_name);
+			g_variant_builder_clear (&builder);
+			return NULL;
+		}
+
+		switch (attribute->type) {
+		case SECRET_SCHEMA_ATTRIBUTE_BOOLEAN:
+			value = va_arg (args, gboolean) ? "true" : "false";
+			break;
+		case SECRET_SCHEMA_ATTRIBUTE_STRING:
+			value = va_arg (args, gchar *);
+			if (!g_utf8_validate (value, -1, NULL)) {
+				g_warning ("The value for attribute '%s' was not a valid utf-8 string.", attribute_name);
+				g_variant_builder_clear (&builder);
+				return NULL;
+			}
+			break;
+		case SECRET_SCHEMA_ATTRIBUTE_INTEGER:
+			g_snprintf (buffer, sizeof (buffer), "%d", va_arg (args, gint));
+			value = buffer;
+			break;
+		default:
+			g_warning ("The password attribute '%s' has an invalid type in the password schema.", attribute_name);
+			g_variant_builder_clear (&builder);
+			return NULL;
+		}
+
+		g_variant_builder_add (&builder, "{ss}", attribute_name, value);
+	}
+
+	return g_variant_builder_end (&builder);
+}
+
 gboolean
 _secret_util_attributes_validate (const SecretSchema *schema,
                                   GHashTable *attributes)
@@ -227,7 +272,6 @@ _secret_util_attributes_validate (const SecretSchema *schema,
 	gchar *key;
 	gchar *value;
 	gchar *end;
-	gint i;
 
 	/* If no schema, then assume attributes are valid */
 	if (schema == NULL)
@@ -236,17 +280,7 @@ _secret_util_attributes_validate (const SecretSchema *schema,
 	g_hash_table_iter_init (&iter, attributes);
 	while (g_hash_table_iter_next (&iter, (gpointer *)&key, (gpointer *)&value)) {
 
-		/* Find the attribute */
-		attribute = NULL;
-		for (i = 0; i < G_N_ELEMENTS (schema->attributes); i++) {
-			if (schema->attributes[i].name == NULL)
-				break;
-			if (g_str_equal (schema->attributes[i].name, key)) {
-				attribute = &schema->attributes[i];
-				break;
-			}
-		}
-
+		attribute = _secret_schema_find_attribute (schema, key);
 		if (attribute == NULL) {
 			if (!(schema->flags & SECRET_SCHEMA_ALLOW_UNDEFINED)) {
 				g_warning ("invalid %s attribute in for %s schema",
@@ -312,6 +346,42 @@ _secret_util_attributes_copy (GHashTable *attributes)
 	return copy;
 }
 
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+	return strcmp (a, b);
+}
+
+gchar *
+_secret_util_attributes_canonical_key (const gchar *schema_name,
+                                       GHashTable *attributes)
+{
+	GString *key;
+	GList *names, *l;
+	const gchar *value;
+
+	g_return_val_if_fail (attributes != NULL, NULL);
+
+	key = g_string_new (NULL);
+
+	/* Length prefixed, so that no choice of values can collide */
+	if (schema_name != NULL)
+		g_string_append_printf (key, "%u:%s", (guint)strlen (schema_name), schema_name);
+	g_string_append_c (key, ';');
+
+	names = g_list_sort (g_hash_table_get_keys (attributes), compare_strings);
+	for (l = names; l != NULL; l = g_list_next (l)) {
+		value = g_hash_table_lookup (attributes, l->data);
+		g_string_append_printf (key, "%u:%s%u:%s",
+		                        (guint)strlen (l->data), (gchar *)l->data,
+		                        (guint)strlen (value), value);
+	}
+	g_list_free (names);
+
+	return g_string_free (key, FALSE);
+}
+
 static void
 process_get_all_reply (GDBusProxy *proxy,
                        GVariant *retval)
@@ -558,15 +628,61 @@ _secret_util_have_cached_properties (GDBusProxy *proxy)
 	return names != NULL;
 }
 
+gboolean
+_secret_util_is_session_error (GError *error)
+{
+	gchar *name;
+	gboolean ret;
+
+	if (error == NULL || !g_dbus_error_is_remote_error (error))
+		return FALSE;
+
+	name = g_dbus_error_get_remote_error (error);
+	ret = g_strcmp0 (name, "org.freedesktop.Secret.Error.NoSession") == 0;
+	g_free (name);
+
+	return ret;
+}
+
+static void
+sync_destroy (gpointer data)
+{
+	SecretSync *sync = data;
+
+	g_clear_object (&sync->result);
+	g_main_loop_unref (sync->loop);
+	g_main_context_unref (sync->context);
+	g_free (sync);
+}
+
+/*
+ * Each thread keeps one idle SecretSync around, so that a thread doing
+ * lots of blocking calls doesn't create and destroy a main context (and
+ * its wakeup fd) every time. While a sync call is running the cached
+ * one is taken out of the slot, so a nested sync call on the same thread
+ * gets a fresh context of its own.
+ */
+static GPrivate sync_cache = G_PRIVATE_INIT (sync_destroy);
+
+/* The sync calls running on this thread, innermost first */
+static GPrivate sync_running = G_PRIVATE_INIT (NULL);
+
 SecretSync *
 _secret_sync_new (void)
 {
 	SecretSync *sync;
 
-	sync = g_new0 (SecretSync, 1);
+	sync = g_private_get (&sync_cache);
+	if (sync != NULL) {
+		g_private_set (&sync_cache, NULL);
+	} else {
+		sync = g_new0 (SecretSync, 1);
+		sync->context = g_main_context_new ();
+		sync->loop = g_main_loop_new (sync->context, FALSE);
+	}
 
-	sync->context = g_main_context_new ();
-	sync->loop = g_main_loop_new (sync->context, FALSE);
+	sync->outer = g_private_get (&sync_running);
+	g_private_set (&sync_running, sync);
 
 	return sync;
 }
@@ -575,10 +691,95 @@ void
 _secret_sync_free (gpointer data)
 {
 	SecretSync *sync = data;
+	SecretSync *inner;
+
+	/* Others are waiting on something this call started in its context */
+	while (sync->holds > 0)
+		g_main_context_iteration (sync->context, TRUE);
 
 	g_clear_object (&sync->result);
-	g_main_loop_unref (sync->loop);
-	g_main_context_unref (sync->context);
+
+	/* Normally the innermost call, unless calls were interleaved */
+	inner = g_private_get (&sync_running);
+	if (inner == sync) {
+		g_private_set (&sync_running, sync->outer);
+	} else {
+		while (inner != NULL && inner->outer != sync)
+			inner = inner->outer;
+		if (inner != NULL)
+			inner->outer = sync->outer;
+	}
+	sync->outer = NULL;
+
+	/*
+	 * Keep it around for the next call, unless a nested call already did.
+	 * Anything still pending or subscribed in the context was left behind
+	 * by this call, and must not run in the middle of some unrelated later
+	 * call, so such a context is left to whoever still holds it.
+	 */
+	if (!sync->retained && g_private_get (&sync_cache) == NULL &&
+	    !g_main_context_pending (sync->context))
+		g_private_set (&sync_cache, sync);
+	else
+		sync_destroy (sync);
+}
+
+/*
+ * Called when something that outlives the current call, such as a proxy
+ * or a signal subscription, is bound to the thread default main context.
+ * If that context belongs to a running sync call, it won't be reused.
+ */
+void
+_secret_sync_retain_context (void)
+{
+	GMainContext *context;
+	SecretSync *sync;
+
+	context = g_main_context_get_thread_default ();
+	if (context == NULL)
+		return;
+
+	for (sync = g_private_get (&sync_running); sync != NULL; sync = sync->outer) {
+		if (sync->context == context)
+			sync->retained = TRUE;
+	}
+}
+
+/*
+ * Called when starting something in the thread default main context that
+ * other callers will wait on. If that context belongs to a running sync
+ * call, the call keeps running the context until _secret_sync_release(),
+ * even if the call itself completes or is cancelled before then.
+ */
+SecretSync *
+_secret_sync_hold (void)
+{
+	GMainContext *context;
+	SecretSync *sync;
+
+	context = g_main_context_get_thread_default ();
+	if (context == NULL)
+		return NULL;
+
+	for (sync = g_private_get (&sync_running); sync != NULL; sync = sync->outer) {
+		if (sync->context == context) {
+			sync->holds++;
+			return sync;
+		}
+	}
+
+	return NULL;
+}
+
+/* Called in the held context, by the thread running the sync call */
+void
+_secret_sync_release (SecretSync *sync)
+{
+	if (sync == NULL)
+		return;
+
+	g_assert (sync->holds > 0);
+	sync->holds--;
 }
 
 void
@@ -591,3 +792,101 @@ _secret_sync_on_result (GObject *source,
 	sync->result = g_object_ref (result);
 	g_main_loop_quit (sync->loop);
 }
+
+/*
+ * A SecretWaiter is a caller queued up behind an operation that is shared
+ * with other callers, such as opening the session. The shared operation
+ * isn't cancelled on behalf of any one caller, but each waiter completes
+ * with G_IO_ERROR_CANCELLED as soon as its own cancellable is cancelled.
+ * Whoever owns the queue calls _secret_waiter_claim() once the shared
+ * operation is done, and completes the waiter if it gets its result.
+ */
+struct _SecretWaiter {
+	gint refs;
+	gint claimed;
+	GSimpleAsyncResult *res;
+	GCancellable *cancellable;
+	GSource *source;
+};
+
+static void
+waiter_unref (gpointer data)
+{
+	SecretWaiter *waiter = data;
+
+	if (!g_atomic_int_dec_and_test (&waiter->refs))
+		return;
+
+	g_object_unref (waiter->res);
+	g_clear_object (&waiter->cancellable);
+	if (waiter->source)
+		g_source_unref (waiter->source);
+	g_slice_free (SecretWaiter, waiter);
+}
+
+static gboolean
+on_waiter_cancelled (GCancellable *cancellable,
+                     gpointer user_data)
+{
+	SecretWaiter *waiter = user_data;
+	GError *error = NULL;
+
+	/* Runs in the main context that the waiter completes in */
+	if (g_atomic_int_compare_and_exchange (&waiter->claimed, 0, 1)) {
+		g_cancellable_set_error_if_cancelled (cancellable, &error);
+		g_simple_async_result_take_error (waiter->res, error);
+		g_simple_async_result_complete (waiter->res);
+	}
+
+	return FALSE;
+}
+
+SecretWaiter *
+_secret_waiter_new (GSimpleAsyncResult *res,
+                    GCancellable *cancellable)
+{
+	SecretWaiter *waiter;
+
+	waiter = g_slice_new0 (SecretWaiter);
+	waiter->refs = 1;
+	waiter->res = g_object_ref (res);
+
+	if (cancellable != NULL) {
+		waiter->cancellable = g_object_ref (cancellable);
+		waiter->source = g_cancellable_source_new (cancellable);
+		g_atomic_int_inc (&waiter->refs);
+		g_source_set_callback (waiter->source, (GSourceFunc)on_waiter_cancelled,
+		                       waiter, waiter_unref);
+		g_source_attach (waiter->source, g_main_context_get_thread_default ());
+	}
+
+	return waiter;
+}
+
+/*
+ * Returns the result to complete, or NULL if the waiter was already
+ * completed because it was cancelled. May be called from any thread.
+ */
+GSimpleAsyncResult *
+_secret_waiter_claim (SecretWaiter *waiter)
+{
+	g_return_val_if_fail (waiter != NULL, NULL);
+
+	if (waiter->source)
+		g_source_destroy (waiter->source);
+
+	if (!g_atomic_int_compare_and_exchange (&waiter->claimed, 0, 1))
+		return NULL;
+
+	return waiter->res;
+}
+
+void
+_secret_waiter_free (gpointer data)
+{
+	SecretWaiter *waiter = data;
+
+	if (waiter->source)
+		g_source_destroy (waiter->source);
+	waiter_unref (waiter);
+}
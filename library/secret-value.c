@@ -51,6 +51,32 @@ struct _SecretValue {
 	gsize length;
 	GDestroyNotify destroy;
 	gchar *content_type;
+	SecretValueArena *arena;
+	gboolean interned;
+};
+
+/*
+ * A block of secure memory shared by all the values decoded from one
+ * batch reply. Each value points into the block, and the block is freed
+ * when the last such value goes away.
+ */
+struct _SecretValueArena {
+	gint refs;
+	gsize length;
+	gsize used;
+};
+
+typedef struct {
+	const gchar *path;
+	SecretValue *value;
+} SecretValueArrayEntry;
+
+struct _SecretValueArray {
+	gint refs;
+	GVariant *reply;
+	guint length;
+	guint allocated;
+	SecretValueArrayEntry entries[1];
 };
 
 GType
@@ -195,6 +221,18 @@ secret_value_ref (SecretValue *value)
 	return value;
 }
 
+static void
+value_release (SecretValue *val)
+{
+	if (val->arena) {
+		egg_secure_clear (val->secret, val->length);
+		_secret_value_arena_unref (val->arena);
+	}
+	if (!val->interned)
+		g_free (val->content_type);
+	g_slice_free (SecretValue, val);
+}
+
 /**
  * secret_value_unref:
  * @value: (type Secret.Value) (allow-none): value to unreference
@@ -210,10 +248,9 @@ secret_value_unref (gpointer value)
 	g_return_if_fail (value != NULL);
 
 	if (g_atomic_int_dec_and_test (&val->refs)) {
-		g_free (val->content_type);
 		if (val->destroy)
 			(val->destroy) (val->secret);
-		g_slice_free (SecretValue, val);
+		value_release (val);
 	}
 }
 
@@ -239,8 +276,7 @@ _secret_value_unref_to_password (SecretValue *value)
 			if (val->destroy)
 				(val->destroy) (val->secret);
 		}
-		g_free (val->content_type);
-		g_slice_free (SecretValue, val);
+		value_release (val);
 
 	} else {
 		result = egg_secure_strdup (val->secret);
@@ -271,8 +307,7 @@ _secret_value_unref_to_string (SecretValue *value)
 			if (val->destroy)
 				(val->destroy) (val->secret);
 		}
-		g_free (val->content_type);
-		g_slice_free (SecretValue, val);
+		value_release (val);
 
 	} else {
 		result = g_strdup (val->secret);
@@ -280,3 +315,215 @@ _secret_value_unref_to_string (SecretValue *value)
 
 	return result;
 }
+
+SecretValueArena *
+_secret_value_arena_new (gsize length)
+{
+	SecretValueArena *arena;
+
+	arena = egg_secure_alloc (sizeof (SecretValueArena) + length);
+	arena->refs = 1;
+	arena->length = length;
+	arena->used = 0;
+
+	return arena;
+}
+
+gchar *
+_secret_value_arena_alloc (SecretValueArena *arena,
+                           gsize length)
+{
+	gchar *block;
+
+	g_return_val_if_fail (arena != NULL, NULL);
+	g_return_val_if_fail (arena->length - arena->used >= length, NULL);
+
+	block = (gchar *)(arena + 1) + arena->used;
+	arena->used += length;
+	return block;
+}
+
+void
+_secret_value_arena_unref (SecretValueArena *arena)
+{
+	if (g_atomic_int_dec_and_test (&arena->refs)) {
+		egg_secure_clear (arena, sizeof (SecretValueArena) + arena->length);
+		egg_secure_free (arena);
+	}
+}
+
+/*
+ * Create a value whose secret lives in @arena. The @content_type must be
+ * an interned string, and is not copied.
+ */
+SecretValue *
+_secret_value_new_in_arena (SecretValueArena *arena,
+                            gchar *secret,
+                            gsize length,
+                            const gchar *content_type)
+{
+	SecretValue *value;
+
+	g_return_val_if_fail (arena != NULL, NULL);
+	g_return_val_if_fail (content_type != NULL, NULL);
+
+	value = g_slice_new0 (SecretValue);
+	value->refs = 1;
+	value->content_type = (gchar *)content_type;
+	value->interned = TRUE;
+	value->length = length;
+	value->secret = secret;
+	value->arena = arena;
+	g_atomic_int_inc (&arena->refs);
+
+	return value;
+}
+
+/**
+ * SecretValueArray:
+ *
+ * An array of secret values, along with the D-Bus paths of the items
+ * they belong to. Returned when retrieving many secrets at once.
+ */
+
+GType
+secret_value_array_get_type (void)
+{
+	static gsize initialized = 0;
+	static GType type = 0;
+
+	if (g_once_init_enter (&initialized)) {
+		type = g_boxed_type_register_static ("SecretValueArray",
+		                                     (GBoxedCopyFunc)secret_value_array_ref,
+		                                     (GBoxedFreeFunc)secret_value_array_unref);
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return type;
+}
+
+/*
+ * Create an array with room for @n_values values. The item paths added
+ * to it are borrowed from @reply, which the array keeps alive.
+ */
+SecretValueArray *
+_secret_value_array_new (GVariant *reply,
+                         guint n_values)
+{
+	SecretValueArray *array;
+
+	array = g_malloc (sizeof (SecretValueArray) +
+	                  sizeof (SecretValueArrayEntry) * MAX (n_values, 1));
+	array->refs = 1;
+	array->reply = reply ? g_variant_ref (reply) : NULL;
+	array->length = 0;
+	array->allocated = n_values;
+
+	return array;
+}
+
+void
+_secret_value_array_take (SecretValueArray *array,
+                          const gchar *path,
+                          SecretValue *value)
+{
+	g_return_if_fail (array != NULL);
+	g_return_if_fail (array->length < array->allocated);
+
+	array->entries[array->length].path = path;
+	array->entries[array->length].value = value;
+	array->length++;
+}
+
+/**
+ * secret_value_array_ref:
+ * @array: the array
+ *
+ * Add another reference to the #SecretValueArray.
+ *
+ * Returns: (transfer full): the array
+ */
+SecretValueArray *
+secret_value_array_ref (SecretValueArray *array)
+{
+	g_return_val_if_fail (array != NULL, NULL);
+	g_atomic_int_inc (&array->refs);
+	return array;
+}
+
+/**
+ * secret_value_array_unref:
+ * @array: (type Secret.ValueArray) (allow-none): the array
+ *
+ * Unreference a #SecretValueArray. When the last reference is gone, the
+ * array and its references to the values are released.
+ */
+void
+secret_value_array_unref (gpointer array)
+{
+	SecretValueArray *arr = array;
+	guint i;
+
+	g_return_if_fail (array != NULL);
+
+	if (g_atomic_int_dec_and_test (&arr->refs)) {
+		for (i = 0; i < arr->length; i++)
+			secret_value_unref (arr->entries[i].value);
+		if (arr->reply)
+			g_variant_unref (arr->reply);
+		g_free (arr);
+	}
+}
+
+/**
+ * secret_value_array_get_length:
+ * @array: the array
+ *
+ * Get the number of secret values in the array.
+ *
+ * Returns: the number of values
+ */
+guint
+secret_value_array_get_length (SecretValueArray *array)
+{
+	g_return_val_if_fail (array != NULL, 0);
+	return array->length;
+}
+
+/**
+ * secret_value_array_get_path:
+ * @array: the array
+ * @index_: the index of the value
+ *
+ * Get the D-Bus object path of the item that the value at @index_
+ * belongs to.
+ *
+ * Returns: the item path, owned by the array
+ */
+const gchar *
+secret_value_array_get_path (SecretValueArray *array,
+                             guint index_)
+{
+	g_return_val_if_fail (array != NULL, NULL);
+	g_return_val_if_fail (index_ < array->length, NULL);
+	return array->entries[index_].path;
+}
+
+/**
+ * secret_value_array_get_value:
+ * @array: the array
+ * @index_: the index of the value
+ *
+ * Get the secret value at @index_. Use secret_value_ref() to hold onto
+ * it beyond the lifetime of the array.
+ *
+ * Returns: (transfer none): the secret value
+ */
+SecretValue *
+secret_value_array_get_value (SecretValueArray *array,
+                              guint index_)
+{
+	g_return_val_if_fail (array != NULL, NULL);
+	g_return_val_if_fail (index_ < array->length, NULL);
+	return array->entries[index_].value;
+}
@@ -45,6 +45,22 @@ SecretValue *       secret_value_ref               (SecretValue *value);
 
 void                secret_value_unref             (gpointer value);
 
+#define             SECRET_TYPE_VALUE_ARRAY        (secret_value_array_get_type ())
+
+GType               secret_value_array_get_type    (void) G_GNUC_CONST;
+
+SecretValueArray *  secret_value_array_ref         (SecretValueArray *array);
+
+void                secret_value_array_unref       (gpointer array);
+
+guint               secret_value_array_get_length  (SecretValueArray *array);
+
+const gchar *       secret_value_array_get_path    (SecretValueArray *array,
+                                                    guint index_);
+
+SecretValue *       secret_value_array_get_value   (SecretValueArray *array,
+                                                    guint index_);
+
 G_END_DECLS
 
 #endif /* __SECRET_VALUE_H___ */
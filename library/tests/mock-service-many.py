@@ -0,0 +1,13 @@
+#!/usr/bin/env python
+
+import mock
+
+service = mock.SecretService()
+service.add_standard_objects()
+
+collection = mock.SecretCollection(service, "many", label="Many Items", locked=False)
+for i in range(0, 20000):
+	mock.SecretItem(collection, str(i), label="Item %d" % i,
+	                attributes={ "number": str(i) }, secret=str(i))
+
+service.listen()
@@ -0,0 +1,11 @@
+#!/usr/bin/env python
+
+import mock
+
+service = mock.SecretService()
+service.add_standard_objects()
+service.algorithms = {
+	"plain": mock.PlainAlgorithm(),
+	"dh-ietf1024-sha256-aes128-cbc-pkcs7": mock.AesAlgorithm()
+}
+service.listen()
@@ -0,0 +1,86 @@
+
+# WARNING: This is for use in mock objects during testing, and NOT
+# cryptographically secure or performant.
+
+#
+# Copyright 2012 Red Hat Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published
+# by the Free Software Foundation; either version 2 of the licence or (at
+# your option) any later version.
+#
+# See the included COPYING file for more information.
+#
+
+#
+# AES-GCM from NIST SP 800-38D, with a 96-bit nonce, a 128-bit tag
+# and no additional authenticated data.
+#
+
+import struct
+
+import aes
+
+TAG_LENGTH = 16
+
+class InvalidTag(Exception):
+	pass
+
+def block_to_number(block):
+	return int(block.encode('hex'), 16)
+
+def number_to_block(number):
+	return ("%032x" % number).decode('hex')
+
+def encrypt_block(key, block):
+	cipher = aes.AES()
+	return "".join(map(chr, cipher.encrypt(map(ord, block), key, len(key))))
+
+def xor(one, two):
+	return "".join([chr(ord(a) ^ ord(b)) for (a, b) in zip(one, two)])
+
+def gf_multiply(x, y):
+	z = 0
+	for i in range(127, -1, -1):
+		if (y >> i) & 1:
+			z ^= x
+		if x & 1:
+			x = (x >> 1) ^ (0xE1 << 120)
+		else:
+			x >>= 1
+	return z
+
+def ghash(h, data):
+	y = 0
+	padded = data + '\x00' * (-len(data) % 16)
+	for i in range(0, len(padded), 16):
+		y = gf_multiply(y ^ block_to_number(padded[i:i + 16]), h)
+	lengths = struct.pack(">QQ", 0, len(data) * 8)
+	return gf_multiply(y ^ block_to_number(lengths), h)
+
+def counter_mode(key, nonce, data):
+	result = []
+	for i in range(0, len(data), 16):
+		counter = nonce + struct.pack(">I", (i / 16) + 2)
+		result.append(xor(data[i:i + 16], encrypt_block(key, counter)))
+	return "".join(result)
+
+def compute_tag(key, nonce, ciphertext):
+	h = block_to_number(encrypt_block(key, '\x00' * 16))
+	mask = encrypt_block(key, nonce + struct.pack(">I", 1))
+	return xor(number_to_block(ghash(h, ciphertext)), mask)
+
+def encrypt(key, nonce, plaintext):
+	key = map(ord, key)
+	ciphertext = counter_mode(key, nonce, plaintext)
+	return ciphertext + compute_tag(key, nonce, ciphertext)
+
+def decrypt(key, nonce, data):
+	if len(nonce) != 12 or len(data) < TAG_LENGTH:
+		raise InvalidTag()
+	key = map(ord, key)
+	ciphertext = data[:-TAG_LENGTH]
+	if compute_tag(key, nonce, ciphertext) != data[-TAG_LENGTH:]:
+		raise InvalidTag()
+	return counter_mode(key, nonce, ciphertext)
@@ -19,7 +19,9 @@ import unittest
 
 import aes
 import dh
+import gcm
 import hkdf
+import x25519
 
 import dbus
 import dbus.service
@@ -48,6 +50,10 @@ class NoSuchObject(dbus.exceptions.DBusException):
 	def __init__(self, msg):
 		dbus.exceptions.DBusException.__init__(self, msg, name="org.freedesktop.Secret.Error.NoSuchObject")
 
+class NoSession(dbus.exceptions.DBusException):
+	def __init__(self, msg):
+		dbus.exceptions.DBusException.__init__(self, msg, name="org.freedesktop.Secret.Error.NoSession")
+
 
 unique_identifier = 111
 def next_identifier(prefix=''):
@@ -159,6 +165,29 @@ class SecretPrompt(dbus.service.Object):
 		pass
 
 
+class X25519Algorithm():
+	def negotiate(self, service, sender, param):
+		if type (param) != dbus.ByteArray or len(param) != 32:
+			raise InvalidArgs("invalid argument passed to OpenSession")
+		privat, publi = x25519.generate_pair()
+		ikm = x25519.derive_key(privat, str(param))
+		if ikm == '\x00' * 32:
+			raise InvalidArgs("invalid public key passed to OpenSession")
+		key = hkdf.hkdf(ikm, 16)
+		session = SecretSession(service, sender, self, key)
+		return (dbus.ByteArray(publi, variant_level=1), session)
+
+	def encrypt(self, key, data):
+		nonce = os.urandom(12)
+		return (nonce, gcm.encrypt(key, nonce, data))
+
+	def decrypt(self, key, param, data):
+		try:
+			return gcm.decrypt(key, str(param), str(data))
+		except gcm.InvalidTag:
+			raise InvalidArgs("invalid encrypted secret")
+
+
 class SecretSession(dbus.service.Object):
 	def __init__(self, service, sender, algorithm, key):
 		self.sender = sender
@@ -186,6 +215,7 @@ class SecretSession(dbus.service.Object):
 	def Close(self):
 		self.remove_from_connection()
 		self.service.remove_session(self)
+		del objects[self.path]
 
 
 class SecretItem(dbus.service.Object):
@@ -241,7 +271,7 @@ class SecretItem(dbus.service.Object):
 	def GetSecret(self, session_path, sender=None):
 		session = objects.get(session_path, None)
 		if not session or session.sender != sender:
-			raise InvalidArgs("session invalid: %s" % session_path)
+			raise NoSession("session invalid: %s" % session_path)
 		if self.get_locked():
 			raise IsLocked("secret is locked: %s" % self.path)
 		return session.encode_secret(self.secret, self.content_type)
@@ -250,10 +280,11 @@ class SecretItem(dbus.service.Object):
 	def SetSecret(self, secret, sender=None):
 		session = objects.get(secret[0], None)
 		if not session or session.sender != sender:
-			raise InvalidArgs("session invalid: %s" % secret[0])
+			raise NoSession("session invalid: %s" % secret[0])
 		if self.get_locked():
 			raise IsLocked("secret is locked: %s" % self.path)
 		(self.secret, self.content_type) = session.decode_secret(secret)
+		self.collection.ItemChanged(dbus.ObjectPath(self.path))
 
 	@dbus.service.method('org.freedesktop.Secret.Item', sender_keyword='sender')
 	def Delete(self, sender=None):
@@ -300,6 +331,7 @@ class SecretItem(dbus.service.Object):
 		else:
 			raise InvalidArgs('Not writable %s property' % property_name)
 		self.PropertiesChanged(interface_name, { property_name: new_value }, [])
+		self.collection.ItemChanged(dbus.ObjectPath(self.path))
 
 	@dbus.service.signal(dbus.PROPERTIES_IFACE, signature='sa{sv}as')
 	def PropertiesChanged(self, interface_name, changed_properties, invalidated_properties):
@@ -332,11 +364,13 @@ class SecretCollection(dbus.service.Object):
 		self.items[item.path] = item
 		for alias in self.aliased:
 			item.add_alias(alias)
+		self.ItemCreated(dbus.ObjectPath(item.path))
 
 	def remove_item(self, item):
 		for alias in self.aliased:
 			item.remove_alias(alias)
 		del self.items[item.path]
+		self.ItemDeleted(dbus.ObjectPath(item.path))
 
 	def add_alias(self, name):
 		if name in self.aliased:
@@ -388,7 +422,7 @@ class SecretCollection(dbus.service.Object):
 		session_path = value[0]
 		session = objects.get(session_path, None)
 		if not session or session.sender != sender:
-			raise InvalidArgs("session invalid: %s" % session_path)
+			raise NoSession("session invalid: %s" % session_path)
 
 		attributes = properties.get("org.freedesktop.Secret.Item.Attributes", None)
 		label = properties.get("org.freedesktop.Secret.Item.Label", None)
@@ -409,6 +443,7 @@ class SecretCollection(dbus.service.Object):
 			item.secret = secret
 			item.attributes = attributes
 			item.content_type = content_type
+			self.ItemChanged(dbus.ObjectPath(item.path))
 		return (dbus.ObjectPath(item.path), dbus.ObjectPath("/"))
 
 	@dbus.service.method('org.freedesktop.Secret.Collection', sender_keyword='sender')
@@ -456,12 +491,25 @@ class SecretCollection(dbus.service.Object):
 	def PropertiesChanged(self, interface_name, changed_properties, invalidated_properties):
 		self.modified = time.time()
 
+	@dbus.service.signal('org.freedesktop.Secret.Collection', signature='o')
+	def ItemCreated(self, item_path):
+		self.modified = time.time()
+
+	@dbus.service.signal('org.freedesktop.Secret.Collection', signature='o')
+	def ItemDeleted(self, item_path):
+		self.modified = time.time()
+
+	@dbus.service.signal('org.freedesktop.Secret.Collection', signature='o')
+	def ItemChanged(self, item_path):
+		self.modified = time.time()
+
 
 class SecretService(dbus.service.Object):
 
 	algorithms = {
 		'plain': PlainAlgorithm(),
 		"dh-ietf1024-sha256-aes128-cbc-pkcs7": AesAlgorithm(),
+		"ecdh-x25519-sha256-aes128-gcm": X25519Algorithm(),
 	}
 
 	def __init__(self, name=None):
@@ -522,11 +570,13 @@ class SecretService(dbus.service.Object):
 
 	def add_collection(self, collection):
 		self.collections[collection.path] = collection
+		self.CollectionCreated(dbus.ObjectPath(collection.path))
 
 	def remove_collection(self, collection):
 		for alias in list(collection.aliased):
 			self.remove_alias(alias)
 		del self.collections[collection.path]
+		self.CollectionDeleted(dbus.ObjectPath(collection.path))
 
 	def set_alias(self, name, collection):
 		self.remove_alias(name)
@@ -619,7 +669,7 @@ class SecretService(dbus.service.Object):
 	def GetSecrets(self, item_paths, session_path, sender=None):
 		session = objects.get(session_path, None)
 		if not session or session.sender != sender:
-			raise InvalidArgs("session invalid: %s" % session_path)
+			raise NoSession("session invalid: %s" % session_path)
 		results = dbus.Dictionary(signature="o(oayays)")
 		for item_path in item_paths:
 			item = objects.get(item_path, None)
@@ -627,6 +677,13 @@ class SecretService(dbus.service.Object):
 				results[item_path] = item.GetSecret(session_path, sender)
 		return results
 
+	@dbus.service.method('org.gnome.libsecret.Extensions', in_signature='a{ss}o',
+	                     out_signature='a{o(oayays)}ao', sender_keyword='sender')
+	def SearchItemsWithSecrets(self, attributes, session_path, sender=None):
+		(unlocked, locked) = self.SearchItems(attributes)
+		secrets = self.GetSecrets(unlocked, session_path, sender)
+		return (secrets, locked)
+
 	@dbus.service.method('org.freedesktop.Secret.Service')
 	def ReadAlias(self, name):
 		if name not in self.aliases:
@@ -658,6 +715,18 @@ class SecretService(dbus.service.Object):
 			raise InvalidArgs('Unknown %s interface' % interface_name)
 		raise InvalidArgs('Not a writable property %s' % property_name)
 
+	@dbus.service.signal('org.freedesktop.Secret.Service', signature='o')
+	def CollectionCreated(self, collection_path):
+		pass
+
+	@dbus.service.signal('org.freedesktop.Secret.Service', signature='o')
+	def CollectionDeleted(self, collection_path):
+		pass
+
+	@dbus.service.signal('org.freedesktop.Secret.Service', signature='o')
+	def CollectionChanged(self, collection_path):
+		pass
+
 
 def parse_options(args):
 	global bus_name, ready_pipe
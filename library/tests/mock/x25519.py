@@ -0,0 +1,82 @@
+
+# WARNING: This is for use in mock objects during testing, and NOT
+# cryptographically secure or performant.
+
+#
+# Copyright 2012 Red Hat Inc.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published
+# by the Free Software Foundation; either version 2 of the licence or (at
+# your option) any later version.
+#
+# See the included COPYING file for more information.
+#
+
+#
+# Straight from the Montgomery ladder in RFC 7748
+#
+
+import os
+
+P = 2 ** 255 - 19
+A24 = 121665
+BASE = '\x09' + '\x00' * 31
+
+def decode_scalar(data):
+	k = [ord(c) for c in data]
+	k[0] &= 248
+	k[31] &= 127
+	k[31] |= 64
+	return sum([k[i] << (8 * i) for i in range(32)])
+
+def decode_u(data):
+	u = [ord(c) for c in data]
+	u[31] &= 127
+	return sum([u[i] << (8 * i) for i in range(32)])
+
+def encode_u(number):
+	number = number % P
+	return "".join([chr((number >> (8 * i)) & 0xff) for i in range(32)])
+
+def x25519(scalar, point):
+	k = decode_scalar(scalar)
+	x1 = decode_u(point)
+	x2, z2 = 1, 0
+	x3, z3 = x1, 1
+	swap = 0
+
+	for t in range(254, -1, -1):
+		bit = (k >> t) & 1
+		swap ^= bit
+		if swap:
+			x2, x3 = x3, x2
+			z2, z3 = z3, z2
+		swap = bit
+
+		a = x2 + z2
+		aa = (a * a) % P
+		b = x2 - z2
+		bb = (b * b) % P
+		e = aa - bb
+		c = x3 + z3
+		d = x3 - z3
+		da = (d * a) % P
+		cb = (c * b) % P
+		x3 = ((da + cb) ** 2) % P
+		z3 = (x1 * (da - cb) ** 2) % P
+		x2 = (aa * bb) % P
+		z2 = (e * (aa + A24 * e)) % P
+
+	if swap:
+		x2, x3 = x3, x2
+		z2, z3 = z3, z2
+
+	return encode_u(x2 * pow(z2, P - 2, P))
+
+def generate_pair():
+	privat = os.urandom(32)
+	return (privat, x25519(privat, BASE))
+
+def derive_key(privat, peer):
+	return x25519(privat, peer)
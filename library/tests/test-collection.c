@@ -303,6 +303,70 @@ test_items (Test *test,
 	g_object_unref (collection);
 }
 
+static void
+test_items_async (Test *test,
+                  gconstpointer unused)
+{
+	const gchar *collection_path = "/org/freedesktop/secrets/collection/english";
+	const gchar *item_path = "/org/freedesktop/secrets/collection/english/1";
+	SecretCollection *collection;
+	GAsyncResult *result = NULL;
+	SecretItem *other;
+	SecretItem *item;
+	GError *error = NULL;
+	GList *items, *l;
+	gchar *label;
+
+	secret_collection_new (test->service, collection_path, NULL, on_async_result, &result);
+	g_assert (result == NULL);
+
+	egg_test_wait ();
+
+	collection = secret_collection_new_finish (result, &error);
+	g_assert_no_error (error);
+	g_object_unref (result);
+
+	items = secret_collection_get_items (collection);
+	check_items_equal (items,
+	                   "/org/freedesktop/secrets/collection/english/1",
+	                   "/org/freedesktop/secrets/collection/english/2",
+	                   "/org/freedesktop/secrets/collection/english/3",
+	                   NULL);
+
+	/* Items were loaded together, but should have their properties */
+	item = NULL;
+	for (l = items; l != NULL; l = g_list_next (l)) {
+		label = secret_item_get_label (l->data);
+		g_assert (label != NULL);
+		g_free (label);
+		if (g_str_equal (g_dbus_proxy_get_object_path (l->data), item_path))
+			item = l->data;
+	}
+
+	g_assert (item != NULL);
+	label = secret_item_get_label (item);
+	g_assert_cmpstr (label, ==, "Item One");
+	g_free (label);
+
+	/* And should hear about changes made elsewhere */
+	other = secret_item_new_sync (test->service, item_path, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (other != item);
+
+	secret_item_set_label_sync (other, "Another label", NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (other);
+
+	egg_test_wait_until (100);
+
+	label = secret_item_get_label (item);
+	g_assert_cmpstr (label, ==, "Another label");
+	g_free (label);
+
+	g_list_free_full (items, g_object_unref);
+	g_object_unref (collection);
+}
+
 static void
 test_items_empty (Test *test,
                   gconstpointer unused)
@@ -356,6 +420,234 @@ test_items_empty_async (Test *test,
 	g_object_unref (collection);
 }
 
+static gboolean
+collection_has_item (SecretCollection *collection,
+                     const gchar *item_path)
+{
+	SecretItem *item;
+
+	item = _secret_collection_find_item_instance (collection, item_path);
+	if (item == NULL)
+		return FALSE;
+	g_object_unref (item);
+	return TRUE;
+}
+
+static gboolean
+items_property_has_item (SecretCollection *collection,
+                         const gchar *item_path)
+{
+	GVariantIter iter;
+	gboolean ret = FALSE;
+	const gchar *path;
+	GVariant *paths;
+
+	paths = g_dbus_proxy_get_cached_property (G_DBUS_PROXY (collection), "Items");
+	g_assert (paths != NULL);
+
+	g_variant_iter_init (&iter, paths);
+	while (!ret && g_variant_iter_next (&iter, "&o", &path))
+		ret = g_str_equal (path, item_path);
+
+	g_variant_unref (paths);
+	return ret;
+}
+
+static void
+on_collection_notify (GObject *obj,
+                      GParamSpec *pspec,
+                      gpointer user_data)
+{
+	egg_test_wait_stop ();
+}
+
+static void
+on_collection_properties_changed (GDBusProxy *proxy,
+                                  GVariant *changed,
+                                  const gchar* const *invalidated,
+                                  gpointer user_data)
+{
+	egg_test_wait_stop ();
+}
+
+static void
+wait_for_item (SecretCollection *collection,
+               const gchar *item_path,
+               gboolean present)
+{
+	gboolean ret = TRUE;
+	gulong sig;
+
+	sig = g_signal_connect (collection, "notify::items",
+	                        G_CALLBACK (on_collection_notify), NULL);
+	while (ret && collection_has_item (collection, item_path) != present)
+		ret = egg_test_wait_until (5000);
+	g_signal_handler_disconnect (collection, sig);
+
+	g_assert (ret);
+}
+
+static void
+wait_for_items_property (SecretCollection *collection,
+                         const gchar *item_path,
+                         gboolean present)
+{
+	gboolean ret = TRUE;
+	gulong sig;
+
+	sig = g_signal_connect (collection, "g-properties-changed",
+	                        G_CALLBACK (on_collection_properties_changed), NULL);
+	while (ret && items_property_has_item (collection, item_path) != present)
+		ret = egg_test_wait_until (5000);
+	g_signal_handler_disconnect (collection, sig);
+
+	g_assert (ret);
+}
+
+static SecretItem *
+create_item_sync (SecretCollection *collection,
+                  const gchar *label)
+{
+	GHashTable *attributes;
+	SecretValue *value;
+	GError *error = NULL;
+	SecretItem *item;
+
+	attributes = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (attributes, "even", "true");
+	value = secret_value_new ("Hoohah", -1, "text/plain");
+
+	item = secret_item_create_sync (collection, "org.mock.Schema", label,
+	                                 attributes, value, FALSE, NULL, &error);
+	g_assert_no_error (error);
+
+	g_hash_table_unref (attributes);
+	secret_value_unref (value);
+	return item;
+}
+
+static void
+test_items_signals (Test *test,
+                    gconstpointer unused)
+{
+	const gchar *collection_path = "/org/freedesktop/secrets/collection/english";
+	SecretCollection *collection;
+	GError *error = NULL;
+	SecretItem *item;
+	gchar *item_path;
+	GList *items;
+
+	collection = secret_collection_new_sync (test->service, collection_path, NULL, &error);
+	g_assert_no_error (error);
+
+	item = create_item_sync (collection, "Signalled");
+	item_path = g_strdup (g_dbus_proxy_get_object_path (G_DBUS_PROXY (item)));
+
+	/* The ItemCreated signal adds it without reloading the whole list */
+	wait_for_item (collection, item_path, TRUE);
+
+	items = secret_collection_get_items (collection);
+	g_assert_cmpuint (g_list_length (items), ==, 4);
+	g_list_free_full (items, g_object_unref);
+
+	secret_item_delete_sync (item, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (item);
+
+	wait_for_item (collection, item_path, FALSE);
+
+	items = secret_collection_get_items (collection);
+	check_items_equal (items,
+	                   "/org/freedesktop/secrets/collection/english/1",
+	                   "/org/freedesktop/secrets/collection/english/2",
+	                   "/org/freedesktop/secrets/collection/english/3",
+	                   NULL);
+	g_list_free_full (items, g_object_unref);
+
+	g_free (item_path);
+	g_object_unref (collection);
+}
+
+static gdouble
+items_update_run (SecretCollection *collection,
+                  gint count,
+                  gboolean reload)
+{
+	GError *error = NULL;
+	SecretItem *item;
+	gchar *item_path;
+	gint i;
+
+	g_test_timer_start ();
+
+	for (i = 0; i < count; i++) {
+		item = create_item_sync (collection, "Perf");
+		item_path = g_strdup (g_dbus_proxy_get_object_path (G_DBUS_PROXY (item)));
+
+		/* What happened on every Items property change before signals */
+		if (reload) {
+			wait_for_items_property (collection, item_path, TRUE);
+			_secret_collection_load_items_sync (collection, NULL, &error);
+			g_assert_no_error (error);
+			g_assert (collection_has_item (collection, item_path));
+		} else {
+			wait_for_item (collection, item_path, TRUE);
+		}
+
+		secret_item_delete_sync (item, NULL, &error);
+		g_assert_no_error (error);
+		g_object_unref (item);
+
+		if (reload) {
+			wait_for_items_property (collection, item_path, FALSE);
+			_secret_collection_load_items_sync (collection, NULL, &error);
+			g_assert_no_error (error);
+			g_assert (!collection_has_item (collection, item_path));
+		} else {
+			wait_for_item (collection, item_path, FALSE);
+		}
+
+		g_free (item_path);
+	}
+
+	return g_test_timer_elapsed () / (count * 2);
+}
+
+static void
+test_items_update_perf (Test *test,
+                        gconstpointer unused)
+{
+	const gchar *collection_path = "/org/freedesktop/secrets/collection/many";
+	SecretCollection *collection;
+	GError *error = NULL;
+	gdouble incremental;
+	gdouble reload;
+	GList *items;
+	guint length;
+
+	if (!g_test_perf ())
+		return;
+
+	collection = secret_collection_new_sync (test->service, collection_path, NULL, &error);
+	g_assert_no_error (error);
+
+	items = secret_collection_get_items (collection);
+	length = g_list_length (items);
+	g_assert_cmpuint (length, ==, 20000);
+	g_list_free_full (items, g_object_unref);
+
+	reload = items_update_run (collection, 50, TRUE);
+	incremental = items_update_run (collection, 50, FALSE);
+
+	g_test_message ("item updates in a %u item collection: %.3f ms each reloading "
+	                "the whole table, %.3f ms each following signals",
+	                length, reload * 1000.0, incremental * 1000.0);
+	g_test_minimized_result (incremental, "%.6f seconds per item update, %.1f times "
+	                         "faster than reloading", incremental, reload / incremental);
+
+	g_object_unref (collection);
+}
+
 static void
 test_set_label_sync (Test *test,
                      gconstpointer unused)
@@ -517,8 +809,11 @@ main (int argc, char **argv)
 	g_test_add ("/collection/create-async", Test, "mock-service-normal.py", setup, test_create_async, teardown);
 	g_test_add ("/collection/properties", Test, "mock-service-normal.py", setup, test_properties, teardown);
 	g_test_add ("/collection/items", Test, "mock-service-normal.py", setup, test_items, teardown);
+	g_test_add ("/collection/items-async", Test, "mock-service-normal.py", setup, test_items_async, teardown);
 	g_test_add ("/collection/items-empty", Test, "mock-service-normal.py", setup, test_items_empty, teardown);
 	g_test_add ("/collection/items-empty-async", Test, "mock-service-normal.py", setup, test_items_empty_async, teardown);
+	g_test_add ("/collection/items-signals", Test, "mock-service-normal.py", setup, test_items_signals, teardown);
+	g_test_add ("/collection/items-update-perf", Test, "mock-service-many.py", setup, test_items_update_perf, teardown);
 	g_test_add ("/collection/set-label-sync", Test, "mock-service-normal.py", setup, test_set_label_sync, teardown);
 	g_test_add ("/collection/set-label-async", Test, "mock-service-normal.py", setup, test_set_label_async, teardown);
 	g_test_add ("/collection/set-label-prop", Test, "mock-service-normal.py", setup, test_set_label_prop, teardown);
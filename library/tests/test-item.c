@@ -435,6 +435,44 @@ test_set_attributes_sync (Test *test,
 	g_object_unref (item);
 }
 
+static void
+test_get_attribute (Test *test,
+                    gconstpointer unused)
+{
+	const gchar *item_path = "/org/freedesktop/secrets/collection/english/1";
+	GError *error = NULL;
+	SecretItem *item;
+	GHashTable *attributes;
+	const gchar *before;
+	gboolean ret;
+
+	item = secret_item_new_sync (test->service, item_path, NULL, &error);
+	g_assert_no_error (error);
+
+	before = secret_item_get_attribute (item, "string");
+	g_assert_cmpstr (before, ==, "one");
+	g_assert_cmpstr (secret_item_get_attribute (item, "even"), ==, "false");
+	g_assert (secret_item_get_attribute (item, "missing") == NULL);
+
+	attributes = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (attributes, "string", "five");
+	g_hash_table_insert (attributes, "number", "5");
+	ret = secret_item_set_attributes_sync (item, attributes, NULL, &error);
+	g_hash_table_unref (attributes);
+	g_assert_no_error (error);
+	g_assert (ret == TRUE);
+
+	/* The view is rebuilt when the attributes change */
+	g_assert_cmpstr (secret_item_get_attribute (item, "string"), ==, "five");
+
+	/* But a string from before the change is still valid */
+	g_assert_cmpstr (before, ==, "one");
+
+	g_assert (secret_item_get_attribute (item, "even") == NULL);
+
+	g_object_unref (item);
+}
+
 static void
 test_set_attributes_async (Test *test,
                            gconstpointer unused)
@@ -612,6 +650,47 @@ test_set_secret_sync (Test *test,
 	g_object_unref (item);
 }
 
+static void
+test_set_secret_large (Test *test,
+                       gconstpointer unused)
+{
+	const gchar *item_path = "/org/freedesktop/secrets/collection/english/1";
+	const gsize n_secret = 1024 * 1024;
+	GError *error = NULL;
+	SecretItem *item;
+	gconstpointer data;
+	SecretValue *value;
+	gchar *secret;
+	gsize length;
+	gboolean ret;
+	gsize i;
+
+	secret = g_malloc (n_secret);
+	for (i = 0; i < n_secret; i++)
+		secret[i] = (gchar)(i % 251);
+	value = secret_value_new (secret, n_secret, "application/octet-stream");
+
+	item = secret_item_new_sync (test->service, item_path, NULL, &error);
+	g_assert_no_error (error);
+
+	ret = secret_item_set_secret_sync (item, value, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret == TRUE);
+
+	secret_value_unref (value);
+
+	value = secret_item_get_secret_sync (item, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+
+	data = secret_value_get (value, &length);
+	egg_assert_cmpmem (data, length, ==, secret, n_secret);
+
+	secret_value_unref (value);
+	g_object_unref (item);
+	g_free (secret);
+}
+
 static void
 test_delete_sync (Test *test,
                   gconstpointer unused)
@@ -682,13 +761,19 @@ main (int argc, char **argv)
 	g_test_add ("/item/set-label-async", Test, "mock-service-normal.py", setup, test_set_label_async, teardown);
 	g_test_add ("/item/set-label-prop", Test, "mock-service-normal.py", setup, test_set_label_prop, teardown);
 	g_test_add ("/item/set-attributes-sync", Test, "mock-service-normal.py", setup, test_set_attributes_sync, teardown);
+	g_test_add ("/item/get-attribute", Test, "mock-service-normal.py", setup, test_get_attribute, teardown);
 	g_test_add ("/item/set-attributes-async", Test, "mock-service-normal.py", setup, test_set_attributes_async, teardown);
 	g_test_add ("/item/set-attributes-prop", Test, "mock-service-normal.py", setup, test_set_attributes_prop, teardown);
 	g_test_add ("/item/get-secret-sync", Test, "mock-service-normal.py", setup, test_get_secret_sync, teardown);
 	g_test_add ("/item/get-secret-async", Test, "mock-service-normal.py", setup, test_get_secret_async, teardown);
 	g_test_add ("/item/set-secret-sync", Test, "mock-service-normal.py", setup, test_set_secret_sync, teardown);
+	g_test_add ("/item/set-secret-large-plain", Test, "mock-service-only-plain.py", setup, test_set_secret_large, teardown);
 	g_test_add ("/item/delete-sync", Test, "mock-service-normal.py", setup, test_delete_sync, teardown);
 	g_test_add ("/item/delete-async", Test, "mock-service-normal.py", setup, test_delete_async, teardown);
 
+	/* The mock service does AES in pure python, which is slow for large secrets */
+	if (g_test_thorough ())
+		g_test_add ("/item/set-secret-large-aes", Test, "mock-service-normal.py", setup, test_set_secret_large, teardown);
+
 	return egg_tests_run_with_loop ();
 }
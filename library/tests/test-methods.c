@@ -314,6 +314,57 @@ test_search_async (Test *test,
 	g_hash_table_unref (attributes);
 }
 
+static void
+test_search_handles (Test *test,
+                     gconstpointer used)
+{
+	SecretItemHandle *handle;
+	GHashTable *attributes;
+	SecretItem *item;
+	gboolean ret;
+	GList *locked;
+	GList *unlocked;
+	GError *error = NULL;
+	gchar *label;
+
+	attributes = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (attributes, "number", "1");
+
+	ret = secret_service_search_handles_sync (test->service, attributes, NULL,
+	                                          &unlocked, &locked, &error);
+	g_assert_no_error (error);
+	g_assert (ret == TRUE);
+
+	g_assert (locked != NULL);
+	handle = locked->data;
+	g_assert_cmpstr (secret_item_handle_get_path (handle), ==, "/org/freedesktop/secrets/collection/spanish/10");
+	g_assert (secret_item_handle_get_locked (handle) == TRUE);
+
+	g_assert (unlocked != NULL);
+	handle = unlocked->data;
+	g_assert_cmpstr (secret_item_handle_get_path (handle), ==, "/org/freedesktop/secrets/collection/english/1");
+	g_assert_cmpstr (secret_item_handle_get_label (handle), ==, "Item One");
+	g_assert_cmpstr (secret_item_handle_get_schema (handle), ==, "org.mock.type.Store");
+	g_assert_cmpstr (secret_item_handle_get_attribute (handle, "string"), ==, "one");
+	g_assert (secret_item_handle_get_attribute (handle, "missing") == NULL);
+	g_assert (secret_item_handle_get_locked (handle) == FALSE);
+
+	/* Upgrade the handle to a full item */
+	item = secret_item_new_for_handle (test->service, handle, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (SECRET_IS_ITEM (item));
+	g_assert_cmpstr (g_dbus_proxy_get_object_path (G_DBUS_PROXY (item)), ==, "/org/freedesktop/secrets/collection/english/1");
+	label = secret_item_get_label (item);
+	g_assert_cmpstr (label, ==, "Item One");
+	g_free (label);
+	g_object_unref (item);
+
+	g_list_free_full (unlocked, secret_item_handle_unref);
+	g_list_free_full (locked, secret_item_handle_unref);
+
+	g_hash_table_unref (attributes);
+}
+
 static void
 test_search_nulls (Test *test,
                    gconstpointer used)
@@ -486,6 +537,132 @@ test_secrets_for_paths_sync (Test *test,
 	g_hash_table_unref (values);
 }
 
+static void
+test_secret_array_for_paths_sync (Test *test,
+                                  gconstpointer used)
+{
+	const gchar *paths[] = {
+		"/org/freedesktop/secrets/collection/english/1",
+		"/org/freedesktop/secrets/collection/english/2",
+
+		/* This one is locked, and not returned */
+		"/org/freedesktop/secrets/collection/spanish/10",
+		NULL
+	};
+
+	SecretValueArray *array;
+	SecretValue *value;
+	GError *error = NULL;
+	const gchar *password;
+	const gchar *path;
+	gsize length;
+	guint i;
+
+	array = secret_service_get_secret_array_for_paths_sync (test->service, paths, NULL, &error);
+	g_assert_no_error (error);
+
+	g_assert (array != NULL);
+	g_assert_cmpuint (secret_value_array_get_length (array), ==, 2);
+
+	for (i = 0; i < 2; i++) {
+		path = secret_value_array_get_path (array, i);
+		value = secret_value_array_get_value (array, i);
+		password = secret_value_get (value, &length);
+		g_assert_cmpuint (length, ==, 3);
+		g_assert_cmpstr (secret_value_get_content_type (value), ==, "text/plain");
+
+		if (g_str_equal (path, paths[0]))
+			g_assert_cmpstr (password, ==, "111");
+		else if (g_str_equal (path, paths[1]))
+			g_assert_cmpstr (password, ==, "222");
+		else
+			g_assert_not_reached ();
+	}
+
+	/* Values stay valid after the array is gone */
+	value = secret_value_ref (secret_value_array_get_value (array, 0));
+	secret_value_array_unref (array);
+	g_assert_cmpstr (secret_value_get (value, NULL), ==, "111");
+	secret_value_unref (value);
+}
+
+static gint allocations = 0;
+
+static gpointer
+counting_malloc (gsize n_bytes)
+{
+	g_atomic_int_inc (&allocations);
+	return malloc (n_bytes);
+}
+
+static gpointer
+counting_calloc (gsize n_blocks,
+                 gsize n_block_bytes)
+{
+	g_atomic_int_inc (&allocations);
+	return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable counting_vtable = {
+	counting_malloc,
+	realloc,
+	free,
+	counting_calloc,
+	counting_malloc,
+	realloc,
+};
+
+static void
+test_secret_array_perf (Test *test,
+                        gconstpointer used)
+{
+	SecretValueArray *array;
+	GHashTable *values;
+	GError *error = NULL;
+	gchar **paths;
+	gint count = 5000;
+	gint before;
+	gdouble table_allocs, array_allocs;
+	gdouble table_time, array_time;
+	gint i;
+
+	paths = g_new0 (gchar *, count + 1);
+	for (i = 0; i < count; i++)
+		paths[i] = g_strdup_printf ("/org/freedesktop/secrets/collection/many/%d", i);
+
+	/* Open the session up front, so it isn't counted */
+	secret_service_ensure_session_sync (test->service, NULL, &error);
+	g_assert_no_error (error);
+
+	before = g_atomic_int_get (&allocations);
+	g_test_timer_start ();
+	values = secret_service_get_secrets_for_paths_sync (test->service, (const gchar **)paths,
+	                                                    NULL, &error);
+	table_time = g_test_timer_elapsed ();
+	table_allocs = (gdouble)(g_atomic_int_get (&allocations) - before) / count;
+	g_assert_no_error (error);
+	g_assert_cmpuint (g_hash_table_size (values), ==, count);
+	g_hash_table_unref (values);
+
+	before = g_atomic_int_get (&allocations);
+	g_test_timer_start ();
+	array = secret_service_get_secret_array_for_paths_sync (test->service, (const gchar **)paths,
+	                                                        NULL, &error);
+	array_time = g_test_timer_elapsed ();
+	array_allocs = (gdouble)(g_atomic_int_get (&allocations) - before) / count;
+	g_assert_no_error (error);
+	g_assert_cmpuint (secret_value_array_get_length (array), ==, count);
+	secret_value_array_unref (array);
+
+	g_test_message ("hash table result: %.2f allocations/secret, %.3f ms total",
+	                table_allocs, table_time * 1000);
+	g_test_message ("array result: %.2f allocations/secret, %.3f ms total",
+	                array_allocs, array_time * 1000);
+	g_test_minimized_result (array_allocs, "%.2f allocations per secret", array_allocs);
+
+	g_strfreev (paths);
+}
+
 static void
 test_secrets_for_paths_async (Test *test,
                               gconstpointer used)
@@ -1077,6 +1254,426 @@ test_lookup_sync (Test *test,
 	secret_value_unref (value);
 }
 
+static void
+on_lookup_collect (GObject *source,
+                   GAsyncResult *result,
+                   gpointer user_data)
+{
+	GPtrArray *values = user_data;
+	GError *error = NULL;
+	SecretValue *value;
+
+	value = secret_service_lookup_finish (SECRET_SERVICE (source), result, &error);
+	g_assert_no_error (error);
+	g_ptr_array_add (values, value);
+
+	if (values->len == 3)
+		egg_test_wait_stop ();
+}
+
+static void
+test_lookup_coalesce (Test *test,
+                      gconstpointer used)
+{
+	GPtrArray *values;
+	gsize length;
+	guint i;
+
+	values = g_ptr_array_new_with_free_func (secret_value_unref);
+
+	for (i = 0; i < 3; i++)
+		secret_service_lookup (test->service, &STORE_SCHEMA, NULL,
+		                       on_lookup_collect, values,
+		                       "even", FALSE,
+		                       "string", "one",
+		                       "number", 1,
+		                       NULL);
+
+	egg_test_wait ();
+
+	/* All three lookups should have shared one result */
+	g_assert_cmpuint (values->len, ==, 3);
+	g_assert (values->pdata[0] != NULL);
+	g_assert_cmpstr (secret_value_get (values->pdata[0], &length), ==, "111");
+	g_assert (values->pdata[1] == values->pdata[0]);
+	g_assert (values->pdata[2] == values->pdata[0]);
+
+	g_ptr_array_free (values, TRUE);
+}
+
+typedef struct {
+	GPtrArray *values;
+	guint n_cancelled;
+	guint n_expected;
+} LookupCancelled;
+
+static void
+on_lookup_collect_cancelled (GObject *source,
+                             GAsyncResult *result,
+                             gpointer user_data)
+{
+	LookupCancelled *collect = user_data;
+	GError *error = NULL;
+	SecretValue *value;
+
+	value = secret_service_lookup_finish (SECRET_SERVICE (source), result, &error);
+	if (error != NULL) {
+		g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+		g_error_free (error);
+		collect->n_cancelled++;
+	} else {
+		g_ptr_array_add (collect->values, value);
+	}
+
+	if (collect->values->len + collect->n_cancelled == collect->n_expected)
+		egg_test_wait_stop ();
+}
+
+static void
+lookup_one (Test *test,
+            GCancellable *cancellable,
+            LookupCancelled *collect)
+{
+	secret_service_lookup (test->service, &STORE_SCHEMA, cancellable,
+	                       on_lookup_collect_cancelled, collect,
+	                       "even", FALSE,
+	                       "string", "one",
+	                       "number", 1,
+	                       NULL);
+}
+
+static void
+test_lookup_coalesce_cancelled (Test *test,
+                                gconstpointer used)
+{
+	LookupCancelled collect = { NULL, 0, 3 };
+	GCancellable *cancellable;
+
+	collect.values = g_ptr_array_new_with_free_func (secret_value_unref);
+	cancellable = g_cancellable_new ();
+
+	/* The first lookup leads, and is cancelled */
+	lookup_one (test, cancellable, &collect);
+	lookup_one (test, NULL, &collect);
+	lookup_one (test, NULL, &collect);
+	g_cancellable_cancel (cancellable);
+
+	egg_test_wait ();
+
+	/* One of the others took over, and they still shared its result */
+	g_assert_cmpuint (collect.n_cancelled, ==, 1);
+	g_assert_cmpuint (collect.values->len, ==, 2);
+	g_assert (collect.values->pdata[0] != NULL);
+	g_assert_cmpstr (secret_value_get (collect.values->pdata[0], NULL), ==, "111");
+	g_assert (collect.values->pdata[1] == collect.values->pdata[0]);
+
+	g_ptr_array_free (collect.values, TRUE);
+	g_object_unref (cancellable);
+}
+
+static void
+test_lookup_join_cancelled (Test *test,
+                            gconstpointer used)
+{
+	LookupCancelled collect = { NULL, 0, 1 };
+	GCancellable *cancellable;
+
+	collect.values = g_ptr_array_new_with_free_func (secret_value_unref);
+	cancellable = g_cancellable_new ();
+
+	/* The cancelled join completes before the lookup it joined */
+	lookup_one (test, NULL, &collect);
+	lookup_one (test, cancellable, &collect);
+	g_cancellable_cancel (cancellable);
+
+	egg_test_wait ();
+	g_assert_cmpuint (collect.n_cancelled, ==, 1);
+	g_assert_cmpuint (collect.values->len, ==, 0);
+
+	/* And the lookup still completes */
+	collect.n_expected = 2;
+	egg_test_wait ();
+	g_assert_cmpuint (collect.values->len, ==, 1);
+
+	g_ptr_array_free (collect.values, TRUE);
+	g_object_unref (cancellable);
+}
+
+static GHashTable *
+attributes_for_number (const gchar *number,
+                       const gchar *string)
+{
+	GHashTable *attributes;
+
+	attributes = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (attributes, "number", (gpointer)number);
+	g_hash_table_insert (attributes, "string", (gpointer)string);
+	return attributes;
+}
+
+static void
+test_lookup_batch_sync (Test *test,
+                        gconstpointer used)
+{
+	const SecretSchema *schemas[] = { &STORE_SCHEMA, &STORE_SCHEMA, &STORE_SCHEMA, &STORE_SCHEMA };
+	GHashTable *attributes[4];
+	GError *error = NULL;
+	GPtrArray *values;
+	gsize length;
+	guint i;
+
+	attributes[0] = attributes_for_number ("2", "two");
+	attributes[1] = attributes_for_number ("5", "five");
+	attributes[2] = attributes_for_number ("1", "one");
+	attributes[3] = attributes_for_number ("3", "tres");
+
+	values = secret_service_lookup_batch_sync (test->service, schemas, attributes,
+	                                           G_N_ELEMENTS (attributes), NULL, &error);
+	g_assert_no_error (error);
+
+	/* Results in the order of the lookups, with gaps for missing ones */
+	g_assert (values != NULL);
+	g_assert_cmpuint (values->len, ==, 4);
+	g_assert_cmpstr (secret_value_get (g_ptr_array_index (values, 0), &length), ==, "222");
+	g_assert (g_ptr_array_index (values, 1) == NULL);
+	g_assert_cmpstr (secret_value_get (g_ptr_array_index (values, 2), &length), ==, "111");
+
+	/* This one was in a locked collection */
+	g_assert_cmpstr (secret_value_get (g_ptr_array_index (values, 3), &length), ==, "3333");
+
+	g_ptr_array_unref (values);
+	for (i = 0; i < G_N_ELEMENTS (attributes); i++)
+		g_hash_table_unref (attributes[i]);
+}
+
+static void
+test_lookup_batch_async (Test *test,
+                         gconstpointer used)
+{
+	const SecretSchema *schemas[] = { &STORE_SCHEMA, &STORE_SCHEMA };
+	GHashTable *attributes[2];
+	GAsyncResult *result = NULL;
+	GError *error = NULL;
+	GPtrArray *values;
+	gsize length;
+
+	attributes[0] = attributes_for_number ("1", "one");
+	attributes[1] = attributes_for_number ("1", "one");
+
+	secret_service_lookup_batch (test->service, schemas, attributes, 2, NULL,
+	                             on_complete_get_result, &result);
+	g_assert (result == NULL);
+
+	egg_test_wait ();
+
+	values = secret_service_lookup_batch_finish (test->service, result, &error);
+	g_assert_no_error (error);
+	g_object_unref (result);
+
+	g_assert_cmpuint (values->len, ==, 2);
+	g_assert_cmpstr (secret_value_get (g_ptr_array_index (values, 0), &length), ==, "111");
+	g_assert_cmpstr (secret_value_get (g_ptr_array_index (values, 1), &length), ==, "111");
+
+	g_ptr_array_unref (values);
+	g_hash_table_unref (attributes[0]);
+	g_hash_table_unref (attributes[1]);
+}
+
+static void
+test_lookup_cache (Test *test,
+                   gconstpointer used)
+{
+	GError *error = NULL;
+	SecretValue *value;
+	guint hits, misses;
+	gboolean ret;
+	gsize length;
+
+	secret_service_set_lookup_cache (test->service, 16, 0, TRUE);
+
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "even", FALSE, "string", "one", "number", 1, NULL);
+	g_assert_no_error (error);
+	g_assert_cmpstr (secret_value_get (value, &length), ==, "111");
+	secret_value_unref (value);
+
+	/* Same attributes in a different order */
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "number", 1, "string", "one", "even", FALSE, NULL);
+	g_assert_no_error (error);
+	g_assert_cmpstr (secret_value_get (value, &length), ==, "111");
+	secret_value_unref (value);
+
+	secret_service_get_lookup_cache_stats (test->service, &hits, &misses);
+	g_assert_cmpuint (hits, ==, 1);
+	g_assert_cmpuint (misses, ==, 1);
+
+	/* Storing through this proxy must not leave a stale value behind */
+	value = secret_value_new ("changed", -1, "text/plain");
+	ret = secret_service_store_sync (test->service, &STORE_SCHEMA,
+	                                  "/org/freedesktop/secrets/collection/english",
+	                                  "Item One", value, NULL, &error,
+	                                  "even", FALSE, "string", "one", "number", 1, NULL);
+	g_assert_no_error (error);
+	g_assert (ret == TRUE);
+	secret_value_unref (value);
+
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "even", FALSE, "string", "one", "number", 1, NULL);
+	g_assert_no_error (error);
+	g_assert_cmpstr (secret_value_get (value, &length), ==, "changed");
+	secret_value_unref (value);
+
+	secret_service_get_lookup_cache_stats (test->service, &hits, &misses);
+	g_assert_cmpuint (hits, ==, 1);
+	g_assert_cmpuint (misses, ==, 2);
+
+	secret_service_clear_lookup_cache (test->service);
+	secret_service_get_lookup_cache_stats (test->service, &hits, &misses);
+	g_assert_cmpuint (hits, ==, 0);
+	g_assert_cmpuint (misses, ==, 0);
+}
+
+static void
+on_item_deleted_signal (GDBusConnection *connection,
+                        const gchar *sender_name,
+                        const gchar *object_path,
+                        const gchar *interface_name,
+                        const gchar *signal_name,
+                        GVariant *parameters,
+                        gpointer user_data)
+{
+	egg_test_wait_stop ();
+}
+
+static void
+test_lookup_cache_signal (Test *test,
+                          gconstpointer used)
+{
+	GDBusConnection *connection;
+	GError *error = NULL;
+	SecretValue *value;
+	GVariant *retval;
+	guint hits, misses;
+	guint subscription;
+
+	secret_service_set_lookup_cache (test->service, 16, 0, TRUE);
+
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "even", FALSE, "string", "one", "number", 1, NULL);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	secret_value_unref (value);
+
+	connection = g_dbus_proxy_get_connection (G_DBUS_PROXY (test->service));
+	subscription = g_dbus_connection_signal_subscribe (connection, NULL,
+	                                                   SECRET_COLLECTION_INTERFACE, "ItemDeleted",
+	                                                   NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+	                                                   on_item_deleted_signal, NULL, NULL);
+
+	/* Delete behind the back of the proxy */
+	retval = g_dbus_connection_call_sync (connection,
+	                                      g_dbus_proxy_get_name (G_DBUS_PROXY (test->service)),
+	                                      "/org/freedesktop/secrets/collection/english/1",
+	                                      SECRET_ITEM_INTERFACE, "Delete", g_variant_new ("()"),
+	                                      G_VARIANT_TYPE ("(o)"), G_DBUS_CALL_FLAGS_NONE,
+	                                      -1, NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (retval);
+
+	egg_test_wait ();
+	egg_test_wait_idle ();
+	g_dbus_connection_signal_unsubscribe (connection, subscription);
+
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "even", FALSE, "string", "one", "number", 1, NULL);
+	g_assert_no_error (error);
+	g_assert (value == NULL);
+
+	secret_service_get_lookup_cache_stats (test->service, &hits, &misses);
+	g_assert_cmpuint (hits, ==, 0);
+	g_assert_cmpuint (misses, ==, 2);
+}
+
+static void
+test_sync_reentrant (void)
+{
+	SecretSync *outer;
+	SecretSync *inner;
+	SecretSync *sync;
+
+	outer = _secret_sync_new ();
+	g_main_context_push_thread_default (outer->context);
+
+	/* A nested sync call must not get the context that is in use */
+	inner = _secret_sync_new ();
+	g_assert (inner != outer);
+	g_assert (inner->context != outer->context);
+	_secret_sync_free (inner);
+
+	g_main_context_pop_thread_default (outer->context);
+	_secret_sync_free (outer);
+
+	/* Next call on this thread reuses the cached one */
+	sync = _secret_sync_new ();
+	g_assert (sync == inner);
+	g_assert (sync->result == NULL);
+	_secret_sync_free (sync);
+}
+
+static void
+test_lookup_sync_perf (Test *test,
+                       gconstpointer used)
+{
+	GError *error = NULL;
+	SecretValue *value;
+	GMainContext *context;
+	GMainLoop *loop;
+	SecretSync *sync;
+	gdouble fresh, cached;
+	gint i, count = 10000;
+
+	/* The per call setup as it was done before contexts were cached */
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		context = g_main_context_new ();
+		loop = g_main_loop_new (context, FALSE);
+		g_main_context_push_thread_default (context);
+		g_main_context_pop_thread_default (context);
+		g_main_loop_unref (loop);
+		g_main_context_unref (context);
+	}
+	fresh = g_test_timer_elapsed ();
+
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		sync = _secret_sync_new ();
+		g_main_context_push_thread_default (sync->context);
+		g_main_context_pop_thread_default (sync->context);
+		_secret_sync_free (sync);
+	}
+	cached = g_test_timer_elapsed ();
+
+	g_test_message ("sync setup: fresh context %.3f us/call, cached context %.3f us/call",
+	                fresh * 1000000 / count, cached * 1000000 / count);
+
+	count = 1000;
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+		                                     "even", FALSE,
+		                                     "string", "one",
+		                                     "number", 1,
+		                                     NULL);
+		g_assert_no_error (error);
+		g_assert (value != NULL);
+		secret_value_unref (value);
+	}
+
+	cached = g_test_timer_elapsed () * 1000 / count;
+	g_test_minimized_result (cached, "lookup sync: %.3f ms/call", cached);
+}
+
 static void
 test_lookup_async (Test *test,
                    gconstpointer used)
@@ -1131,6 +1728,40 @@ test_lookup_locked (Test *test,
 	secret_value_unref (value);
 }
 
+static void
+test_lookup_with_session (Test *test,
+                          gconstpointer used)
+{
+	GError *error = NULL;
+	SecretValue *value;
+	gsize length;
+
+	/* With a session the secret comes back with the search */
+	secret_service_ensure_session_sync (test->service, NULL, &error);
+	g_assert_no_error (error);
+
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "even", FALSE,
+	                                     "string", "one",
+	                                     "number", 1,
+	                                     NULL);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	g_assert_cmpstr (secret_value_get (value, &length), ==, "111");
+	secret_value_unref (value);
+
+	/* A locked item still gets unlocked */
+	value = secret_service_lookup_sync (test->service, &STORE_SCHEMA, NULL, &error,
+	                                     "even", FALSE,
+	                                     "string", "tres",
+	                                     "number", 3,
+	                                     NULL);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	g_assert_cmpstr (secret_value_get (value, &length), ==, "3333");
+	secret_value_unref (value);
+}
+
 static void
 test_lookup_no_match (Test *test,
                       gconstpointer used)
@@ -1195,6 +1826,176 @@ test_store_sync (Test *test,
 	g_strfreev (paths);
 }
 
+static GVariant *
+attributes_via_table (const SecretSchema *schema,
+                      ...)
+{
+	GHashTable *attributes;
+	GHashTable *copy;
+	GVariant *variant;
+	va_list va;
+
+	/* The way varargs attributes were marshalled before */
+	va_start (va, schema);
+	attributes = _secret_util_attributes_for_varargs (schema, va);
+	va_end (va);
+
+	g_assert (_secret_util_attributes_validate (schema, attributes));
+	copy = _secret_util_attributes_copy (attributes);
+	variant = g_variant_ref_sink (_secret_util_variant_for_attributes (copy));
+
+	g_hash_table_unref (copy);
+	g_hash_table_unref (attributes);
+	return variant;
+}
+
+static GVariant *
+attributes_via_builder (const SecretSchema *schema,
+                        ...)
+{
+	GVariant *variant;
+	va_list va;
+
+	va_start (va, schema);
+	variant = _secret_util_variant_for_varargs (schema, va);
+	va_end (va);
+
+	return g_variant_ref_sink (variant);
+}
+
+static void
+test_attributes_perf (void)
+{
+	GVariant *variant;
+	gdouble table, builder;
+	gint i, count = 100000;
+
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		variant = attributes_via_table (&STORE_SCHEMA, "even", FALSE,
+		                                "string", "one", "number", i, NULL);
+		g_variant_unref (variant);
+	}
+	table = g_test_timer_elapsed ();
+
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		variant = attributes_via_builder (&STORE_SCHEMA, "even", FALSE,
+		                                  "string", "one", "number", i, NULL);
+		g_variant_unref (variant);
+	}
+	builder = g_test_timer_elapsed ();
+
+	g_test_message ("attribute marshalling: hash table %.3f us/call, builder %.3f us/call",
+	                table * 1000000 / count, builder * 1000000 / count);
+	g_test_minimized_result (builder, "marshalled %d attribute sets in %6.3f seconds",
+	                         count, builder);
+}
+
+static void
+test_attributes_varargs (void)
+{
+	GVariant *variant;
+	const gchar *value;
+
+	variant = attributes_via_builder (&STORE_SCHEMA, "even", TRUE,
+	                                  "string", "two", "number", -2, NULL);
+	g_assert_cmpuint (g_variant_n_children (variant), ==, 3);
+	g_assert (g_variant_lookup (variant, "even", "&s", &value));
+	g_assert_cmpstr (value, ==, "true");
+	g_assert (g_variant_lookup (variant, "string", "&s", &value));
+	g_assert_cmpstr (value, ==, "two");
+	g_assert (g_variant_lookup (variant, "number", "&s", &value));
+	g_assert_cmpstr (value, ==, "-2");
+	g_variant_unref (variant);
+}
+
+static void
+test_schema_find_attribute (void)
+{
+	const SecretSchemaAttribute *attribute;
+	SecretSchema *schema;
+	GHashTable *attributes;
+	gchar *name;
+	gint i;
+
+	/* The precomputed index of a predefined schema */
+	for (i = 0; SECRET_SCHEMA_NETWORK->attributes[i].name != NULL; i++) {
+		attribute = _secret_schema_find_attribute (SECRET_SCHEMA_NETWORK,
+		                                           SECRET_SCHEMA_NETWORK->attributes[i].name);
+		g_assert (attribute == &SECRET_SCHEMA_NETWORK->attributes[i]);
+	}
+	g_assert (_secret_schema_find_attribute (SECRET_SCHEMA_NETWORK, "missing") == NULL);
+
+	/* The lazily built index of an allocated schema */
+	attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < 32; i++)
+		g_hash_table_insert (attributes, g_strdup_printf ("attr%d", i),
+		                     GINT_TO_POINTER (SECRET_SCHEMA_ATTRIBUTE_INTEGER));
+	schema = secret_schema_new ("org.mock.schema.Large", SECRET_SCHEMA_NONE, attributes);
+	g_hash_table_unref (attributes);
+
+	for (i = 0; i < 32; i++) {
+		name = g_strdup_printf ("attr%d", i);
+		attribute = _secret_schema_find_attribute (schema, name);
+		g_assert (attribute != NULL);
+		g_assert_cmpstr (attribute->name, ==, name);
+		g_free (name);
+	}
+	g_assert (_secret_schema_find_attribute (schema, "attr32") == NULL);
+	g_assert (_secret_schema_find_attribute (schema, "") == NULL);
+
+	secret_schema_unref (schema);
+}
+
+static void
+test_schema_find_attribute_perf (void)
+{
+	SecretSchema *schema;
+	SecretSchema linear;
+	GHashTable *attributes;
+	gchar *names[32];
+	gdouble indexed, scanned;
+	gint i, j, count = 20000;
+
+	attributes = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < 32; i++) {
+		names[i] = g_strdup_printf ("an.attribute.name.%d", i);
+		g_hash_table_insert (attributes, names[i],
+		                     GINT_TO_POINTER (SECRET_SCHEMA_ATTRIBUTE_STRING));
+	}
+	schema = secret_schema_new ("org.mock.schema.Large", SECRET_SCHEMA_NONE, attributes);
+	g_hash_table_unref (attributes);
+
+	/* A copy that we didn't allocate is searched linearly */
+	linear = *schema;
+	linear.reserved = 0;
+	linear.reserved1 = NULL;
+
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < 32; j++)
+			g_assert (_secret_schema_find_attribute (&linear, names[j]) != NULL);
+	}
+	scanned = g_test_timer_elapsed ();
+
+	g_test_timer_start ();
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < 32; j++)
+			g_assert (_secret_schema_find_attribute (schema, names[j]) != NULL);
+	}
+	indexed = g_test_timer_elapsed ();
+
+	g_test_message ("attribute lookup: linear %.3f ns/call, indexed %.3f ns/call",
+	                scanned * 1000000000 / (count * 32), indexed * 1000000000 / (count * 32));
+	g_test_minimized_result (indexed, "found %d attributes in %6.3f seconds",
+	                         count * 32, indexed);
+
+	secret_schema_unref (schema);
+	for (i = 0; i < 32; i++)
+		g_free (names[i]);
+}
+
 static void
 test_store_replace (Test *test,
                     gconstpointer used)
@@ -1297,6 +2098,10 @@ test_store_async (Test *test,
 int
 main (int argc, char **argv)
 {
+	/* Count allocations for the perf tests, has to happen before anything else */
+	g_mem_set_vtable (&counting_vtable);
+	g_setenv ("G_SLICE", "always-malloc", TRUE);
+
 	g_test_init (&argc, &argv, NULL);
 	g_set_prgname ("test-service");
 	g_type_init ();
@@ -1307,12 +2112,17 @@ main (int argc, char **argv)
 	g_test_add ("/service/search-sync", Test, "mock-service-normal.py", setup, test_search_sync, teardown);
 	g_test_add ("/service/search-async", Test, "mock-service-normal.py", setup, test_search_async, teardown);
 	g_test_add ("/service/search-nulls", Test, "mock-service-normal.py", setup, test_search_nulls, teardown);
+	g_test_add ("/service/search-handles", Test, "mock-service-normal.py", setup, test_search_handles, teardown);
 
 	g_test_add ("/service/secret-for-path-sync", Test, "mock-service-normal.py", setup, test_secret_for_path_sync, teardown);
 	g_test_add ("/service/secret-for-path-plain", Test, "mock-service-only-plain.py", setup, test_secret_for_path_sync, teardown);
 	g_test_add ("/service/secret-for-path-async", Test, "mock-service-normal.py", setup, test_secret_for_path_async, teardown);
 	g_test_add ("/service/secrets-for-paths-sync", Test, "mock-service-normal.py", setup, test_secrets_for_paths_sync, teardown);
 	g_test_add ("/service/secrets-for-paths-async", Test, "mock-service-normal.py", setup, test_secrets_for_paths_async, teardown);
+	g_test_add ("/service/secret-array-for-paths-sync", Test, "mock-service-normal.py", setup, test_secret_array_for_paths_sync, teardown);
+	g_test_add ("/service/secret-array-for-paths-plain", Test, "mock-service-only-plain.py", setup, test_secret_array_for_paths_sync, teardown);
+	if (g_test_perf ())
+		g_test_add ("/service/secret-array-perf", Test, "mock-service-many.py", setup, test_secret_array_perf, teardown);
 	g_test_add ("/service/secrets-sync", Test, "mock-service-normal.py", setup, test_secrets_sync, teardown);
 	g_test_add ("/service/secrets-async", Test, "mock-service-normal.py", setup, test_secrets_async, teardown);
 
@@ -1334,10 +2144,23 @@ main (int argc, char **argv)
 	g_test_add ("/service/create-item-async", Test, "mock-service-normal.py", setup, test_item_async, teardown);
 
 	g_test_add ("/service/lookup-sync", Test, "mock-service-normal.py", setup, test_lookup_sync, teardown);
+	g_test_add ("/service/lookup-coalesce", Test, "mock-service-normal.py", setup, test_lookup_coalesce, teardown);
+	g_test_add ("/service/lookup-coalesce-cancelled", Test, "mock-service-normal.py", setup, test_lookup_coalesce_cancelled, teardown);
+	g_test_add ("/service/lookup-join-cancelled", Test, "mock-service-normal.py", setup, test_lookup_join_cancelled, teardown);
 	g_test_add ("/service/lookup-async", Test, "mock-service-normal.py", setup, test_lookup_async, teardown);
 	g_test_add ("/service/lookup-locked", Test, "mock-service-normal.py", setup, test_lookup_locked, teardown);
+	g_test_add ("/service/lookup-with-session", Test, "mock-service-normal.py", setup, test_lookup_with_session, teardown);
 	g_test_add ("/service/lookup-no-match", Test, "mock-service-normal.py", setup, test_lookup_no_match, teardown);
 
+	g_test_add ("/service/lookup-batch-sync", Test, "mock-service-normal.py", setup, test_lookup_batch_sync, teardown);
+	g_test_add ("/service/lookup-batch-async", Test, "mock-service-normal.py", setup, test_lookup_batch_async, teardown);
+	g_test_add ("/service/lookup-cache", Test, "mock-service-normal.py", setup, test_lookup_cache, teardown);
+	g_test_add ("/service/lookup-cache-signal", Test, "mock-service-normal.py", setup, test_lookup_cache_signal, teardown);
+
+	g_test_add_func ("/service/sync-reentrant", test_sync_reentrant);
+	if (g_test_perf ())
+		g_test_add ("/service/lookup-sync-perf", Test, "mock-service-normal.py", setup, test_lookup_sync_perf, teardown);
+
 	g_test_add ("/service/remove-sync", Test, "mock-service-delete.py", setup, test_remove_sync, teardown);
 	g_test_add ("/service/remove-async", Test, "mock-service-delete.py", setup, test_remove_async, teardown);
 	g_test_add ("/service/remove-locked", Test, "mock-service-delete.py", setup, test_remove_locked, teardown);
@@ -1347,5 +2170,12 @@ main (int argc, char **argv)
 	g_test_add ("/service/store-async", Test, "mock-service-normal.py", setup, test_store_async, teardown);
 	g_test_add ("/service/store-replace", Test, "mock-service-normal.py", setup, test_store_replace, teardown);
 
+	g_test_add_func ("/service/attributes-varargs", test_attributes_varargs);
+	if (g_test_perf ())
+		g_test_add_func ("/service/attributes-perf", test_attributes_perf);
+	g_test_add_func ("/service/schema-find-attribute", test_schema_find_attribute);
+	if (g_test_perf ())
+		g_test_add_func ("/service/schema-find-attribute-perf", test_schema_find_attribute_perf);
+
 	return egg_tests_run_with_loop ();
 }
@@ -114,6 +114,150 @@ test_lookup_async (Test *test,
 	secret_password_free (password);
 }
 
+static void
+test_lookup_keep_alive (Test *test,
+                        gconstpointer used)
+{
+	SecretService *service;
+	GError *error = NULL;
+	gpointer instance;
+	gchar *session;
+	gchar *password;
+
+	secret_service_set_keep_alive (60);
+
+	password = secret_password_lookup_nonpageable_sync (&PASSWORD_SCHEMA, NULL, &error,
+	                                                    "even", FALSE,
+	                                                    "string", "one",
+	                                                    "number", 1,
+	                                                    NULL);
+	g_assert_no_error (error);
+	g_assert_cmpstr (password, ==, "111");
+	secret_password_free (password);
+
+	/* The shared service and its session should still be around */
+	service = secret_service_get_sync (SECRET_SERVICE_NONE, NULL, &error);
+	g_assert_no_error (error);
+	session = g_strdup (secret_service_get_session_path (service));
+	g_assert (session != NULL);
+	instance = service;
+	g_object_add_weak_pointer (G_OBJECT (service), &instance);
+	g_object_unref (service);
+	g_assert (instance != NULL);
+
+	password = secret_password_lookup_nonpageable_sync (&PASSWORD_SCHEMA, NULL, &error,
+	                                                    "even", FALSE,
+	                                                    "string", "one",
+	                                                    "number", 1,
+	                                                    NULL);
+	g_assert_no_error (error);
+	g_assert_cmpstr (password, ==, "111");
+	secret_password_free (password);
+
+	g_assert (instance != NULL);
+	g_assert_cmpstr (secret_service_get_session_path (instance), ==, session);
+	g_free (session);
+
+	secret_service_set_keep_alive (0);
+	g_assert (instance == NULL);
+}
+
+static void
+test_lookup_keep_alive_perf (Test *test,
+                             gconstpointer used)
+{
+	GError *error = NULL;
+	gchar *password;
+	gdouble elapsed;
+	gint i;
+
+	secret_service_set_keep_alive (60);
+
+	g_test_timer_start ();
+
+	for (i = 0; i < 10000; i++) {
+		password = secret_password_lookup_nonpageable_sync (&PASSWORD_SCHEMA, NULL, &error,
+		                                                    "even", FALSE,
+		                                                    "string", "one",
+		                                                    "number", 1,
+		                                                    NULL);
+		g_assert_no_error (error);
+		g_assert_cmpstr (password, ==, "111");
+		secret_password_free (password);
+	}
+
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "looked up 10000 passwords in %6.3f seconds", elapsed);
+
+	secret_service_set_keep_alive (0);
+}
+
+static void
+on_service_signal (GDBusProxy *proxy,
+                   gchar *sender_name,
+                   gchar *signal_name,
+                   GVariant *parameters,
+                   gpointer user_data)
+{
+	guint *signals = user_data;
+	(*signals)++;
+}
+
+static void
+test_lookup_sync_signal_after (Test *test,
+                               gconstpointer used)
+{
+	SecretService *service;
+	GHashTable *properties;
+	GError *error = NULL;
+	gchar *password;
+	guint signals = 0;
+	gchar *path;
+
+	secret_service_set_keep_alive (60);
+
+	/* The shared service is created, and subscribes, inside this call */
+	password = secret_password_lookup_nonpageable_sync (&PASSWORD_SCHEMA, NULL, &error,
+	                                                    "even", FALSE,
+	                                                    "string", "one",
+	                                                    "number", 1,
+	                                                    NULL);
+	g_assert_no_error (error);
+	g_assert_cmpstr (password, ==, "111");
+	secret_password_free (password);
+
+	service = secret_service_get_sync (SECRET_SERVICE_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_signal_connect (service, "g-signal", G_CALLBACK (on_service_signal), &signals);
+
+	/* Makes the service emit CollectionCreated while an unrelated call runs */
+	properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                                    (GDestroyNotify)g_variant_unref);
+	g_hash_table_insert (properties, SECRET_COLLECTION_INTERFACE ".Label",
+	                     g_variant_ref_sink (g_variant_new_string ("Wheeee")));
+	path = secret_service_create_collection_path_sync (service, properties,
+	                                                   NULL, NULL, &error);
+	g_hash_table_unref (properties);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+	g_free (path);
+
+	/* The signal belongs to the first call's context, which isn't reused */
+	password = secret_password_lookup_nonpageable_sync (&PASSWORD_SCHEMA, NULL, &error,
+	                                                    "even", FALSE,
+	                                                    "string", "one",
+	                                                    "number", 1,
+	                                                    NULL);
+	g_assert_no_error (error);
+	secret_password_free (password);
+
+	g_assert_cmpuint (signals, ==, 0);
+
+	g_signal_handlers_disconnect_by_func (service, on_service_signal, &signals);
+	g_object_unref (service);
+	secret_service_set_keep_alive (0);
+}
+
 static void
 test_store_sync (Test *test,
                   gconstpointer used)
@@ -236,7 +380,11 @@ main (int argc, char **argv)
 
 	g_test_add ("/password/lookup-sync", Test, "mock-service-normal.py", setup, test_lookup_sync, teardown);
 	g_test_add ("/password/lookup-async", Test, "mock-service-normal.py", setup, test_lookup_async, teardown);
+	g_test_add ("/password/lookup-keep-alive", Test, "mock-service-normal.py", setup, test_lookup_keep_alive, teardown);
+	if (g_test_perf ())
+		g_test_add ("/password/lookup-keep-alive-perf", Test, "mock-service-normal.py", setup, test_lookup_keep_alive_perf, teardown);
 
+	g_test_add ("/password/lookup-sync-signal-after", Test, "mock-service-normal.py", setup, test_lookup_sync_signal_after, teardown);
 	g_test_add ("/password/store-sync", Test, "mock-service-normal.py", setup, test_store_sync, teardown);
 	g_test_add ("/password/store-async", Test, "mock-service-normal.py", setup, test_store_async, teardown);
 
@@ -236,6 +236,155 @@ test_get_more_async (Test *test,
 	egg_assert_not_object (service);
 }
 
+static void
+test_get_cancelled (Test *test,
+                    gconstpointer data)
+{
+	GAsyncResult *cancelled = NULL;
+	GAsyncResult *result = NULL;
+	GCancellable *cancellable;
+	SecretService *service;
+	GError *error = NULL;
+
+	cancellable = g_cancellable_new ();
+
+	/* Both wait for the same shared service */
+	secret_service_get (SECRET_SERVICE_NONE, cancellable, on_complete_get_result, &cancelled);
+	secret_service_get (SECRET_SERVICE_NONE, NULL, on_complete_get_result, &result);
+	g_cancellable_cancel (cancellable);
+
+	/* The cancelled one completes without waiting for the service */
+	egg_test_wait ();
+	g_assert (cancelled != NULL);
+	service = secret_service_get_finish (cancelled, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (service == NULL);
+	g_clear_error (&error);
+
+	/* The other one still gets the service */
+	if (result == NULL)
+		egg_test_wait ();
+	service = secret_service_get_finish (result, &error);
+	g_assert_no_error (error);
+	g_assert (SECRET_IS_SERVICE (service));
+
+	g_object_unref (cancelled);
+	g_object_unref (result);
+	g_object_unref (cancellable);
+
+	g_object_unref (service);
+	egg_assert_not_object (service);
+}
+
+static void
+on_complete_store_result (GObject *source,
+                          GAsyncResult *result,
+                          gpointer user_data)
+{
+	GAsyncResult **ret = user_data;
+	g_assert (ret != NULL);
+	g_assert (*ret == NULL);
+	*ret = g_object_ref (result);
+}
+
+static void
+test_get_async_then_sync (Test *test,
+                          gconstpointer data)
+{
+	GAsyncResult *result = NULL;
+	SecretService *service1;
+	SecretService *service2;
+	GError *error = NULL;
+
+	/* Doesn't wait on this thread's own creation of the service */
+	secret_service_get (SECRET_SERVICE_NONE, NULL, on_complete_store_result, &result);
+	service1 = secret_service_get_sync (SECRET_SERVICE_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (SECRET_IS_SERVICE (service1));
+
+	while (result == NULL)
+		egg_test_wait_until (50);
+	service2 = secret_service_get_finish (result, &error);
+	g_assert_no_error (error);
+	g_assert (service1 == service2);
+
+	g_object_unref (result);
+	g_object_unref (service1);
+	g_object_unref (service2);
+	egg_assert_not_object (service2);
+}
+
+static gpointer
+get_sync_thread (gpointer data)
+{
+	SecretServiceFlags flags = GPOINTER_TO_UINT (data);
+	SecretService *service;
+	GError *error = NULL;
+
+	service = secret_service_get_sync (flags, NULL, &error);
+	g_assert_no_error (error);
+
+	return service;
+}
+
+static void
+get_sync_concurrently (GThread **threads,
+                       guint n_threads,
+                       SecretServiceFlags flags)
+{
+	guint i;
+
+	for (i = 0; i < n_threads; i++)
+		threads[i] = g_thread_new ("get-service", get_sync_thread, GUINT_TO_POINTER (flags));
+}
+
+static void
+test_get_concurrent (Test *test,
+                     gconstpointer data)
+{
+	SecretService *services[16];
+	GThread *threads[16];
+	guint i;
+
+	get_sync_concurrently (threads, G_N_ELEMENTS (threads), SECRET_SERVICE_OPEN_SESSION);
+
+	/* All should get the same instance, with the flags they asked for */
+	for (i = 0; i < G_N_ELEMENTS (threads); i++) {
+		services[i] = g_thread_join (threads[i]);
+		g_assert (SECRET_IS_SERVICE (services[i]));
+		g_assert (services[i] == services[0]);
+		g_assert (secret_service_get_session_path (services[i]) != NULL);
+	}
+
+	for (i = 1; i < G_N_ELEMENTS (services); i++)
+		g_object_unref (services[i]);
+	g_object_unref (services[0]);
+	egg_assert_not_object (services[0]);
+}
+
+static void
+test_get_concurrent_perf (Test *test,
+                          gconstpointer data)
+{
+	GThread *threads[64];
+	SecretService *service;
+	gdouble elapsed;
+	guint i, round;
+
+	g_test_timer_start ();
+
+	for (round = 0; round < 20; round++) {
+		get_sync_concurrently (threads, G_N_ELEMENTS (threads), SECRET_SERVICE_OPEN_SESSION);
+		for (i = 0; i < G_N_ELEMENTS (threads); i++) {
+			service = g_thread_join (threads[i]);
+			g_object_unref (service);
+		}
+	}
+
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "started 20 x 64 threads in %6.3f seconds", elapsed);
+}
+
 static void
 test_new_sync (void)
 {
@@ -549,6 +698,11 @@ main (int argc, char **argv)
 	g_test_add_func ("/service/get-async", test_get_async);
 	g_test_add ("/service/get-more-sync", Test, "mock-service-normal.py", setup_mock, test_get_more_sync, teardown_mock);
 	g_test_add ("/service/get-more-async", Test, "mock-service-normal.py", setup_mock, test_get_more_async, teardown_mock);
+	g_test_add ("/service/get-concurrent", Test, "mock-service-normal.py", setup_mock, test_get_concurrent, teardown_mock);
+	g_test_add ("/service/get-cancelled", Test, "mock-service-normal.py", setup_mock, test_get_cancelled, teardown_mock);
+	g_test_add ("/service/get-async-then-sync", Test, "mock-service-normal.py", setup_mock, test_get_async_then_sync, teardown_mock);
+	if (g_test_perf ())
+		g_test_add ("/service/get-concurrent-perf", Test, "mock-service-normal.py", setup_mock, test_get_concurrent_perf, teardown_mock);
 
 	g_test_add_func ("/service/new-sync", test_new_sync);
 	g_test_add_func ("/service/new-async", test_new_async);
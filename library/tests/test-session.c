@@ -25,6 +25,18 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const SecretSchema LOOKUP_SCHEMA = {
+	"org.mock.type.Store",
+	SECRET_SCHEMA_NONE,
+	{
+		{ "number", SECRET_SCHEMA_ATTRIBUTE_INTEGER },
+		{ "string", SECRET_SCHEMA_ATTRIBUTE_STRING },
+		{ "even", SECRET_SCHEMA_ATTRIBUTE_BOOLEAN },
+	}
+};
 
 typedef struct {
 	SecretService *service;
@@ -71,6 +83,101 @@ test_ensure (Test *test,
 	g_assert_cmpstr (secret_service_get_session_algorithms (test->service), ==, "dh-ietf1024-sha256-aes128-cbc-pkcs7");
 }
 
+#ifdef WITH_X25519
+
+static void
+test_ensure_x25519 (Test *test,
+                    gconstpointer unused)
+{
+	GError *error = NULL;
+	const gchar *path;
+
+	path = secret_service_ensure_session_sync (test->service, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), ==, path);
+	g_assert_cmpstr (secret_service_get_session_algorithms (test->service), ==, "ecdh-x25519-sha256-aes128-gcm");
+}
+
+static void
+test_x25519_remembered (Test *test,
+                        gconstpointer unused)
+{
+	GError *error = NULL;
+	const gchar *path;
+
+	g_assert_cmpint (_secret_service_get_x25519 (test->service), ==, SECRET_EXTENSION_UNKNOWN);
+
+	path = secret_service_ensure_session_sync (test->service, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+
+	/* Later sessions don't offer X25519 again */
+	g_assert_cmpint (_secret_service_get_x25519 (test->service), ==, SECRET_EXTENSION_MISSING);
+
+	_secret_service_reset_session (test->service, NULL);
+	path = secret_service_ensure_session_sync (test->service, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+	g_assert_cmpstr (secret_service_get_session_algorithms (test->service), ==, "dh-ietf1024-sha256-aes128-cbc-pkcs7");
+	g_assert_cmpint (_secret_service_get_x25519 (test->service), ==, SECRET_EXTENSION_MISSING);
+}
+
+#endif /* WITH_X25519 */
+
+static gpointer
+ensure_session_thread (gpointer data)
+{
+	SecretService *service = data;
+	GError *error = NULL;
+	const gchar *path;
+
+	path = secret_service_ensure_session_sync (service, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+
+	return (gpointer)path;
+}
+
+static void
+test_ensure_concurrent (Test *test,
+                        gconstpointer unused)
+{
+	GThread *threads[16];
+	GDBusNodeInfo *node;
+	GError *error = NULL;
+	const gchar *path;
+	const gchar *xml;
+	GVariant *retval;
+	guint i, count;
+
+	for (i = 0; i < G_N_ELEMENTS (threads); i++)
+		threads[i] = g_thread_new ("ensure-session", ensure_session_thread, test->service);
+	for (i = 0; i < G_N_ELEMENTS (threads); i++) {
+		path = g_thread_join (threads[i]);
+		g_assert_cmpstr (path, ==, secret_service_get_session_path (test->service));
+	}
+
+	/* Only one session should have been opened with the service */
+	retval = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (test->service)),
+	                                      g_dbus_proxy_get_name (G_DBUS_PROXY (test->service)),
+	                                      "/org/freedesktop/secrets/sessions",
+	                                      "org.freedesktop.DBus.Introspectable", "Introspect",
+	                                      NULL, G_VARIANT_TYPE ("(s)"),
+	                                      G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	g_assert_no_error (error);
+
+	g_variant_get (retval, "(&s)", &xml);
+	node = g_dbus_node_info_new_for_xml (xml, &error);
+	g_assert_no_error (error);
+
+	for (count = 0; node->nodes && node->nodes[count]; count++);
+	g_assert_cmpuint (count, ==, 1);
+
+	g_dbus_node_info_unref (node);
+	g_variant_unref (retval);
+}
+
 static void
 test_ensure_twice (Test *test,
                    gconstpointer unused)
@@ -204,6 +311,579 @@ test_ensure_async_twice (Test *test,
 	g_object_unref (result);
 }
 
+static void
+test_ensure_cancelled (Test *test,
+                       gconstpointer unused)
+{
+	GAsyncResult *cancelled = NULL;
+	GAsyncResult *result = NULL;
+	GCancellable *cancellable;
+	GError *error = NULL;
+	const gchar *path;
+
+	cancellable = g_cancellable_new ();
+
+	/* Both wait for the same session */
+	secret_service_ensure_session (test->service, cancellable, on_complete_get_result, &cancelled);
+	secret_service_ensure_session (test->service, NULL, on_complete_get_result, &result);
+	g_cancellable_cancel (cancellable);
+
+	/* The cancelled one completes without waiting for the session */
+	egg_test_wait ();
+	g_assert (cancelled != NULL);
+	path = secret_service_ensure_session_finish (test->service, cancelled, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (path == NULL);
+	g_clear_error (&error);
+
+	/* The other one still gets the session */
+	if (result == NULL)
+		egg_test_wait ();
+	path = secret_service_ensure_session_finish (test->service, result, &error);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+
+	g_object_unref (cancelled);
+	g_object_unref (result);
+	g_object_unref (cancellable);
+}
+
+static void
+test_ensure_all_cancelled (Test *test,
+                           gconstpointer unused)
+{
+	GAsyncResult *first = NULL;
+	GAsyncResult *second = NULL;
+	GAsyncResult *result = NULL;
+	GCancellable *cancellable;
+	GError *error = NULL;
+	const gchar *path;
+
+	cancellable = g_cancellable_new ();
+
+	/* Nobody is left waiting, so the open is cancelled too */
+	secret_service_ensure_session (test->service, cancellable, on_complete_get_result, &first);
+	secret_service_ensure_session (test->service, cancellable, on_complete_get_result, &second);
+	g_cancellable_cancel (cancellable);
+
+	while (first == NULL || second == NULL)
+		egg_test_wait_until (50);
+	secret_service_ensure_session_finish (test->service, first, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_clear_error (&error);
+	secret_service_ensure_session_finish (test->service, second, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_clear_error (&error);
+
+	/* A later caller doesn't get the cancelled open, but a new one */
+	secret_service_ensure_session (test->service, NULL, on_complete_get_result, &result);
+	egg_test_wait ();
+	path = secret_service_ensure_session_finish (test->service, result, &error);
+	g_assert_no_error (error);
+	g_assert (path != NULL);
+
+	g_object_unref (first);
+	g_object_unref (second);
+	g_object_unref (result);
+	g_object_unref (cancellable);
+}
+
+static SecretSession *
+ensure_session_take (Test *test)
+{
+	GAsyncResult *result = NULL;
+	SecretSession *session;
+	GError *error = NULL;
+
+	secret_service_ensure_session (test->service, NULL, on_complete_get_result, &result);
+	egg_test_wait ();
+
+	session = _secret_service_ensure_session_take (test->service, result, &error);
+	g_assert_no_error (error);
+	g_assert (session != NULL);
+	g_object_unref (result);
+
+	return session;
+}
+
+static void
+test_encode_decode (Test *test,
+                    gconstpointer unused)
+{
+	const gsize lengths[] = { 0, 1, 15, 16, 17, 4096, 1024 * 1024 };
+	SecretSession *session;
+	SecretValue *value;
+	SecretValue *decoded;
+	GVariant *encoded;
+	gconstpointer data;
+	gchar *secret;
+	gsize length;
+	guint i, j;
+
+	session = ensure_session_take (test);
+
+	for (i = 0; i < G_N_ELEMENTS (lengths); i++) {
+		secret = g_malloc (lengths[i] + 1);
+		for (j = 0; j < lengths[i]; j++)
+			secret[j] = (gchar)(j % 251);
+		value = secret_value_new_full (secret, lengths[i], "application/octet-stream", g_free);
+
+		encoded = _secret_session_encode_secret (session, value);
+		g_assert (encoded != NULL);
+		g_variant_ref_sink (encoded);
+
+		decoded = _secret_session_decode_secret (session, encoded);
+		g_assert (decoded != NULL);
+		data = secret_value_get (decoded, &length);
+		egg_assert_cmpmem (data, length, ==, secret, lengths[i]);
+
+		secret_value_unref (decoded);
+		g_variant_unref (encoded);
+		secret_value_unref (value);
+	}
+
+	_secret_session_unref (session);
+}
+
+static void
+test_decode_perf (Test *test,
+                  gconstpointer unused)
+{
+	SecretSession *session;
+	SecretValue *value;
+	SecretValue *decoded;
+	GVariant *encoded;
+	gdouble elapsed;
+	gint i;
+
+	session = ensure_session_take (test);
+
+	value = secret_value_new ("the secret password", -1, "text/plain");
+	encoded = _secret_session_encode_secret (session, value);
+	g_assert (encoded != NULL);
+	g_variant_ref_sink (encoded);
+
+	g_test_timer_start ();
+	for (i = 0; i < 10000; i++) {
+		decoded = _secret_session_decode_secret (session, encoded);
+		g_assert (decoded != NULL);
+		secret_value_unref (decoded);
+	}
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "decoded 10000 secrets in %6.3f seconds", elapsed);
+
+	g_variant_unref (encoded);
+	secret_value_unref (value);
+	_secret_session_unref (session);
+}
+
+static void
+test_handshake_perf (Test *test,
+                     gconstpointer unused)
+{
+	GError *error = NULL;
+	SecretSync *sync;
+	gdouble elapsed;
+	clock_t cpu;
+	gint i, count = 50;
+
+	cpu = clock ();
+	g_test_timer_start ();
+
+	for (i = 0; i < count; i++) {
+		sync = _secret_sync_new ();
+		g_main_context_push_thread_default (sync->context);
+
+		_secret_session_open (test->service, NULL, _secret_sync_on_result, sync);
+		g_main_loop_run (sync->loop);
+		_secret_session_open_finish (sync->result, &error);
+		g_assert_no_error (error);
+
+		g_main_context_pop_thread_default (sync->context);
+		_secret_sync_free (sync);
+	}
+
+	elapsed = g_test_timer_elapsed ();
+	cpu = clock () - cpu;
+
+	/* The mock service runs in another process, so cpu time is only ours */
+	g_test_message ("%s handshake: %.3f ms/session wall clock",
+	                secret_service_get_session_algorithms (test->service),
+	                elapsed * 1000 / count);
+	g_test_minimized_result ((gdouble)cpu / CLOCKS_PER_SEC / count,
+	                         "%s handshake: %.3f ms/session cpu",
+	                         secret_service_get_session_algorithms (test->service),
+	                         (gdouble)cpu * 1000 / CLOCKS_PER_SEC / count);
+}
+
+typedef struct {
+	gint64 last;
+	gint64 worst;
+	guint ticks;
+} StallCheck;
+
+static gboolean
+on_stall_tick (gpointer user_data)
+{
+	StallCheck *check = user_data;
+	gint64 now = g_get_monotonic_time ();
+
+	check->worst = MAX (check->worst, now - check->last);
+	check->last = now;
+	check->ticks++;
+	return TRUE;
+}
+
+static void
+test_open_stall (Test *test,
+                 gconstpointer unused)
+{
+	GAsyncResult *result = NULL;
+	GError *error = NULL;
+	StallCheck check;
+	gdouble worst;
+	guint tick;
+
+	/* Any session crypto done on the main loop delays the ticks */
+	check.last = g_get_monotonic_time ();
+	check.worst = 0;
+	check.ticks = 0;
+	tick = g_timeout_add (1, on_stall_tick, &check);
+
+	secret_service_ensure_session (test->service, NULL, on_complete_get_result, &result);
+	egg_test_wait ();
+	g_source_remove (tick);
+
+	secret_service_ensure_session_finish (test->service, result, &error);
+	g_assert_no_error (error);
+	g_object_unref (result);
+
+	/* The session was opened while the caller's main loop kept running */
+	g_assert_cmpuint (check.ticks, >, 0);
+
+	worst = (gdouble)check.worst / 1000;
+	g_test_minimized_result (worst, "%s: main loop stalled at most %.3f ms during session open",
+	                         secret_service_get_session_algorithms (test->service), worst);
+}
+
+static void
+assert_get_secret (Test *test)
+{
+	GError *error = NULL;
+	SecretValue *value;
+
+	value = secret_service_get_secret_for_path_sync (test->service,
+	                                                 "/org/freedesktop/secrets/collection/english/1",
+	                                                 NULL, &error);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	g_assert_cmpstr (secret_value_get (value, NULL), ==, "111");
+	secret_value_unref (value);
+}
+
+static void
+test_session_closed (Test *test,
+                     gconstpointer unused)
+{
+	GError *error = NULL;
+	GVariant *retval;
+	gchar *path;
+
+	path = g_strdup (secret_service_ensure_session_sync (test->service, NULL, &error));
+	g_assert_no_error (error);
+
+	/* Close the session behind the back of the proxy */
+	retval = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (test->service)),
+	                                      g_dbus_proxy_get_name (G_DBUS_PROXY (test->service)),
+	                                      path, "org.freedesktop.Secret.Session", "Close",
+	                                      g_variant_new ("()"), NULL, G_DBUS_CALL_FLAGS_NONE,
+	                                      -1, NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (retval);
+
+	/* Retried once with a new session */
+	assert_get_secret (test);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, NULL);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	g_free (path);
+}
+
+static void
+test_lookup_session_closed (Test *test,
+                            gconstpointer unused)
+{
+	GError *error = NULL;
+	SecretValue *value;
+	GVariant *retval;
+	gchar *path;
+
+	path = g_strdup (secret_service_ensure_session_sync (test->service, NULL, &error));
+	g_assert_no_error (error);
+
+	/* Close the session behind the back of the proxy */
+	retval = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (test->service)),
+	                                      g_dbus_proxy_get_name (G_DBUS_PROXY (test->service)),
+	                                      path, "org.freedesktop.Secret.Session", "Close",
+	                                      g_variant_new ("()"), NULL, G_DBUS_CALL_FLAGS_NONE,
+	                                      -1, NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (retval);
+
+	/* The one round trip lookup is retried once with a new session */
+	value = secret_service_lookup_sync (test->service, &LOOKUP_SCHEMA, NULL, &error,
+	                                    "even", FALSE, "string", "one", "number", 1, NULL);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	g_assert_cmpstr (secret_value_get (value, NULL), ==, "111");
+	secret_value_unref (value);
+
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, NULL);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	g_free (path);
+}
+
+static gchar *
+ensure_and_close_session (Test *test)
+{
+	GError *error = NULL;
+	GVariant *retval;
+	gchar *path;
+
+	path = g_strdup (secret_service_ensure_session_sync (test->service, NULL, &error));
+	g_assert_no_error (error);
+
+	/* Close the session behind the back of the proxy */
+	retval = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (test->service)),
+	                                      g_dbus_proxy_get_name (G_DBUS_PROXY (test->service)),
+	                                      path, "org.freedesktop.Secret.Session", "Close",
+	                                      g_variant_new ("()"), NULL, G_DBUS_CALL_FLAGS_NONE,
+	                                      -1, NULL, &error);
+	g_assert_no_error (error);
+	g_variant_unref (retval);
+
+	return path;
+}
+
+static void
+test_set_secret_session_closed (Test *test,
+                                gconstpointer unused)
+{
+	const gchar *item_path = "/org/freedesktop/secrets/collection/english/1";
+	GError *error = NULL;
+	SecretValue *value;
+	SecretItem *item;
+	gboolean ret;
+	gchar *path;
+
+	item = secret_item_new_sync (test->service, item_path, NULL, &error);
+	g_assert_no_error (error);
+
+	path = ensure_and_close_session (test);
+
+	/* SetSecret is retried once with a new session */
+	value = secret_value_new ("Sinking", -1, "strange/content-type");
+	ret = secret_item_set_secret_sync (item, value, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret == TRUE);
+	secret_value_unref (value);
+
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, NULL);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	value = secret_item_get_secret_sync (item, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	g_assert_cmpstr (secret_value_get (value, NULL), ==, "Sinking");
+	secret_value_unref (value);
+
+	g_object_unref (item);
+	g_free (path);
+}
+
+static void
+test_create_item_session_closed (Test *test,
+                                 gconstpointer unused)
+{
+	const gchar *collection_path = "/org/freedesktop/secrets/collection/english";
+	GHashTable *properties;
+	GError *error = NULL;
+	SecretValue *value;
+	gchar *item_path;
+	gchar *path;
+
+	path = ensure_and_close_session (test);
+
+	properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+	                                    (GDestroyNotify)g_variant_unref);
+	g_hash_table_insert (properties, SECRET_ITEM_INTERFACE ".Label",
+	                     g_variant_ref_sink (g_variant_new_string ("Created")));
+	g_hash_table_insert (properties, SECRET_ITEM_INTERFACE ".Attributes",
+	                     g_variant_ref_sink (g_variant_new_array (G_VARIANT_TYPE ("{ss}"), NULL, 0)));
+	value = secret_value_new ("Created", -1, "text/plain");
+
+	/* CreateItem is retried once with a new session */
+	item_path = secret_service_create_item_path_sync (test->service, collection_path,
+	                                                   properties, value, FALSE,
+	                                                   NULL, &error);
+	g_assert_no_error (error);
+	g_assert (item_path != NULL);
+
+	secret_value_unref (value);
+	g_hash_table_unref (properties);
+
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, NULL);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	value = secret_service_get_secret_for_path_sync (test->service, item_path, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (value != NULL);
+	g_assert_cmpstr (secret_value_get (value, NULL), ==, "Created");
+	secret_value_unref (value);
+
+	g_free (item_path);
+	g_free (path);
+}
+
+static gboolean
+session_is_open (Test *test,
+                 const gchar *path)
+{
+	GError *error = NULL;
+	GVariant *retval;
+	const gchar *xml;
+	gboolean open;
+
+	retval = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (G_DBUS_PROXY (test->service)),
+	                                      g_dbus_proxy_get_name (G_DBUS_PROXY (test->service)),
+	                                      path, "org.freedesktop.DBus.Introspectable", "Introspect",
+	                                      g_variant_new ("()"), G_VARIANT_TYPE ("(s)"),
+	                                      G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+	if (retval == NULL) {
+		g_error_free (error);
+		return FALSE;
+	}
+
+	g_variant_get (retval, "(&s)", &xml);
+	open = strstr (xml, "org.freedesktop.Secret.Session") != NULL;
+	g_variant_unref (retval);
+
+	return open;
+}
+
+static void
+test_session_rotation_closes (Test *test,
+                              gconstpointer unused)
+{
+	gchar *path;
+	gint i;
+
+	secret_service_set_session_rotation (test->service, 1);
+
+	assert_get_secret (test);
+	path = g_strdup (secret_service_get_session_path (test->service));
+	g_assert (path != NULL);
+	g_assert (session_is_open (test, path));
+
+	g_usleep (G_USEC_PER_SEC + G_USEC_PER_SEC / 10);
+	assert_get_secret (test);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	/* Nothing uses the old session anymore, so it is closed */
+	for (i = 0; i < 100 && session_is_open (test, path); i++)
+		egg_test_wait_until (50);
+	g_assert (!session_is_open (test, path));
+
+	g_free (path);
+}
+
+static void
+test_service_restart (Test *test,
+                      gconstpointer data)
+{
+	const gchar *mock_script = data;
+	GError *error = NULL;
+	gchar *path;
+	gint i;
+
+	path = g_strdup (secret_service_ensure_session_sync (test->service, NULL, &error));
+	g_assert_no_error (error);
+
+	mock_service_stop ();
+	mock_service_start (mock_script, &error);
+	g_assert_no_error (error);
+
+	/* The name watch notices and drops the session */
+	for (i = 0; i < 100 && secret_service_get_session_path (test->service) != NULL; i++)
+		egg_test_wait_until (50);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), ==, NULL);
+
+	assert_get_secret (test);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, NULL);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	g_free (path);
+}
+
+static void
+test_service_restart_context (Test *test,
+                              gconstpointer data)
+{
+	const gchar *mock_script = data;
+	GMainContext *context;
+	SecretService *service;
+	GError *error = NULL;
+	gint i;
+
+	/* A proxy made in another context watches the name there */
+	context = g_main_context_new ();
+	g_main_context_push_thread_default (context);
+
+	service = secret_service_new_sync (NULL, SECRET_SERVICE_OPEN_SESSION, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (secret_service_get_session_path (service) != NULL);
+
+	mock_service_stop ();
+	mock_service_start (mock_script, &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < 100 && secret_service_get_session_path (service) != NULL; i++) {
+		g_usleep (G_USEC_PER_SEC / 20);
+		while (g_main_context_iteration (context, FALSE));
+	}
+	g_assert_cmpstr (secret_service_get_session_path (service), ==, NULL);
+
+	g_object_unref (service);
+
+	g_main_context_pop_thread_default (context);
+	g_main_context_unref (context);
+}
+
+static void
+test_session_rotation (Test *test,
+                       gconstpointer unused)
+{
+	gchar *path;
+
+	secret_service_set_session_rotation (test->service, 1);
+
+	assert_get_secret (test);
+	path = g_strdup (secret_service_get_session_path (test->service));
+	g_assert (path != NULL);
+
+	/* Still fresh */
+	assert_get_secret (test);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), ==, path);
+
+	g_usleep (G_USEC_PER_SEC + G_USEC_PER_SEC / 10);
+
+	assert_get_secret (test);
+	g_assert_cmpstr (secret_service_get_session_path (test->service), !=, path);
+
+	g_free (path);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -211,12 +891,39 @@ main (int argc, char **argv)
 	g_set_prgname ("test-session");
 	g_type_init ();
 
-	g_test_add ("/session/ensure-aes", Test, "mock-service-normal.py", setup, test_ensure, teardown);
-	g_test_add ("/session/ensure-twice", Test, "mock-service-normal.py", setup, test_ensure_twice, teardown);
+	g_test_add ("/session/ensure-aes", Test, "mock-service-only-aes.py", setup, test_ensure, teardown);
+	g_test_add ("/session/ensure-twice", Test, "mock-service-only-aes.py", setup, test_ensure_twice, teardown);
+	g_test_add ("/session/ensure-concurrent", Test, "mock-service-normal.py", setup, test_ensure_concurrent, teardown);
 	g_test_add ("/session/ensure-plain", Test, "mock-service-only-plain.py", setup, test_ensure_plain, teardown);
-	g_test_add ("/session/ensure-async-aes", Test, "mock-service-normal.py", setup, test_ensure_async_aes, teardown);
+	g_test_add ("/session/ensure-async-aes", Test, "mock-service-only-aes.py", setup, test_ensure_async_aes, teardown);
 	g_test_add ("/session/ensure-async-plain", Test, "mock-service-only-plain.py", setup, test_ensure_async_plain, teardown);
 	g_test_add ("/session/ensure-async-twice", Test, "mock-service-only-plain.py", setup, test_ensure_async_twice, teardown);
+	g_test_add ("/session/ensure-cancelled", Test, "mock-service-normal.py", setup, test_ensure_cancelled, teardown);
+	g_test_add ("/session/ensure-all-cancelled", Test, "mock-service-normal.py", setup, test_ensure_all_cancelled, teardown);
+	g_test_add ("/session/encode-decode-aes", Test, "mock-service-only-aes.py", setup, test_encode_decode, teardown);
+	g_test_add ("/session/encode-decode-plain", Test, "mock-service-only-plain.py", setup, test_encode_decode, teardown);
+	g_test_add ("/session/session-closed", Test, "mock-service-normal.py", setup, test_session_closed, teardown);
+	g_test_add ("/session/service-restart", Test, "mock-service-normal.py", setup, test_service_restart, teardown);
+	g_test_add ("/session/service-restart-context", Test, "mock-service-normal.py", setup, test_service_restart_context, teardown);
+	g_test_add ("/session/session-rotation", Test, "mock-service-normal.py", setup, test_session_rotation, teardown);
+	g_test_add ("/session/session-rotation-closes", Test, "mock-service-normal.py", setup, test_session_rotation_closes, teardown);
+	g_test_add ("/session/lookup-session-closed", Test, "mock-service-normal.py", setup, test_lookup_session_closed, teardown);
+	g_test_add ("/session/set-secret-session-closed", Test, "mock-service-normal.py", setup, test_set_secret_session_closed, teardown);
+	g_test_add ("/session/create-item-session-closed", Test, "mock-service-normal.py", setup, test_create_item_session_closed, teardown);
+#ifdef WITH_X25519
+	g_test_add ("/session/ensure-x25519", Test, "mock-service-normal.py", setup, test_ensure_x25519, teardown);
+	g_test_add ("/session/x25519-remembered", Test, "mock-service-only-aes.py", setup, test_x25519_remembered, teardown);
+	g_test_add ("/session/encode-decode-x25519", Test, "mock-service-normal.py", setup, test_encode_decode, teardown);
+#endif
+
+	if (g_test_perf ()) {
+		g_test_add ("/session/decode-perf", Test, "mock-service-normal.py", setup, test_decode_perf, teardown);
+		g_test_add ("/session/decode-perf-aes", Test, "mock-service-only-aes.py", setup, test_decode_perf, teardown);
+		g_test_add ("/session/handshake-perf", Test, "mock-service-normal.py", setup, test_handshake_perf, teardown);
+		g_test_add ("/session/handshake-perf-aes", Test, "mock-service-only-aes.py", setup, test_handshake_perf, teardown);
+		g_test_add ("/session/open-stall", Test, "mock-service-normal.py", setup, test_open_stall, teardown);
+		g_test_add ("/session/open-stall-aes", Test, "mock-service-only-aes.py", setup, test_open_stall, teardown);
+	}
 
 	return egg_tests_run_with_loop ();
 }